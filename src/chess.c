@@ -0,0 +1,411 @@
+#include <pthread.h>
+#include "engine.h"
+
+#define QUERY_CHUNK 256		//Numero minimo de posicoes de cada thread de query_moves
+
+typedef struct query Query;
+
+struct query {				//Parte de um lote de query_moves, processada por uma thread
+	const char* const* fen;		//Posicoes do lote, FEN ou compactadas
+	const unsigned char* packed;
+	int begin;			//Primeira posicao da parte
+	int end;			//Fim da parte (exclusivo)
+	QueryResult* res;		//Resultados do lote
+	unsigned short* codes;		//Movimentos da parte, reunidos no fim do lote
+	long n;
+	long m;
+};
+
+struct game {				//Jogo da biblioteca
+	Chess chess;			//Posicao atual
+	Arena arena;			//Memoria do jogo
+	Undo* undo;			//Dados para desfazer cada movimento
+	char (*fen)[FEN_SIZE];		//FEN da posicao inicial e de cada movimento, como gravados no historico
+	uint64_t* keys;			//Chaves das posicoes anteriores (repeticao na busca)
+	int n;				//Numero de movimentos efetuados
+	int m;
+	TTable tt;			//Tabela de transposicao, alocada na primeira busca
+	size_t hash;			//Tamanho da tabela de transposicao, em MB
+	Cache cache;			//Cache de analise persistente, map NULL se nao usado
+};
+
+/*Copia um codigo FEN para um recipiente de FEN_SIZE caracteres.
+	Parametros
+		const char* fen	codigo FEN, NULL para a posicao inicial padrao
+		char* buf	recipiente
+	Retorno
+		TRUE se o codigo cabe no recipiente, FALSE caso contrario
+*/
+static boolean copy_game(const char* fen, char* buf) {
+	if(fen == NULL)
+		fen = START_FEN;
+	if(strlen(fen) >= FEN_SIZE)
+		return FALSE;
+	strcpy(buf, fen);
+	return TRUE;
+}
+
+Game* initialize_game(const char* fen) {
+	Game* game;
+	char buf[FEN_SIZE];
+	Fen f;
+
+	if(!copy_game(fen, buf) || !parseFen(buf, &f))
+		return NULL;
+	game = (Game*) calloc(1, sizeof(Game));
+	initialize_arena(&game->arena);
+	game->hash = TT_MB;
+	game->m = 16;
+	game->undo = (Undo*) malloc(game->m*sizeof(Undo));
+	game->fen = (char (*)[FEN_SIZE]) malloc((game->m+1)*FEN_SIZE);
+	game->keys = (uint64_t*) malloc(game->m*sizeof(uint64_t));
+	COUNT_ALLOC(ALLOC_GAME, sizeof(Game));
+	COUNT_ALLOC(ALLOC_GAME, game->m*sizeof(Undo));
+	COUNT_ALLOC(ALLOC_GAME, (game->m+1)*FEN_SIZE);
+	COUNT_ALLOC(ALLOC_GAME, game->m*sizeof(uint64_t));
+	strcpy(game->fen[0], buf);
+	load_chess(&game->chess, game->fen[0], &game->arena);
+	return game;
+}
+
+void finalize_game(Game* game) {
+	clear_chess(&game->chess);
+	finalize_arena(&game->arena);
+	if(game->tt.entry != NULL)
+		finalize_ttable(&game->tt);
+	if(game->cache.map != NULL)
+		close_cache(&game->cache);
+	free(game->undo);
+	free(game->fen);
+	free(game->keys);
+	free(game);
+}
+
+int load_game(Game* game, const char* fen) {
+	char buf[FEN_SIZE];
+	Fen f;
+
+	if(!copy_game(fen, buf) || !parseFen(buf, &f))	//Valida antes de apagar o jogo atual
+		return FALSE;
+	clear_chess(&game->chess);
+	strcpy(game->fen[0], buf);
+	load_chess(&game->chess, game->fen[0], &game->arena);
+	game->n = 0;
+	return TRUE;
+}
+
+char* genFen_game(Game* game, char* fen) {
+	return genFen_chess(&game->chess, fen);
+}
+
+int turn_game(Game* game) {
+	return game->chess.turn;
+}
+
+int plies_game(Game* game) {
+	return game->n;
+}
+
+int genMoves_game(Game* game, char (*moves)[MOVE_SIZE]) {
+	int i, n;
+	Move list[MAX_MOVES];
+	n = genMoves_chess(&game->chess, list);
+	for(i=0; i<n; i++)
+		str_move(&list[i], moves[i]);
+	return n;
+}
+
+int doMove_game(Game* game, const char* move) {
+	char buf[MOVE_SIZE];
+	Piece* piece;
+	Move m;
+
+	if(strlen(move) >= MOVE_SIZE)
+		return FALSE;
+	strcpy(buf, move);
+	if(!parseMove_chess(&game->chess, buf, &piece, &m.dest))
+		return FALSE;
+	if(game->n >= game->m) {			//Historico cheio
+		game->m *= 2;
+		game->undo = (Undo*) realloc(game->undo, game->m*sizeof(Undo));
+		game->fen = (char (*)[FEN_SIZE]) realloc(game->fen, (game->m+1)*FEN_SIZE);
+		game->keys = (uint64_t*) realloc(game->keys, game->m*sizeof(uint64_t));
+		COUNT_ALLOC(ALLOC_GAME, game->m*sizeof(Undo));
+		COUNT_ALLOC(ALLOC_GAME, (game->m+1)*FEN_SIZE);
+		COUNT_ALLOC(ALLOC_GAME, game->m*sizeof(uint64_t));
+	}
+	m.file = piece->pos[0]->file;
+	m.rank = piece->pos[0]->rank;
+	game->keys[game->n] = key_chess(&game->chess);
+	doMove_chess(&game->chess, &m, &game->undo[game->n]);
+	recordGame_chess(&game->chess, game->fen[++game->n]);
+	return TRUE;
+}
+
+int undoMove_game(Game* game) {
+	if(!game->n)
+		return FALSE;
+	game->chess.n_history--;				//Retira a posicao do historico de repeticoes
+	undoMove_chess(&game->chess, &game->undo[--game->n]);
+	return TRUE;
+}
+
+Gamesit sit_game(Game* game) {
+	return sit_chess(&game->chess);
+}
+
+int moveAI_game(Game* game, char* move) {
+	Piece* piece;
+	Move m;
+
+	piece = NULL;
+	if(!moveAI_chess(&game->chess, &piece, &m.dest))
+		return FALSE;
+	m.file = piece->pos[0]->file;
+	m.rank = piece->pos[0]->rank;
+	str_move(&m, move);
+	return TRUE;
+}
+
+/*Prepara uma busca na posicao atual de um jogo, efetuando uma alocacao.
+	Parametros
+		Game* game		jogo
+		int depth		profundidade maxima, 0 para nenhum limite
+		long long nodes		numero maximo de nos, -1 para nenhum limite
+		long long time		tempo maximo em ms, -1 para nenhum limite
+	Retorno
+		busca, desalocada com free
+*/
+static Search* newSearch_game(Game* game, int depth, long long nodes, long long time) {
+	Search* s;
+
+	if(game->tt.entry == NULL)
+		initialize_ttable(&game->tt, game->hash);
+	s = (Search*) calloc(1, sizeof(Search));
+	COUNT_ALLOC(ALLOC_GAME, sizeof(Search));
+	s->chess = &game->chess;
+	s->tt = &game->tt;
+	s->cache = game->cache.map != NULL ? &game->cache : NULL;
+	s->max_depth = depth > 0 ? depth : MAX_PLY;
+	s->max_nodes = nodes;
+	s->max_time = time;
+	s->keys = game->keys;
+	s->n_keys = game->n;
+	s->out = NULL;
+	return s;
+}
+
+int search_game(Game* game, int depth, long long nodes, long long time, char* move, int* score) {
+	Search* s;
+	boolean found;
+
+	s = newSearch_game(game, depth, nodes, time);
+	found = iterate_search(s);
+	if(found) {
+		str_move(&s->best, move);
+		if(score != NULL)
+			*score = s->score;
+	}
+	free(s);
+	return found;
+}
+
+int analyze_game(Game* game, int depth, long long nodes, long long time, int n, int* scores, char (*pv)[PV_SIZE]) {
+	int i, k, len;
+	Search* s;
+
+	s = newSearch_game(game, depth, nodes, time);
+	s->multipv = n < 1 ? 1 : n > MAX_MULTIPV ? MAX_MULTIPV : n;
+	n = 0;
+	if(iterate_search(s))
+		for(n=0; n<s->n_lines; n++) {
+			scores[n] = s->lines_score[n];
+			for(i=len=0; i<s->lines_len[n]; i++) {
+				if(i)
+					pv[n][len++] = ' ';
+				str_move(&s->lines[n][i], pv[n]+len);
+				for(k=len; pv[n][k]; k++);
+				len = k;
+			}
+			pv[n][len] = '\0';
+		}
+	free(s);
+	return n;
+}
+
+void setHash_game(Game* game, size_t mb) {
+	if(game->tt.entry != NULL)
+		finalize_ttable(&game->tt);
+	game->hash = mb ? mb : 1;
+}
+
+int setCache_game(Game* game, const char* path, size_t mb) {
+	if(game->cache.map != NULL)
+		close_cache(&game->cache);
+	return path == NULL || open_cache(&game->cache, path, mb ? mb : CACHE_MB);
+}
+
+int legal_move(const char* fen, const char* move) {
+	Fen f;
+	State st;
+	Move m;
+
+	if(!parseFen(fen, &f))
+		return -1;
+	loadFen_state(&st, &f);
+	return parseMove_state(&st, move, &m);
+}
+
+Explorer* initialize_explorer(const char* path) {
+	Explorer* ex;
+	ex = (Explorer*) malloc(sizeof(Explorer));
+	COUNT_ALLOC(ALLOC_GAME, sizeof(Explorer));
+	if(!open_explorer(ex, path)) {
+		free(ex);
+		return NULL;
+	}
+	return ex;
+}
+
+void finalize_explorer(Explorer* ex) {
+	close_explorer(ex);
+	free(ex);
+}
+
+/*Compara dois movimentos do indice de aberturas pelo numero de jogos, decrescente (funcao de qsort).
+	Parametros
+		const void* a	movimento
+		const void* b	movimento
+	Retorno
+		negativo, zero ou positivo
+*/
+static int cmp_explorerMove(const void* a, const void* b) {
+	long long g1, g2;
+	g1 = ((const ExplorerMove*) a)->games;
+	g2 = ((const ExplorerMove*) b)->games;
+	return g1 < g2 ? 1 : g1 > g2 ? -1 : strcmp(((const ExplorerMove*) a)->move, ((const ExplorerMove*) b)->move);
+}
+
+int query_explorer(Explorer* ex, const char* fen, ExplorerMove* moves, int m) {
+	ExplorerEntry e[MAX_MOVES];
+	ExplorerMove all[MAX_MOVES];
+	Fen f;
+	State st;
+	Move move;
+	int i, n, k;
+
+	if(!parseFen(fen, &f))
+		return -1;
+	loadFen_state(&st, &f);
+	n = search_explorer(ex, key_explorer(&st), e, MAX_MOVES);
+	for(i=k=0; i<n && i<MAX_MOVES; i++) {
+		str_code(e[i].move, all[k].move);
+		if(!parseMove_state(&st, all[k].move, &move))	//Colisao de chaves
+			continue;
+		all[k].white = e[i].white;
+		all[k].draws = e[i].draws;
+		all[k].black = e[i].black;
+		all[k].games = all[k].white + all[k].draws + all[k].black;
+		k++;
+	}
+	qsort(all, k, sizeof(ExplorerMove), cmp_explorerMove);
+	k = k < m ? k : m;
+	memcpy(moves, all, k*sizeof(ExplorerMove));
+	return k;
+}
+
+char* str_code(unsigned short code, char* move) {
+	move[0] = (code & 7) + 'a';
+	move[1] = (code >> 3 & 7) + '1';
+	move[2] = (code >> 6 & 7) + 'a';
+	move[3] = (code >> 9 & 7) + '1';
+	move[4] = code >> 12 & 7 ? "nbrq"[(code >> 12 & 7) - 1] : '\0';
+	move[5] = '\0';
+	return move;
+}
+
+/*Funcao das threads de query_moves: gera os movimentos de uma parte do lote sobre registros State, sem alocacoes por posicao.
+	Parametros
+		void* arg	parte do lote
+	Retorno
+		NULL
+*/
+static void* thread_query(void* arg) {
+	int i, j, n;
+	Query* q;
+	QueryResult* res;
+	Fen f;
+	State st;
+	Move list[MAX_MOVES];
+
+	q = (Query*) arg;
+	for(i=q->begin; i<q->end; i++) {
+		res = &q->res[i];
+		res->first = q->n;
+		res->n = 0;
+		res->flags = 0;
+		if(q->fen != NULL ? q->fen[i] == NULL || !parseFen(q->fen[i], &f) : !unpackFen((const Packed*) (q->packed + (size_t) i*PACKED_SIZE), &f)) {
+			res->flags = QUERY_INVALID;
+			continue;
+		}
+		loadFen_state(&st, &f);
+		n = genMoves_state(&st, list);
+		if(q->n + n > q->m) {			//Recipiente da parte cheio
+			q->m = 2*(q->n + n);
+			q->codes = (unsigned short*) realloc(q->codes, q->m*sizeof(unsigned short));
+			COUNT_ALLOC(ALLOC_GAME, q->m*sizeof(unsigned short));
+		}
+		for(j=0; j<n; j++)
+			q->codes[q->n++] = code_move(&list[j]);
+		res->n = n;
+		if(incheck_state(&st))
+			res->flags = QUERY_CHECK | (n ? 0 : QUERY_MATE);
+		else
+			if(!n)
+				res->flags = QUERY_STALEMATE;
+	}
+	flush_stats();
+	return NULL;
+}
+
+long query_moves(const char* const* fen, const unsigned char* packed, int n, int threads, QueryResult* res, unsigned short* codes, char (*moves)[MOVE_SIZE], long m) {
+	int i, t;
+	long j, total;
+	Query* q;
+	pthread_t* tid;
+
+	if(threads > n/QUERY_CHUNK)			//Lotes pequenos: threads nao compensam
+		threads = n/QUERY_CHUNK;
+	if(threads < 1)
+		threads = 1;
+	q = (Query*) calloc(threads, sizeof(Query));
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	for(t=0; t<threads; t++) {
+		q[t].fen = fen;
+		q[t].packed = packed;
+		q[t].begin = (long long) n*t/threads;
+		q[t].end = (long long) n*(t+1)/threads;
+		q[t].res = res;
+	}
+	for(t=1; t<threads; t++)
+		pthread_create(&tid[t], NULL, thread_query, &q[t]);
+	thread_query(&q[0]);				//A primeira parte e processada pela thread atual
+	for(t=1; t<threads; t++)
+		pthread_join(tid[t], NULL);
+
+	for(t=0, total=0; t<threads; total += q[t++].n)	//Indices relativos ao lote
+		for(i=q[t].begin; i<q[t].end; i++)
+			res[i].first += total;
+	for(t=0; t<threads && total <= m; t++)
+		for(j=0; j<q[t].n; j++) {
+			if(codes != NULL)
+				codes[res[q[t].begin].first + j] = q[t].codes[j];
+			if(moves != NULL)
+				str_code(q[t].codes[j], moves[res[q[t].begin].first + j]);
+		}
+	for(t=0; t<threads; t++)
+		free(q[t].codes);
+	free(q);
+	free(tid);
+	return total;
+}
@@ -0,0 +1,304 @@
+#ifndef CHESS_H
+#define CHESS_H
+
+/*Biblioteca de xadrez: posicao, movimentos possiveis, movimentar e desfazer, FEN, situacao do jogo e IA.
+Cada jogo e um registro Game opaco e independente, sem estado global: jogos diferentes podem ser usados
+ao mesmo tempo em threads diferentes, e um mesmo jogo por uma thread de cada vez.
+Os movimentos usam a notacao algebrica simplificada (ex.: e2e4, e7e8q).*/
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define CHESS_API __attribute__((visibility("default")))
+#else
+#define CHESS_API
+#endif
+
+#define MAX_MOVES 256		//Numero maximo de movimentos possiveis numa posicao
+#define MOVE_SIZE 6		//Tamanho de um movimento em notacao algebrica simplificada, com o terminador
+#define FEN_SIZE 100		//Tamanho maximo de um codigo FEN, com o terminador
+#define STATS_SIZE 1024		//Tamanho maximo da linha de contadores de str_stats, com o terminador
+#define MAX_MULTIPV 16		//Numero maximo de variantes de analyze_game
+#define PV_SIZE (64*MOVE_SIZE)	//Tamanho de uma variante principal em notacao algebrica simplificada, com o terminador
+#define PACKED_SIZE 32		//Tamanho de uma posicao compactada, formato dos arquivos de --pack
+#define QUERY_CHECK 1		//Situacoes de query_moves: rei do turno em xeque
+#define QUERY_MATE 2		//Xeque-mate
+#define QUERY_STALEMATE 4	//Afogamento
+#define QUERY_INVALID 8		//Posicao invalida, sem movimentos
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"	//Posicao inicial
+
+typedef struct game Game;
+typedef struct query_result QueryResult;
+typedef struct explorer Explorer;
+typedef struct explorer_move ExplorerMove;
+
+struct query_result {		//Resultado de uma posicao de query_moves
+	long first;		//Indice do primeiro movimento nos vetores de movimentos
+	int n;			//Numero de movimentos
+	int flags;		//QUERY_CHECK, QUERY_MATE, QUERY_STALEMATE ou QUERY_INVALID
+};
+
+struct explorer_move {		//Estatisticas de um movimento no indice de aberturas
+	char move[MOVE_SIZE];	//Movimento em notacao algebrica simplificada
+	long long games;	//Jogos com o movimento na posicao
+	long long white;	//Vitorias das brancas
+	long long draws;	//Empates
+	long long black;	//Vitorias das pretas
+};
+
+typedef enum {		//Situacao de jogo
+	PLAY,
+	W_WINS,
+	B_WINS,
+	STALEMATE,
+	FIFTY,
+	MATERIAL,
+	REPETITION
+} Gamesit;
+
+/*Inicializa um jogo, efetuando uma alocacao.
+	Parametros
+		const char* fen	codigo FEN da posicao inicial, NULL para a posicao inicial padrao
+	Retorno
+		jogo, NULL se o codigo e invalido
+*/
+CHESS_API Game* initialize_game(const char* fen);
+
+/*Desaloca um jogo.
+	Parametros
+		Game* game	jogo
+*/
+CHESS_API void finalize_game(Game* game);
+
+/*Recomeca um jogo a partir de uma posicao. O historico e apagado; a tabela de transposicao e mantida.
+	Parametros
+		Game* game	jogo
+		const char* fen	codigo FEN, NULL para a posicao inicial padrao
+	Retorno
+		1 em caso de sucesso, 0 se o codigo e invalido (o jogo nao e alterado)
+*/
+CHESS_API int load_game(Game* game, const char* fen);
+
+/*Gera o codigo FEN da posicao atual.
+	Parametros
+		Game* game	jogo
+		char* fen	recipiente com no minimo FEN_SIZE caracteres
+	Retorno
+		fen
+*/
+CHESS_API char* genFen_game(Game* game, char* fen);
+
+/*Retorna o turno atual.
+	Parametros
+		Game* game	jogo
+	Retorno
+		0 - pecas brancas, 1 - pecas pretas
+*/
+CHESS_API int turn_game(Game* game);
+
+/*Retorna o numero de movimentos efetuados desde a posicao inicial do jogo.
+	Parametros
+		Game* game	jogo
+	Retorno
+		numero de movimentos que podem ser desfeitos
+*/
+CHESS_API int plies_game(Game* game);
+
+/*Lista os movimentos possiveis para o turno atual.
+	Parametros
+		Game* game		jogo
+		char (*moves)[MOVE_SIZE]	recipiente com no minimo MAX_MOVES elementos
+	Retorno
+		numero de movimentos
+*/
+CHESS_API int genMoves_game(Game* game, char (*moves)[MOVE_SIZE]);
+
+/*Efetua um movimento do turno atual, gravando a posicao no historico.
+	Parametros
+		Game* game		jogo
+		const char* move	movimento
+	Retorno
+		1 se o movimento foi efetuado, 0 se o movimento nao e possivel
+*/
+CHESS_API int doMove_game(Game* game, const char* move);
+
+/*Desfaz o ultimo movimento efetuado.
+	Parametros
+		Game* game	jogo
+	Retorno
+		1 se um movimento foi desfeito, 0 se o historico esta vazio
+*/
+CHESS_API int undoMove_game(Game* game);
+
+/*Analisa a situacao do jogo.
+	Parametros
+		Game* game	jogo
+	Retorno
+		situacao do jogo
+*/
+CHESS_API Gamesit sit_game(Game* game);
+
+/*Gera a mensagem de resultado de uma situacao de jogo.
+	Parametros
+		Gamesit sit	situacao
+	Retorno
+		mensagem, NULL se o jogo continua
+*/
+CHESS_API const char* str_sit(Gamesit sit);
+
+/*Escolhe um movimento pela metrica de ameacas do jogo interativo (rapida, sem busca). O movimento nao e efetuado.
+	Parametros
+		Game* game	jogo
+		char* move	recipiente com no minimo MOVE_SIZE caracteres
+	Retorno
+		1 se ha um movimento possivel, 0 caso contrario
+*/
+CHESS_API int moveAI_game(Game* game, char* move);
+
+/*Escolhe um movimento por busca alfa-beta, considerando as repeticoes do historico. O movimento nao e efetuado.
+	Parametros
+		Game* game	jogo
+		int depth	profundidade maxima, 0 para nenhum limite
+		long long nodes	numero maximo de nos, -1 para nenhum limite
+		long long time	tempo maximo em ms, -1 para nenhum limite
+		char* move	recipiente com no minimo MOVE_SIZE caracteres
+		int* score	recipiente para a pontuacao em centipeoes do ponto de vista do turno, NULL se nao usado
+	Retorno
+		1 se ha um movimento possivel, 0 caso contrario
+*/
+CHESS_API int search_game(Game* game, int depth, long long nodes, long long time, char* move, int* score);
+
+/*Analisa as melhores variantes da posicao atual (multi-PV): os n melhores movimentos, da melhor para a pior
+pontuacao, cada um com sua variante principal. A busca compartilha a tabela de transposicao de search_game.
+	Parametros
+		Game* game		jogo
+		int depth		profundidade maxima, 0 para nenhum limite
+		long long nodes		numero maximo de nos, -1 para nenhum limite
+		long long time		tempo maximo em ms, -1 para nenhum limite
+		int n			numero de variantes, de 1 a MAX_MULTIPV
+		int* scores		recipiente com n elementos para as pontuacoes em centipeoes do ponto de vista do turno
+		char (*pv)[PV_SIZE]	recipiente com n elementos para as variantes, movimentos separados por espaco
+	Retorno
+		numero de variantes, menor que n se ha menos movimentos possiveis, 0 se nenhum
+*/
+CHESS_API int analyze_game(Game* game, int depth, long long nodes, long long time, int n, int* scores, char (*pv)[PV_SIZE]);
+
+/*Define o tamanho da tabela de transposicao usada por search_game. A tabela e alocada na proxima busca.
+	Parametros
+		Game* game	jogo
+		size_t mb	tamanho em MB
+*/
+CHESS_API void setHash_game(Game* game, size_t mb);
+
+/*Associa ao jogo um cache de analise persistente, usado por search_game e analyze_game: um arquivo mapeado em
+memoria com os resultados das buscas, compartilhado por todos os processos que o abrem e mantido entre execucoes.
+Uma busca de profundidade limitada de uma posicao ja analisada ate essa profundidade e respondida pelo cache.
+	Parametros
+		Game* game		jogo
+		const char* path	caminho do arquivo, criado se nao existe; NULL desassocia o cache atual
+		size_t mb		tamanho em MB de um novo arquivo, 0 para o padrao (64 MB)
+	Retorno
+		1 em caso de sucesso, 0 se o arquivo nao pode ser criado ou aberto, ou e de outra versao
+*/
+CHESS_API int setCache_game(Game* game, const char* path, size_t mb);
+
+/*Lista os movimentos possiveis de um lote de posicoes, sem alocacoes por posicao, em paralelo nos lotes grandes.
+Os movimentos de todas as posicoes sao escritos em sequencia: os da posicao i de res[i].first a
+res[i].first+res[i].n-1. Cada movimento e gravado como codigo de 16 bits (bits 0 a 5: casa de origem, bits 6
+a 11: casa destino, casa rank*8+file, a1 = 0; bits 12 a 14: promocao, 0 nenhuma, 1 a 4 de cavalo a dama) e/ou
+em notacao algebrica simplificada. Como snprintf, retorna o total de movimentos mesmo que exceda m; nesse caso
+res e preenchido, mas nenhum movimento e escrito.
+	Parametros
+		const char* const* fen		posicoes em FEN, ou NULL
+		const unsigned char* packed	posicoes compactadas (PACKED_SIZE bytes cada), usadas se fen e NULL
+		int n				numero de posicoes
+		int threads			numero maximo de threads
+		QueryResult* res		recipiente com n elementos
+		unsigned short* codes		recipiente para os codigos, ou NULL
+		char (*moves)[MOVE_SIZE]	recipiente para os movimentos em notacao algebrica, ou NULL
+		long m				capacidade dos recipientes de movimentos
+	Retorno
+		numero total de movimentos
+*/
+CHESS_API long query_moves(const char* const* fen, const unsigned char* packed, int n, int threads, QueryResult* res, unsigned short* codes, char (*moves)[MOVE_SIZE], long m);
+
+/*Verifica se um movimento e possivel numa posicao testando somente esse movimento, sem gerar os demais.
+	Parametros
+		const char* fen		codigo FEN da posicao
+		const char* move	movimento
+	Retorno
+		1 se o movimento e possivel, 0 se nao e possivel, -1 se o codigo FEN e invalido
+*/
+CHESS_API int legal_move(const char* fen, const char* move);
+
+/*Abre um indice de aberturas (gerado pelo modo --index), mapeando-o em memoria. Um indice aberto pode ser
+consultado por varias threads ao mesmo tempo.
+	Parametros
+		const char* path	caminho
+	Retorno
+		indice, NULL se o arquivo nao pode ser lido ou nao e um indice desta versao
+*/
+CHESS_API Explorer* initialize_explorer(const char* path);
+
+/*Fecha um indice de aberturas.
+	Parametros
+		Explorer* ex	indice
+*/
+CHESS_API void finalize_explorer(Explorer* ex);
+
+/*Consulta as estatisticas dos movimentos jogados numa posicao do indice de aberturas, do mais ao menos jogado.
+Movimentos nao possiveis na posicao (colisao de chaves) sao descartados.
+	Parametros
+		Explorer* ex		indice
+		const char* fen		codigo FEN da posicao
+		ExplorerMove* moves	recipiente com m elementos; MAX_MOVES sempre basta
+		int m			capacidade
+	Retorno
+		numero de movimentos escritos, -1 se o codigo FEN e invalido
+*/
+CHESS_API int query_explorer(Explorer* ex, const char* fen, ExplorerMove* moves, int m);
+
+/*Converte o codigo de 16 bits de um movimento de query_moves para a notacao algebrica simplificada.
+	Parametros
+		unsigned short code	codigo
+		char* move		recipiente com no minimo MOVE_SIZE caracteres
+	Retorno
+		move
+*/
+CHESS_API char* str_code(unsigned short code, char* move);
+
+/*Soma os contadores de instrumentacao da thread atual aos totais do processo, zerando-os. Cada busca o faz
+ao terminar; threads que usam a biblioteca de outra forma devem chamar esta funcao antes de encerrar.
+*/
+CHESS_API void flush_stats(void);
+
+/*Gera uma linha com os contadores de instrumentacao do processo (totais mais os da thread atual), em pares
+nome valor: chamadas da geracao de movimentos e movimentos gerados, consultas de ameaca, movimentos efetuados
+e desfeitos, consultas e registros percorridos da tabela de repeticao, consultas e acertos da tabela de
+transposicao, nos de busca e alocacoes (numero e bytes) por subsistema. Vazia se compilada com NO_STATS.
+	Parametros
+		char* str	recipiente com no minimo STATS_SIZE caracteres
+	Retorno
+		str
+*/
+CHESS_API char* str_stats(char* str);
+
+/*Escreve os percentis (p50, p90, p99 e maximo, em ms) das latencias das decisoes da IA (search_game,
+moveAI_game e buscas das ferramentas): geracao de movimentos, avaliacao, restante da busca e total, por
+numero de pecas, e o total por numero de movimentos possiveis. Uma linha por histograma nao vazio.
+	Parametros
+		FILE* fp		arquivo
+		const char* prefix	prefixo de cada linha
+*/
+CHESS_API void print_latency(FILE* fp, const char* prefix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
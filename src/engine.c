@@ -0,0 +1,4043 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <math.h>
+#include <pthread.h>
+#include "engine.h"
+
+boolean strrmc(char* str, char c) {
+	char i;
+	for(i=0; str[i] != c && str[i] != '\0'; i++);
+	if(str[i] == '\0')
+		return FALSE;
+	do {
+		str[i] = str[i+1];
+		i++;
+	} while(str[i] != '\0');
+	return TRUE;
+}
+
+void initialize_arena(Arena* arena) {
+	memset(arena, 0, sizeof(Arena));
+}
+
+void finalize_arena(Arena* arena) {
+	char* chunk;
+	reset_arena(arena);
+	while(arena->first != NULL) {
+		chunk = arena->first;
+		arena->first = *(char**) chunk;
+		free(chunk);
+	}
+}
+
+void reset_arena(Arena* arena) {
+	void* big;
+	while(arena->big != NULL) {			//Blocos grandes: normalmente nenhum
+		big = arena->big;
+		arena->big = *(void**) big;
+		free(big);
+	}
+	memset(arena->free, 0, sizeof(arena->free));
+	arena->chunk = arena->first;
+	arena->used = 2*sizeof(char*);
+	arena->in_use = arena->peak = 0;
+}
+
+void* alloc_arena(Arena* arena, size_t n) {
+	int c;
+	size_t size;
+	char* p;
+	char* next;
+
+	for(c=0, size=16; c<ARENA_CLASSES && size < n+16; c++, size*=2);	//Classe: cabecalho de 16 bytes com o tamanho
+	if(c == ARENA_CLASSES) {				//Bloco grande: lista propria, liberada no reinicio
+		size = n+32;
+		p = (char*) malloc(size);		//Ponteiro para o seguinte, cabecalho e dados
+		COUNT_ALLOC(ALLOC_ARENA, size);
+		*(void**) p = arena->big;
+		arena->big = p;
+		p += 16;
+	}
+	else if(arena->free[c] != NULL) {			//Bloco livre da classe
+		p = (char*) arena->free[c] - 16;
+		arena->free[c] = *(void**) arena->free[c];
+	}
+	else {							//Bloco novo do pedaco atual
+		if(arena->chunk == NULL || arena->used + size > ARENA_CHUNK) {
+			next = arena->chunk != NULL ? *(char**) arena->chunk : arena->first;
+			if(next == NULL) {			//Novo pedaco, mantido ate finalize_arena
+				next = (char*) malloc(ARENA_CHUNK);
+				COUNT_ALLOC(ALLOC_ARENA, ARENA_CHUNK);
+				*(char**) next = NULL;
+				if(arena->chunk != NULL)
+					*(char**) arena->chunk = next;
+				else
+					arena->first = next;
+				arena->reserved += ARENA_CHUNK;
+			}
+			arena->chunk = next;
+			arena->used = 2*sizeof(char*);	//Blocos alinhados a 16 bytes
+		}
+		p = arena->chunk + arena->used;
+		arena->used += size;
+	}
+	*(size_t*) p = size;
+	arena->in_use += size;
+	if(arena->in_use > arena->peak)
+		arena->peak = arena->in_use;
+	return p + 16;
+}
+
+void* realloc_arena(Arena* arena, void* p, size_t n) {
+	size_t size;
+	void* q;
+	if(p == NULL)
+		return alloc_arena(arena, n);
+	size = *(size_t*) ((char*) p - 16);
+	if(n+16 <= size)					//Cabe na classe atual
+		return p;
+	q = alloc_arena(arena, n);
+	memcpy(q, p, size-16);
+	free_arena(arena, p);
+	return q;
+}
+
+void free_arena(Arena* arena, void* p) {
+	int c;
+	size_t size;
+	void** big;
+	if(p == NULL)
+		return;
+	size = *(size_t*) ((char*) p - 16);
+	arena->in_use -= size;
+	for(c=0; c<ARENA_CLASSES && (size_t) 16 << c != size; c++);
+	if(c < ARENA_CLASSES) {
+		*(void**) p = arena->free[c];
+		arena->free[c] = p;
+		return;
+	}
+	for(big = &arena->big; *big != (char*) p - 32; big = (void**) *big);	//Bloco grande: retira da lista
+	*big = *(void**) *big;
+	free((char*) p - 32);
+}
+
+Position* initialize_position(char file, char rank, char x, Arena* arena) {
+	Position* pos;
+	pos = (Position*) alloc_arena(arena, sizeof(Position));
+	pos->file = file;
+	pos->rank = rank;
+	pos->x = x;
+	return pos;
+}
+
+void finalize_position(Position* pos, Arena* arena) {
+	free_arena(arena, pos);
+}
+
+char cmp_position(Position* p1, Position* p2) {
+	if(p1->file != p2->file)
+		return p1->file - p2->file;
+	if(p1->rank != p2->rank)
+		return p1->rank - p2->rank;
+	return genName_piece(p1->x) - genName_piece(p2->x);	//Posicoes de peao em promocao
+}
+
+char median(Position** v, char n) {
+	char mid;
+	mid = n/2;
+
+	if(cmp_position(v[0], v[mid]) >= 0 && cmp_position(v[0], v[n-1]) <= 0) return 0;
+	if(cmp_position(v[0], v[n-1]) >= 0 && cmp_position(v[0], v[mid]) <= 0) return 0;
+
+	if(cmp_position(v[mid], v[0]) >= 0 && cmp_position(v[mid], v[n-1]) <= 0) return mid;
+	if(cmp_position(v[mid], v[n-1]) >= 0 && cmp_position(v[mid], v[0]) <= 0) return mid;
+
+	if(cmp_position(v[n-1], v[mid]) >= 0 && cmp_position(v[mid], v[n-1]) <= 0) return n-1;
+	//if(cmp_position(v[n-1], v[0]) >= 0 && cmp_position(v[n-1], v[mid]) <= 0)
+	return n-1;;
+}
+
+void sort_position(Position** pos, char n) {
+	char i, j;
+	Position* pivot;
+	Position* tmp;
+
+	if(n < 2)		//Se o vetor possui menos que 2 elementos
+		return;
+
+	i = median(pos, n);	//Pivo = mediana entre 3 elementos: o do comeco, do meio e do fim
+	pivot = pos[i];
+	pos[i] = pos[n-1];
+	pos[n-1] = pivot;
+	i = 0;
+	j = n-2;
+	do {							//Arruma o vetor
+		while(cmp_position(pos[i], pivot) < 0)
+			i++;
+		while(cmp_position(pos[j], pivot) >= 0 && j >= 0)
+			j--;
+		if(i<j) {
+			tmp = pos[i];
+			pos[i] = pos[j];
+			pos[j] = tmp;
+		}
+	} while(i < j);
+	pos[n-1] = pos[i];
+	pos[i] = pivot;
+
+	sort_position(pos, i);		//Chama recursivamente
+	sort_position(pos+i+1, n-i-1);
+}
+
+boolean search_position(Position** v, char n, Position* key) {
+	char i, mid;
+	char c;
+
+	c = TRUE;	//Se nenhuma comparacao for feita, retorna FALSE
+	i = 0;		//inicio
+	n--;		//fim
+	mid = n/2;	//meio
+	while(i <= n && (c = cmp_position(v[mid], key))) {
+		i = c > 0 ? i : mid+1;
+		n = c > 0 ? mid-1 : n;
+		mid = (n+i)/2;
+	}
+	return !c;
+}
+
+Position* cpy_position(Position* dest, Position* src) {
+	if(src == NULL)
+		return NULL;
+	if(dest == NULL) {
+		dest = (Position*) malloc(sizeof(Position));
+		COUNT_ALLOC(ALLOC_CHESS, sizeof(Position));
+	}
+	dest->file = src->file;
+	dest->rank = src->rank;
+	dest->x = src->x;
+	return dest;
+}
+
+Piece* initialize_piece(Piecename id, char file, char rank, Arena* arena) {
+	Piece* piece;
+	piece = (Piece*) alloc_arena(arena, sizeof(Piece));
+	piece->id = id;
+	piece->pos = (Position**) alloc_arena(arena, sizeof(Position*));
+	piece->pos[0] = initialize_position(file, rank, 0, arena);	//Posicao inicial
+	piece->m = 0;						//0 movimentos calculados
+	return piece;
+}
+
+void finalize_piece(Piece* piece, Arena* arena) {
+	char i;
+	for(i=0; i<=piece->m; i++)
+		finalize_position(piece->pos[i], arena);
+	free_arena(arena, piece->pos);
+	free_arena(arena, piece);
+}
+
+Piecename genName_piece(char c) {
+	switch(c) {
+		case 'K': return WK;
+		case 'k': return BK;
+		case 'Q': return WQ;
+		case 'q': return BQ;
+		case 'R': return WR;
+		case 'r': return BR;
+		case 'B': return WB;
+		case 'b': return BB;
+		case 'N': return WN;
+		case 'n': return BN;
+		case 'P': return WP;
+		case 'p': return BP;
+		default: return 0;
+	}
+}
+
+char genChar_piece(Piecename id) {
+	switch(id) {
+		case WK: return 'K';
+		case BK: return 'k';
+		case WQ: return 'Q';
+		case BQ: return 'q';
+		case WR: return 'R';
+		case BR: return 'r';
+		case WB: return 'B';
+		case BB: return 'b';
+		case WN: return 'N';
+		case BN: return 'n';
+		case WP: return 'P';
+		case BP: return 'p';
+		default: return 0;
+	}
+}
+
+int score_piece(Piecename id) {
+	switch(id) {
+
+		case WK:
+		case BK: return 50000;
+
+		case WQ:
+		case BQ: return 1000;
+
+		case WR:
+		case BR: return 550;
+
+		case WB:
+		case BB:
+		case WN:
+		case BN: return 325;
+
+		case WP:
+		case BP: return 100;
+
+		default: return 0;
+	}
+}
+
+boolean iswhite(Piecename id) {
+	return !(id%2);
+}
+
+boolean isblack(Piecename id) {
+	return id%2;
+}
+
+boolean isking(Piecename id) {
+	return id == WK || id == BK;
+}
+
+boolean isqueen(Piecename id) {
+	return id == WQ || id == BQ;
+}
+
+boolean isqueenMove(Piecename id) {
+	return id >= BB && id <= WQ;
+}
+
+boolean isrook(Piecename id) {
+	return id == WR || id == BR;
+}
+
+boolean ispawn(Piecename id) {
+	return id== WP || id == BP;
+}
+
+Piecename invert_piece(Piecename id) {
+	return id + (id%2 ? 1 : -1);
+}
+
+boolean onturn(Piece* piece, Chess* chess) {
+	return piece->id%2 == chess->turn;
+}
+
+boolean moved(Piece* pawn) {
+	return pawn->pos[0]->rank%6 != pawn->id-1;
+}
+
+char cmp_piece(Piece* p1, Piece* p2) {
+	if(p1->id != p2->id)
+		return p1->id - p2->id;
+	else
+		if(p1->pos[0]->file != p2->pos[0]->file)
+			return p1->pos[0]->file - p2->pos[0]->file;
+		else
+			return p1->pos[0]->rank - p2->pos[0]->rank;
+}
+
+Piece* cpy_piece(Piece* dest, Piece* src, Arena* arena) {
+	char i;
+	if(src == NULL)
+		return NULL;
+	if(dest == NULL)
+		dest = (Piece*) alloc_arena(arena, sizeof(Piece));
+	dest->id = src->id;
+	dest->m = src->m;
+	dest->pos = (Position**) alloc_arena(arena, (src->m+1)*sizeof(Position*));
+	for(i=0; i<=src->m; i++)
+		dest->pos[i] = initialize_position(src->pos[i]->file, src->pos[i]->rank, src->pos[i]->x, arena);
+	return dest;
+}
+
+Piece** searchPositions_piece(Position* key, Piece** piece, char n, char k) {
+	char i, j;		//Contadores
+	Piece** res;		//Resultado
+
+	res = NULL;
+	j = 0;							//Passa pelo vetor enquanto nao encontra peca de tipo diferente
+	for(i=0; i<n && piece[i]->id == piece[k]->id; i++) {				//Nao busca na peca chave
+		if(i != k && search_position(piece[i]->pos+1, piece[i]->m, key)) {
+			res = (Piece**) realloc(res, (j+1)*sizeof(Piece*));		//Chave encontrada
+			res[j++] = piece[i];
+		}
+	}
+	res = (Piece**) realloc(res, (j+1)*sizeof(Piece*));			//Terminador
+	res[j] = NULL;
+	return res;
+}
+
+boolean insertMove_piece(Piece* piece, Chess* chess, boolean tk, char file, char rank) {
+	if(chess->board[rank][file] != NULL) {					//Posicao nao vazia
+		if(chess->board[rank][file]->id%2 != piece->id%2 && (!tk || !threatKing(chess, piece, file, rank))) {//Verifica a cor
+			piece->pos = (Position**) realloc_arena(chess->arena, piece->pos, (++piece->m+1)*sizeof(Position*));	//Movimento de captura
+			piece->pos[piece->m] = initialize_position(file, rank, 'x', chess->arena);
+		}
+		return FALSE;
+	}
+	if(!tk || !threatKing(chess, piece, file, rank)) {				//Posicao vazia
+		piece->pos = (Position**) realloc_arena(chess->arena, piece->pos, (++piece->m+1)*sizeof(Position*));
+		piece->pos[piece->m] = initialize_position(file, rank, 0, chess->arena);
+	}
+	return TRUE;
+}
+
+/*Calcula os movimentos possiveis do rei, especializada pela cor: as casas e os caracteres do roque sao constantes.
+	Parametros
+		Piece* king		rei
+		Chess* chess		registro Chess
+		boolean tk		verifica se o movimento deixa o rei em xeque
+		const char player	cor do rei, constante
+*/
+SPECIALIZED void king_color(Piece* king, Chess* chess, boolean tk, const char player) {
+	const char home = player ? 7 : 0;		//Linha do roque
+	char i, j;
+
+	for(i=king->pos[0]->rank-1; i<=king->pos[0]->rank+1; i++)		//Posicoes ao redor do rei
+		for(j=king->pos[0]->file-1; j<=king->pos[0]->file+1; j++) {
+			if(i<0 || i>=8 || j<0 || j>=8 || (i == king->pos[0]->rank && j == king->pos[0]->file))//Esta fora ou e a mesma pos.
+				continue;
+			insertMove_piece(king, chess, tk, j, i);
+		}
+
+	if(tk && !threatKing(chess, king, king->pos[0]->file, king->pos[0]->rank)) {		//Roque
+		if((NULL != strchr(chess->castling, player ? 'q' : 'Q')) && chess->board[home][3] == NULL && chess->board[home][2] == NULL && chess->board[home][1] == NULL && !threatKing(chess, king, 3, home))
+			insertMove_piece(king, chess, tk, 2, home);
+		if((NULL != strchr(chess->castling, player ? 'k' : 'K')) && chess->board[home][5] == NULL && chess->board[home][6] == NULL && !threatKing(chess, king, 5, home))
+			insertMove_piece(king, chess, tk, 6, home);
+	}
+}
+
+void rook(Piece* rook, Chess* chess, boolean tk) {
+	char i;
+
+	for(i=rook->pos[0]->file-1; i>=0 && insertMove_piece(rook, chess, tk, i, rook->pos[0]->rank); i--);	//Esquerda
+	for(i=rook->pos[0]->rank+1; i<8 && insertMove_piece(rook, chess, tk, rook->pos[0]->file, i); i++);	//Para cima
+	for(i=rook->pos[0]->rank-1; i>=0 && insertMove_piece(rook, chess, tk, rook->pos[0]->file, i); i--);	//Para baixo
+	for(i=rook->pos[0]->file+1; i<8 && insertMove_piece(rook, chess, tk, i, rook->pos[0]->rank); i++);	//Direita
+}
+
+void bishop(Piece* bishop, Chess* chess, boolean tk) {
+	char i, j;
+
+	//Diagonal: Para cima e para a esquerda
+	for(i=bishop->pos[0]->rank+1, j=bishop->pos[0]->file-1; i<8 && j>=0 && insertMove_piece(bishop, chess, tk, j, i); i++, j--);
+	//Diagonal: Para baixo e para a esquerda
+	for(i=bishop->pos[0]->rank-1, j=bishop->pos[0]->file-1; i>=0 && j>=0 && insertMove_piece(bishop, chess, tk, j, i); i--, j--);
+	//Diagonal: Para cima e para a direita
+	for(i=bishop->pos[0]->rank+1, j=bishop->pos[0]->file+1; i<8 && j<8 && insertMove_piece(bishop, chess, tk, j, i); i++, j++);
+	//Diagonal: Para baixo e para a direita
+	for(i=bishop->pos[0]->rank-1, j=bishop->pos[0]->file+1; i>=0 && j<8 && insertMove_piece(bishop, chess, tk, j, i); i--, j++);
+}
+
+void knight(Piece* knight, Chess* chess, boolean tk) {
+	char i, j;
+	char rank, file;
+
+	for(i=-2; i<=2; i++) {
+		if(i) {	//i diferente de zero
+			rank = knight->pos[0]->rank+i;	//Anda 1 ou 2 linhas, para baixo ou para cima
+			for(j=-2; j<=2; j++)
+				if(j && (j-i)%2) {	//j diferente de zero e modulo de j diferente de modulo de i
+					file = knight->pos[0]->file+j;	//Anda 1 ou 2 colunas, esquerda ou direita
+					if(rank>=0 && rank<8 && file>=0 && file<8)	//Linha e coluna valida
+						insertMove_piece(knight, chess, tk, file, rank);
+				}
+		}
+	}
+}
+
+/*Calcula os movimentos possiveis de um peao, especializada pela cor: a direcao do avanco e a linha inicial sao
+constantes.
+	Parametros
+		Piece* pawn		peao
+		Chess* chess		registro Chess
+		boolean tk		verifica se o movimento deixa o rei em xeque
+		const char player	cor do peao, constante
+*/
+SPECIALIZED void pawn_color(Piece* pawn, Chess* chess, boolean tk, const char player) {
+	const char i = player ? -1 : 1;		//Cor do peao: anda para cima ou para baixo
+	char j;
+
+	if(pawn->pos[0]->rank+i < 0 || pawn->pos[0]->rank+i >= 8)	//Peao na primeira ou na ultima linha: nenhum movimento
+		return;
+
+	for(j=-1; j<=1; j++) {							//Verifica as 3 posicoes de movimento na proxima linha
+		if(pawn->pos[0]->file+j >= 0 && pawn->pos[0]->file+j < 8) {
+
+			//En passant
+			if(chess->en_passant.x == 'e' && pawn->pos[0]->file+j == chess->en_passant.file && pawn->pos[0]->rank+i == chess->en_passant.rank) {
+				if(tk && threatKing(chess, pawn, chess->en_passant.file, chess->en_passant.rank))	//Ameaca ao rei
+					continue;
+				pawn->pos = (Position**) realloc_arena(chess->arena, pawn->pos, (++pawn->m+1)*sizeof(Position*));
+				pawn->pos[pawn->m] = initialize_position(chess->en_passant.file, chess->en_passant.rank, 'e', chess->arena);
+				continue;
+			}
+
+			//(j diferente de zero e posicao nao vazia: possivel captura) || (j igual a zero (1 casa a frente) e posicao vazia)
+			if((j && chess->board[pawn->pos[0]->rank+i][pawn->pos[0]->file+j] != NULL) || (!j && chess->board[pawn->pos[0]->rank+i][pawn->pos[0]->file] == NULL)) {
+				insertMove_piece(pawn, chess, tk, pawn->pos[0]->file + j, pawn->pos[0]->rank + i);
+				if(!((pawn->pos[0]->rank+i)%7)) {//Para linha 0 ou 7 -> Promocao
+					pawn->pos[pawn->m]->x = genChar_piece(WN);
+					insertMove_piece(pawn, chess, tk, pawn->pos[0]->file + j, pawn->pos[0]->rank + i);
+					pawn->pos[pawn->m]->x = genChar_piece(WB);
+					insertMove_piece(pawn, chess, tk, pawn->pos[0]->file + j, pawn->pos[0]->rank + i);
+					pawn->pos[pawn->m]->x = genChar_piece(WR);
+					insertMove_piece(pawn, chess, tk, pawn->pos[0]->file + j, pawn->pos[0]->rank + i);
+					pawn->pos[pawn->m]->x = genChar_piece(WQ);
+				}
+			}
+		}
+	}
+
+	//Avanco de duas casas
+	if(pawn->pos[0]->rank == (player ? 6 : 1) && chess->board[pawn->pos[0]->rank+i][pawn->pos[0]->file] == NULL && chess->board[pawn->pos[0]->rank+2*i][pawn->pos[0]->file] == NULL)
+		insertMove_piece(pawn, chess, tk, pawn->pos[0]->file, pawn->pos[0]->rank + 2*i);
+}
+
+static const signed char knight_state[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};	//Saltos do cavalo (linha, coluna)
+static const signed char dir_state[8][2] = {{0, -1}, {1, 0}, {-1, 0}, {0, 1}, {1, -1}, {-1, -1}, {1, 1}, {-1, 1}};	//Direcoes da torre, depois do bispo
+
+/*Verifica se uma casa de um registro Chess e atacada por alguma peca de uma cor, especializada pela cor: testes
+diretos das casas de peoes, cavalos e rei e dos raios das pecas deslizantes, como em attacked_color.
+	Parametros
+		Chess* chess		registro Chess
+		char file		coluna
+		char rank		linha
+		const char player	cor das pecas atacantes, constante: 0 - brancas, 1 - pretas
+	Retorno
+		TRUE se atacada, FALSE caso contrario
+*/
+SPECIALIZED boolean threat_color(Chess* chess, char file, char rank, const char player) {
+	int i, r, f;
+	Piece* piece;
+
+	r = rank + (player ? 1 : -1);			//Peoes: atacam a diagonal a frente
+	if(r >= 0 && r < 8)
+		for(f=file-1; f<=file+1; f+=2)
+			if(f >= 0 && f < 8 && (piece = chess->board[r][f]) != NULL && piece->id == WP-player)
+				return TRUE;
+
+	for(i=0; i<8; i++) {				//Cavalos e rei
+		r = rank + knight_state[i][0];
+		f = file + knight_state[i][1];
+		if(r >= 0 && r < 8 && f >= 0 && f < 8 && (piece = chess->board[r][f]) != NULL && piece->id == WN-player)
+			return TRUE;
+		r = rank + dir_state[i][0];
+		f = file + dir_state[i][1];
+		if(r >= 0 && r < 8 && f >= 0 && f < 8 && (piece = chess->board[r][f]) != NULL && piece->id == WK-player)
+			return TRUE;
+	}
+
+	for(i=0; i<8; i++)				//Torres, bispos e damas: primeira peca de cada direcao
+		for(r=rank+dir_state[i][0], f=file+dir_state[i][1]; r >= 0 && r < 8 && f >= 0 && f < 8; r+=dir_state[i][0], f+=dir_state[i][1])
+			if((piece = chess->board[r][f]) != NULL) {
+				if(piece->id == WQ-player || piece->id == (i < 4 ? WR : WB)-player)
+					return TRUE;
+				break;
+			}
+	return FALSE;
+}
+
+boolean threat(Chess* chess, char file, char rank, char player) {
+	COUNT(threats, 1);
+	return player ? threat_color(chess, file, rank, 1) : threat_color(chess, file, rank, 0);
+}
+
+boolean threatKing(Chess* chess, Piece* piece, char file, char rank) {
+	char player;
+	char file_tmp;
+	char rank_tmp;
+	boolean res;
+	Piece* piece_tmp;
+	Piece* passant;
+
+	player = isblack(piece->id);
+	file_tmp = piece->pos[0]->file;		//Efetua o movimento no tabuleiro
+	rank_tmp = piece->pos[0]->rank;
+	piece_tmp = chess->board[rank][file];
+	passant = NULL;
+	if(ispawn(piece->id) && file != file_tmp && piece_tmp == NULL) {	//En passant: o peao capturado tambem sai da linha
+		passant = chess->board[(int) rank_tmp][(int) file];
+		chess->board[(int) rank_tmp][(int) file] = NULL;
+	}
+	chess->board[rank][file] = NULL;
+	swapPiece_chess(chess, file, rank, file_tmp, rank_tmp);
+	res = threat(chess, chess->king[player]->pos[0]->file, chess->king[player]->pos[0]->rank, !player);
+	swapPiece_chess(chess, file, rank, file_tmp, rank_tmp);				//Desfaz o movimento
+	chess->board[rank][file] = piece_tmp;
+	if(passant != NULL)
+		chess->board[(int) rank_tmp][(int) file] = passant;
+	return res;
+}
+
+/*Verifica se uma casa de um tabuleiro Fen e atacada por alguma peca de uma cor.
+	Parametros
+		const Fen* f	campos do FEN
+		int file	coluna
+		int rank	linha
+		char player	cor das pecas atacantes: 0 - brancas, 1 - pretas
+	Retorno
+		TRUE se atacada, FALSE caso contrario
+*/
+static boolean attacked_fen(const Fen* f, int file, int rank, char player) {
+	static const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+	static const int dir[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+	int i, d, x, y, id;
+
+	for(i=0; i<8; i++) {
+		x = file + knight[i][0];		//Cavalos
+		y = rank + knight[i][1];
+		if(x >= 0 && x < 8 && y >= 0 && y < 8 && f->board[y][x] == WN - player)
+			return TRUE;
+		for(d=1; ; d++) {			//Reis, torres, bispos e damas
+			x = file + d*dir[i][0];
+			y = rank + d*dir[i][1];
+			if(x < 0 || x >= 8 || y < 0 || y >= 8)
+				break;
+			if((id = f->board[y][x]) == EMPTY)
+				continue;
+			if(id%2 == player && (id == WK - player ? d == 1 : id == WQ - player || id == (i < 4 ? WR : WB) - player))
+				return TRUE;
+			break;
+		}
+	}
+	y = rank + (player ? 1 : -1);			//Peoes
+	for(x=file-1; x<=file+1; x+=2)
+		if(x >= 0 && x < 8 && y >= 0 && y < 8 && f->board[y][x] == WP - player)
+			return TRUE;
+	return FALSE;
+}
+
+/*Le um numero decimal de um codigo FEN.
+	Parametros
+		const char* fen		codigo FEN
+		int* i			indice, avancado ate o fim do numero
+		int digits		numero maximo de digitos
+		int* v			recipiente para o valor
+	Retorno
+		TRUE se ha entre 1 e digits digitos, FALSE caso contrario
+*/
+static boolean number_fen(const char* fen, int* i, int digits, int* v) {
+	int n;
+	for(*v=n=0; isdigit(fen[*i]) && n<digits; (*i)++, n++)
+		*v = 10*(*v) + fen[*i]-'0';
+	return n && !isdigit(fen[*i]);
+}
+
+boolean parseFen(const char* fen, Fen* f) {
+	static const char* castling = "KQkq";
+	int i, j, rank, file, id;
+	boolean digit;
+
+	rank = 7;
+	file = 0;
+	digit = FALSE;
+	for(i=0; fen[i] != ' '; i++) {				//Tabuleiro
+		if(fen[i] == '/') {
+			if(file != 8 || --rank < 0)
+				return FALSE;
+			file = 0;
+			digit = FALSE;
+			continue;
+		}
+		if(fen[i] >= '1' && fen[i] <= '8' && !digit) {	//Casas vazias: digitos consecutivos nao sao validos
+			if(file + fen[i]-'0' > 8)
+				return FALSE;
+			for(j=fen[i]-'0'; j; j--)
+				f->board[rank][file++] = EMPTY;
+			digit = TRUE;
+			continue;
+		}
+		id = genName_piece(fen[i]);
+		if(!id || file >= 8)
+			return FALSE;
+		f->board[rank][file++] = id;
+		digit = FALSE;
+	}
+	if(rank || file != 8)
+		return FALSE;
+
+	if((fen[++i] != 'w' && fen[i] != 'b') || fen[i+1] != ' ')	//Turno
+		return FALSE;
+	f->turn = fen[i] == 'b';
+	i += 2;
+
+	j = 0;							//Roque, na ordem KQkq e sem repeticao
+	if(fen[i] == '-')
+		i++;
+	else
+		for(id=0; fen[i] != ' '; i++, id++) {
+			for(; castling[id] && castling[id] != fen[i]; id++);
+			if(!castling[id])
+				return FALSE;
+			f->castling[j++] = fen[i];
+		}
+	f->castling[j] = '\0';
+	if(fen[i++] != ' ')
+		return FALSE;
+
+	f->en_passant.x = 0;					//En passant
+	if(fen[i] == '-')
+		i++;
+	else {
+		if(fen[i] < 'a' || fen[i] > 'h' || fen[i+1] < '1' || fen[i+1] > '8')
+			return FALSE;
+		f->en_passant.file = fen[i]-'a';
+		f->en_passant.rank = fen[i+1]-'1';
+		f->en_passant.x = 'e';
+		i += 2;
+	}
+	if(fen[i++] != ' ')
+		return FALSE;
+
+	if(!number_fen(fen, &i, 3, &f->mid_turns) || fen[i++] != ' ')	//Contadores
+		return FALSE;
+	if(!number_fen(fen, &i, 9, &f->n_turns) || fen[i])
+		return FALSE;
+
+	return validFen(f);
+}
+
+boolean validFen(const Fen* f) {
+	static const char* castling = "KQkq";
+	int i, rank, file, id, n[13], king[2];
+	const char* c;
+
+	memset(n, 0, sizeof(n));
+	for(rank=0; rank<8; rank++)				//Pecas
+		for(file=0; file<8; file++) {
+			if((id = f->board[rank][file]) == EMPTY)
+				continue;
+			if(id < BP || id > WK || (ispawn(id) && (rank == 0 || rank == 7)))
+				return FALSE;
+			if(isking(id))
+				king[isblack(id)] = rank*8 + file;
+			n[id]++;
+		}
+	if(n[WK] != 1 || n[BK] != 1 || n[WP] > 8 || n[BP] > 8)
+		return FALSE;
+	if(n[WP]+n[WN]+n[WB]+n[WR]+n[WQ] > 15 || n[BP]+n[BN]+n[BB]+n[BR]+n[BQ] > 15)
+		return FALSE;
+	if(f->turn != 0 && f->turn != 1)
+		return FALSE;
+
+	for(i=0; f->castling[i]; i++) {				//Roque: rei e torre nas posicoes iniciais
+		if(i >= 4 || NULL == (c = strchr(castling, f->castling[i])))
+			return FALSE;
+		id = c - castling;
+		rank = id < 2 ? 0 : 7;
+		if(f->board[rank][4] != (id < 2 ? WK : BK) || f->board[rank][id%2 ? 0 : 7] != (id < 2 ? WR : BR))
+			return FALSE;
+	}
+
+	if(f->en_passant.x) {					//En passant: casa vazia atras de um peao que avancou duas casas
+		file = f->en_passant.file;
+		rank = f->en_passant.rank;
+		if(file < 0 || file >= 8 || rank != (f->turn ? 2 : 5))
+			return FALSE;
+		if(f->board[rank][file] != EMPTY || f->board[rank + (f->turn ? -1 : 1)][file] != EMPTY || f->board[rank + (f->turn ? 1 : -1)][file] != (f->turn ? WP : BP))
+			return FALSE;
+	}
+
+	//Contadores: meios-turnos cabem num char, turnos a partir de 1
+	if(f->mid_turns < 0 || f->mid_turns > SCHAR_MAX || f->n_turns < 1)
+		return FALSE;
+
+	return !attacked_fen(f, king[!f->turn]%8, king[!f->turn]/8, f->turn);	//O rei fora do turno nao pode estar em xeque
+}
+
+Chess* initialize_chess(char* fen) {
+	Chess* chess;
+	chess = (Chess*) malloc(sizeof(Chess));
+	COUNT_ALLOC(ALLOC_CHESS, sizeof(Chess));
+	if(!load_chess(chess, fen, NULL)) {
+		free(chess);
+		return NULL;
+	}
+	return chess;
+}
+
+/*Atualiza os contadores de material de uma peca que entra ou sai do tabuleiro.
+	Parametros
+		Chess* chess	registro Chess
+		Piecename id	id da peca
+		char file	coluna
+		char rank	linha
+		int d		1 se a peca entra, -1 se sai
+*/
+static void material_chess(Chess* chess, Piecename id, char file, char rank, int d) {
+	chess->material[id] += d;
+	if(id == WB || id == BB)
+		chess->bishops[isblack(id)][(file+rank)%2] += d;
+}
+
+/*Carrega os campos de uma posicao valida num registro Chess ja alocado (e vazio).
+	Parametros
+		Chess* chess	registro Chess
+		const Fen* f	campos da posicao
+		Arena* arena	memoria do jogo, NULL para uma arena propria
+*/
+static void build_chess(Chess* chess, const Fen* f, Arena* arena) {
+	char i, j;
+
+	chess->own_arena = arena == NULL;				//Memoria do jogo
+	if(chess->own_arena) {
+		arena = (Arena*) malloc(sizeof(Arena));
+		COUNT_ALLOC(ALLOC_CHESS, sizeof(Arena));
+		initialize_arena(arena);
+	}
+	chess->arena = arena;
+
+	chess->n_pieces = 0;
+	memset(chess->material, 0, sizeof(chess->material));
+	memset(chess->bishops, 0, sizeof(chess->bishops));
+	for(i=0; i<8; i++)
+		for(j=0; j<8; j++) {
+			if(f->board[i][j] == EMPTY) {
+				chess->board[i][j] = NULL;
+				continue;
+			}
+			chess->board[i][j] = initialize_piece(f->board[i][j], j, i, chess->arena);	//Ha uma peca na posicao
+			if(isking(f->board[i][j]))
+				chess->king[isblack(f->board[i][j])] = chess->board[i][j];
+			chess->n_pieces++;
+			material_chess(chess, f->board[i][j], j, i, 1);
+		}
+	chess->check = -1;
+
+	chess->turn = f->turn;						//Turno
+	chess->castling = (char*) alloc_arena(arena, 5*sizeof(char));	//Roque
+	strcpy(chess->castling, f->castling);
+	cpy_position(&chess->en_passant, (Position*) &f->en_passant);	//En passant
+	chess->mid_turns = f->mid_turns;				//Numero de meios-turnos
+	chess->n_turns = f->n_turns;					//Numero de turnos
+
+	chess->history = (uint64_t*) alloc_arena(arena, sizeof(uint64_t));	//Historico com a posicao inicial
+	chess->history[0] = key_chess(chess);
+	chess->n_history = 1;
+
+	updateMovesPositions_chess(chess, chess->turn);	//Calculo dos movimentos possiveis para as pecas no turno
+}
+
+boolean load_chess(Chess* chess, char* fen, Arena* arena) {
+	Fen f;
+	if(!parseFen(fen, &f))
+		return FALSE;
+	build_chess(chess, &f, arena);
+	return TRUE;
+}
+
+void finalize_chess(Chess* chess) {
+	clear_chess(chess);
+	free(chess);
+}
+
+void clear_chess(Chess* chess) {
+	if(chess->own_arena) {			//Toda a memoria do jogo esta na arena: nada a percorrer
+		finalize_arena(chess->arena);
+		free(chess->arena);
+	}
+	else
+		reset_arena(chess->arena);
+}
+
+/*Escreve um inteiro nao negativo em decimal.
+	Parametros
+		char* str	destino
+		int v		inteiro
+	Retorno
+		posicao seguinte ao ultimo digito
+*/
+static char* digits_fen(char* str, int v) {
+	char tmp[12];
+	int n;
+	n = 0;
+	do {
+		tmp[n++] = v%10 + '0';
+		v /= 10;
+	} while(v);
+	while(n)
+		*str++ = tmp[--n];
+	return str;
+}
+
+char* writeFen(const Fen* f, char* fen) {
+	char i, j, k;
+	char* p;
+
+	p = fen;
+	for(i=7; i>=0; i--) {					//Tabuleiro
+		for(j=0; j<8; j++) {
+			if(f->board[i][j] != EMPTY)		//Peca
+				*p++ = genChar_piece(f->board[i][j]);
+			else {					//Posicao vazia: contagem de posicoes vazias consecutivas na mesma linha
+				for(k=0; j<8 && f->board[i][j] == EMPTY; j++, k++);
+				*p++ = k+'0';
+				j--;
+			}
+		}
+		*p++ = i ? '/' : ' ';				//Outra linha
+	}
+	*p++ = f->turn ? 'b' : 'w';				//Turno
+	*p++ = ' ';
+	for(i=0; f->castling[i]; i++)				//Roque
+		*p++ = f->castling[i];
+	if(!i)
+		*p++ = '-';
+	*p++ = ' ';
+	if(f->en_passant.x) {					//Casa alvo para realizar um en passant
+		*p++ = f->en_passant.file + 'a';
+		*p++ = f->en_passant.rank + '1';
+	}
+	else
+		*p++ = '-';
+	*p++ = ' ';
+	p = digits_fen(p, f->mid_turns);			//Numero de meios-turnos
+	*p++ = ' ';
+	p = digits_fen(p, f->n_turns);				//Numero de turnos
+	*p = '\0';
+	return fen;
+}
+
+void getFen_chess(Chess* chess, Fen* f) {
+	char i, j;
+	for(i=0; i<8; i++)
+		for(j=0; j<8; j++)
+			f->board[i][j] = chess->board[i][j] != NULL ? chess->board[i][j]->id : EMPTY;
+	f->turn = chess->turn;
+	strcpy(f->castling, chess->castling);
+	cpy_position(&f->en_passant, &chess->en_passant);
+	f->mid_turns = (unsigned char) chess->mid_turns;
+	f->n_turns = chess->n_turns;
+}
+
+char* genFen_chess(Chess* chess, char* fen) {
+	Fen f;
+	getFen_chess(chess, &f);
+	return writeFen(&f, fen);
+}
+
+void swapPiece_chess(Chess* chess, char file1, char rank1, char file2, char rank2) {
+	Piece* tmp;
+	if(chess->board[rank1][file1] != NULL) {
+		chess->board[rank1][file1]->pos[0]->file = file2;
+		chess->board[rank1][file1]->pos[0]->rank = rank2;
+	}
+	if(chess->board[rank2][file2] != NULL) {
+		chess->board[rank2][file2]->pos[0]->file = file1;
+		chess->board[rank2][file2]->pos[0]->rank = rank1;
+	}
+	tmp = chess->board[rank1][file1];
+	chess->board[rank1][file1] = chess->board[rank2][file2];
+	chess->board[rank2][file2] = tmp;
+}
+
+/*Calcula os movimentos possiveis de uma peca, especializada pela cor: a funcao de movimentacao e escolhida pelo
+tipo da peca, com chamadas diretas.
+	Parametros
+		Piece* piece		peca
+		Chess* chess		registro Chess
+		const char player	cor da peca, constante
+*/
+SPECIALIZED void genPiece_color(Piece* piece, Chess* chess, const char player) {
+	char i;
+	for(i=1; i<=piece->m; i++)				//Apaga os movimentos anteriores
+		finalize_position(piece->pos[i], chess->arena);
+	piece->m = 0;
+	switch(piece->id + player) {			//Geracao dos movimentos
+		case WP: pawn_color(piece, chess, TRUE, player);
+			 break;
+		case WN: knight(piece, chess, TRUE);
+			 break;
+		case WB: bishop(piece, chess, TRUE);
+			 break;
+		case WR: rook(piece, chess, TRUE);
+			 break;
+		case WQ: rook(piece, chess, TRUE);
+			 bishop(piece, chess, TRUE);
+			 break;
+		case WK: king_color(piece, chess, TRUE, player);
+			 break;
+	}
+	COUNT(gen_moves, piece->m);
+	sort_position(piece->pos+1, piece->m);		//Ordenacao
+}
+
+/*Calcula os movimentos possiveis das pecas de uma cor, especializada pela cor.
+	Parametros
+		Chess* chess		registro Chess
+		const char player	cor das pecas, constante
+*/
+SPECIALIZED void genTurn_chess(Chess* chess, const char player) {
+	char i, j;
+	chess->n_moves[(int) player] = 0;
+	for(i=0; i<8; i++)			//Encontra no tabuleiro as pecas
+		for(j=0; j<8; j++)
+			if(chess->board[i][j] != NULL && isblack(chess->board[i][j]->id) == player) {
+				genPiece_color(chess->board[i][j], chess, player);
+				chess->n_moves[(int) player] += chess->board[i][j]->m;
+			}
+}
+
+void updateMovesPositions_piece(Piece* piece, Chess* chess) {
+	if(isblack(piece->id))
+		genPiece_color(piece, chess, 1);
+	else
+		genPiece_color(piece, chess, 0);
+}
+
+void updateMovesPositions_chess(Chess* chess, char player) {
+	COUNT(gen_calls, 1);
+	if(player)				//Gerador escolhido uma vez por posicao
+		genTurn_chess(chess, 1);
+	else
+		genTurn_chess(chess, 0);
+}
+
+char* recordGame_chess(Chess* chess, char* fen) {
+	chess->history = (uint64_t*) realloc_arena(chess->arena, chess->history, (chess->n_history+1)*sizeof(uint64_t));
+	chess->history[chess->n_history++] = key_chess(chess);
+	return genFen_chess(chess, fen);
+}
+
+/*Conta as ocorrencias da ultima posicao do historico, somente entre as posicoes do mesmo turno desde o ultimo
+movimento irreversivel (captura ou movimento de peao).
+	Parametros
+		Chess* chess	registro Chess
+	Retorno
+		numero de ocorrencias, contando a propria posicao
+*/
+static int repetitions_chess(Chess* chess) {
+	int i, n, last;
+	uint64_t key;
+
+	COUNT(rep_probes, 1);
+	last = chess->n_history-1;
+	key = chess->history[last];
+	n = 1;
+	for(i=last-2; i >= 0 && i >= last-chess->mid_turns; i-=2) {
+		COUNT(rep_chain, 1);
+		n += chess->history[i] == key;
+	}
+	return n;
+}
+
+Gamesit sit_chess(Chess* chess) {
+	if(repetitions_chess(chess) > 2)	//Tripla repeticao
+		return REPETITION;
+
+	if(insufficient_chess(chess))	//Material insuficiente
+		return MATERIAL;
+
+	if(!hasMoves_chess(chess))	//Nenhum movimento possivel no turno
+		return incheck_chess(chess) ? !chess->turn+1 : STALEMATE;
+
+	if(chess->mid_turns >= 50)	//Regra dos 50 movimentos
+		return FIFTY;
+
+	return PLAY;	//Nenhuma condicao de vitoria ou empate satisfeita
+}
+
+boolean hasMoves_chess(Chess* chess) {
+	return chess->n_moves[(int) chess->turn] > 0;
+}
+
+boolean insufficient_chess(Chess* chess) {
+	char* m;
+	m = chess->material;
+	if(m[WP] || m[BP] || m[WR] || m[BR] || m[WQ] || m[BQ])
+		return FALSE;
+	if(m[WN] + m[BN] + m[WB] + m[BB] <= 1)		//Reis e no maximo uma peca menor
+		return TRUE;
+	//Somente bispos, todos em casas da mesma cor
+	return !m[WN] && !m[BN] && (!(chess->bishops[0][0] + chess->bishops[1][0]) || !(chess->bishops[0][1] + chess->bishops[1][1]));
+}
+
+boolean makeMove_chess(Chess* chess, Piece* piece, Position* dest) {
+	//Verifica se o movimento e possivel
+	if(search_position(piece->pos+1, piece->m, dest)) {
+		COUNT(make, 1);
+
+		chess->en_passant.x = 0;				//Movimento en passant indisponivel
+
+									//Tratamento do roque
+		if(chess->castling[0]) {				//Verifica se ainda ha caractere de roque
+			//Movimento de um rei
+			if(isking(piece->id)) {
+				if(iswhite(piece->id)) {		//Retira o caractere correspondente da string de roque
+					if(strrmc(chess->castling, 'K') && dest->file == 6 && dest->rank == 0) {//Roque
+						swapPiece_chess(chess, 7, 0, 5, 0);					//Movimenta a torre
+						strrmc(chess->castling, 'Q');
+					}
+					else
+						if(strrmc(chess->castling, 'Q') && dest->file == 2 && dest->rank == 0) {
+							swapPiece_chess(chess, 0, 0, 3, 0);
+							strrmc(chess->castling, 'K');
+						}
+				}
+				else {
+					if(strrmc(chess->castling, 'k') && dest->file == 6 && dest->rank == 7) {
+						swapPiece_chess(chess, 7, 7, 5, 7);
+						strrmc(chess->castling, 'q');
+					}
+					else
+						if(strrmc(chess->castling, 'q') && dest->file == 2 && dest->rank == 7) {
+							swapPiece_chess(chess, 0, 7, 3, 7);
+							strrmc(chess->castling, 'k');
+						}
+				}
+			}
+			else {
+				//Movimento de uma torre
+				if(isrook(piece->id) && piece->pos[0]->rank == (iswhite(piece->id) ? 0 : 7)) {
+					if(piece->pos[0]->file == 7)
+						strrmc(chess->castling, iswhite(piece->id) ? 'K' : 'k');
+					else
+						if(!piece->pos[0]->file)
+							strrmc(chess->castling, iswhite(piece->id) ? 'Q' : 'q');
+				}
+			}
+			//Verifica se uma torre foi capturada na posicao inicial
+			if(chess->board[dest->rank][dest->file] != NULL && isrook(chess->board[dest->rank][dest->file]->id) && dest->rank == (iswhite(chess->board[dest->rank][dest->file]->id) ? 0 : 7)) {
+				if(dest->file == 7)
+					strrmc(chess->castling, iswhite(chess->board[dest->rank][dest->file]->id) ? 'K' : 'k');
+				else
+					if(!dest->file)
+						strrmc(chess->castling, iswhite(chess->board[dest->rank][dest->file]->id) ? 'Q' : 'q');
+			}
+		}
+
+		chess->check = -1;
+		if(chess->board[dest->rank][dest->file] != NULL) {		//Captura
+			material_chess(chess, chess->board[dest->rank][dest->file]->id, dest->file, dest->rank, -1);
+			finalize_piece(chess->board[dest->rank][dest->file], chess->arena);
+			chess->board[dest->rank][dest->file] = NULL;
+			chess->n_pieces--;
+			chess->mid_turns = 0;
+		}
+		else {
+			if(ispawn(piece->id)) {				//Peao
+				chess->mid_turns = 0;
+				if(dest->x == 'e') {			//En passant
+					material_chess(chess, invert_piece(piece->id), dest->file, dest->rank+(iswhite(piece->id) ? -1 : 1), -1);
+					finalize_piece(chess->board[dest->rank+(iswhite(piece->id) ? -1 : 1)][dest->file], chess->arena);
+					chess->board[dest->rank+(iswhite(piece->id) ? -1 : 1)][dest->file] = NULL;
+					chess->n_pieces--;
+				}
+				else {
+					if(abs(dest->rank - piece->pos[0]->rank) == 2) {	//Movimento en passant disponivel
+						chess->en_passant.file = dest->file;
+						chess->en_passant.rank = dest->rank + (chess->turn ? 1 : -1);
+						chess->en_passant.x = 'e';
+					}
+				}
+			}
+			else {
+				chess->mid_turns++;	//A peca nao e um peao ou o movimento nao e de captura
+			}
+		}
+
+		swapPiece_chess(chess, piece->pos[0]->file, piece->pos[0]->rank, dest->file, dest->rank);	//Movimenta a peca
+		if(isupper(dest->x))
+			material_chess(chess, piece->id, dest->file, dest->rank, -1);
+		switch(dest->x) {
+			case 'Q': piece->id = WQ - isblack(piece->id);		//Promocao
+				  break;
+			case 'R': piece->id = WR - isblack(piece->id);
+				  break;
+			case 'B': piece->id = WB - isblack(piece->id);
+				  break;
+			case 'N': piece->id = WN - isblack(piece->id);
+				  break;
+		}
+		if(isupper(dest->x))
+			material_chess(chess, piece->id, dest->file, dest->rank, 1);
+		chess->n_turns += chess->turn;				//Incrementa o numero de turnos se for turno 'b'
+		chess->turn = !chess->turn;				//Mudanca de turno
+		updateMovesPositions_chess(chess, chess->turn);		//Atualiza os vetores de movimentos possiveis
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+void backMove_chess(Chess* chess, Piece* dest, Piece* piece, int mid_turns, char* castling, Position* en_passant) {
+	Piece* aux;
+
+	COUNT(unmake, 1);
+	chess->check = -1;
+	chess->turn = !chess->turn;
+	if(isking(piece->id)) {		//Rei movido
+		if(castling[0]) {				//Movimento de roque
+			if(chess->turn) {
+				if(NULL != strchr(castling, 'k') && dest->pos[0]->file == 6 && dest->pos[0]->rank == 7)	//Roque
+					swapPiece_chess(chess, 7, 7, 5, 7);					//Movimenta a torre
+				else
+					if(NULL != strchr(castling, 'q') && dest->pos[0]->file == 2 && dest->pos[0]->rank == 7)
+						swapPiece_chess(chess, 0, 7, 3, 7);
+			}
+			else {
+				if(NULL != strchr(castling, 'K') && dest->pos[0]->file == 6 && dest->pos[0]->rank == 0)
+					swapPiece_chess(chess, 7, 0, 5, 0);
+				else
+					if(NULL != strchr(castling, 'Q') && dest->pos[0]->file == 2 && dest->pos[0]->rank == 0)
+						swapPiece_chess(chess, 0, 0, 3, 0);
+			}
+		}
+		chess->king[chess->turn] = piece;	//Atualiza o ponteiro do rei
+	}
+	chess->board[piece->pos[0]->rank][piece->pos[0]->file] = piece;
+	aux = chess->board[dest->pos[0]->rank][dest->pos[0]->file];	//Peca movida
+	if(aux != NULL && aux->id != piece->id) {			//Promocao desfeita
+		material_chess(chess, aux->id, dest->pos[0]->file, dest->pos[0]->rank, -1);
+		material_chess(chess, piece->id, dest->pos[0]->file, dest->pos[0]->rank, 1);
+	}
+	if(NULL != aux)
+	finalize_piece(aux, chess->arena);
+	if(dest->id != EMPTY) {
+		chess->board[dest->pos[0]->rank][dest->pos[0]->file] = dest;
+		chess->n_pieces++;
+		material_chess(chess, dest->id, dest->pos[0]->file, dest->pos[0]->rank, 1);
+	}
+	else
+		chess->board[dest->pos[0]->rank][dest->pos[0]->file] = NULL;
+	strcpy(chess->castling, castling);			//Roque
+	cpy_position(&chess->en_passant, en_passant);		//En Passant
+	//Captura en passant: o peao capturado fica ao lado da posicao de origem
+	if(ispawn(piece->id) && en_passant->x == 'e' && dest->pos[0]->file == en_passant->file && dest->pos[0]->rank == en_passant->rank) {
+		chess->board[(int) piece->pos[0]->rank][(int) en_passant->file] = initialize_piece(invert_piece(piece->id), en_passant->file, piece->pos[0]->rank, chess->arena);
+		chess->n_pieces++;
+		material_chess(chess, invert_piece(piece->id), en_passant->file, piece->pos[0]->rank, 1);
+	}
+	chess->mid_turns = mid_turns;				//Meios-turnos
+	chess->n_turns -= chess->turn;				//Turnos
+	updateMovesPositions_chess(chess, chess->turn);		//Movimentos
+}
+
+double moveScore_chess(Chess* chess, Piece* piece, Position* dest, long long* phase) {
+	char i, j;
+	long long t;
+	double a, b, va, vb;
+	Piece* aux;
+	Piece* dest_piece;
+	char castling[5];
+	Position en_passant;
+	char mid_turns;
+
+	aux = cpy_piece(NULL, piece, chess->arena);							//Salva os dados para desfazer o movimento
+	chess->board[piece->pos[0]->rank][piece->pos[0]->file] = aux;
+	if(isking(aux->id))
+		chess->king[chess->turn] = aux;
+	if(chess->board[dest->rank][dest->file] == NULL)
+		dest_piece = initialize_piece(EMPTY, dest->file, dest->rank, chess->arena);
+	else
+		dest_piece = cpy_piece(NULL, chess->board[dest->rank][dest->file], chess->arena);
+	strcpy(castling, chess->castling);
+	cpy_position(&en_passant, &chess->en_passant);
+	mid_turns = chess->mid_turns;
+
+	t = clock_ns();
+	makeMove_chess(chess, aux, dest);			//Efetua o movimento (calculado os movimentos das pecas do proximo turno)
+	updateMovesPositions_chess(chess, !chess->turn);	//Calcula o movimento das pecas do turno
+	phase[TIME_GEN] += clock_ns() - t;
+	t = clock_ns();
+
+	a = 0;				//Calculo da pontuacao
+	b = 1;
+	for(i=0; i<8; i++) {
+		for(j=0; j<8; j++) {
+			if(chess->board[i][j] != NULL) {
+				va = vb = score_piece(chess->board[i][j]->id);
+				if(onturn(chess->board[i][j], chess))
+					vb /= 2;
+				else
+					va /= 2;
+			}
+			else
+				va = vb = 50;
+			a += threat(chess, j, i, !chess->turn)*va;
+			b += threat(chess, j, i, chess->turn)*vb;
+		}
+	}
+	phase[TIME_EVAL] += clock_ns() - t;
+
+	backMove_chess(chess, dest_piece, piece, mid_turns, castling, &en_passant);	//Desfaz o movimento
+	if(dest_piece->id == EMPTY)		//Desaloca peca vazia auxiliar
+		finalize_piece(dest_piece, chess->arena);
+
+	return a/b;
+}
+
+boolean moveAI_chess(Chess* chess, Piece** piece, Position* dest) {
+	char i, j, k;
+	int moves;
+	long long phase[TIME_PHASES];
+	double tmp, max;
+	Position aux;
+
+	memset(phase, 0, sizeof(phase));
+	phase[TIME_SEARCH] = -1;		//Sem busca: somente geracao e avaliacao
+	phase[TIME_TOTAL] = clock_ns();
+	moves = 0;
+	max = -1;
+	for(i=0; i<8; i++)
+		for(j=0; j<8; j++)
+			if(chess->board[i][j] != NULL && onturn(chess->board[i][j], chess)) {	//Procura pelas pecas
+				//Calculo da pontuacao dos movimentos da peca
+				for(k=1; k<=chess->board[i][j]->m; k++) {
+					cpy_position(&aux, chess->board[i][j]->pos[k]);
+					tmp = moveScore_chess(chess, chess->board[i][j], &aux, phase);
+					moves++;
+					//Atualiza o maximo de acordo com as regras de ordenacao
+					if(tmp >= max && (tmp != max || cmp_piece(chess->board[i][j], *piece) < 0)) {
+						max = tmp;
+						*piece = chess->board[i][j];	//Peca do movimento
+						cpy_position(dest, &aux);	//Posicao destino
+					}
+				}
+			}
+	phase[TIME_TOTAL] = clock_ns() - phase[TIME_TOTAL];
+	if(moves)
+		record_latency(chess->n_pieces, moves, phase);
+	return max != -1;
+}
+
+char readPieceMove_chess(FILE* fp, Chess* chess, Piece** piece, Position* dest) {
+	char* move;
+	size_t b;
+	boolean r;
+
+	move = NULL;			//Leitura
+	if(-1 == getline(&move, &b, fp)) {
+		free(move);
+		return -1;
+	}
+	b = strlen(move);
+	if(b && move[b-1] == '\n')
+		move[b-1] = '\0';
+
+	r = parseMove_chess(chess, move, piece, dest);
+	free(move);
+	return r;
+}
+
+boolean parseMove_chess(Chess* chess, char* str, Piece** piece, Position* dest) {
+	char i, n;
+	char promotion;
+	Piece* aux;
+
+	n = strlen(str);
+	//Verifica se a string contem uma anotacao de movimento plausivel
+	if((n != 4 && n != 5) || str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8' || str[2] < 'a' || str[2] > 'h' || str[3] < '1' || str[3] > '8')
+		return FALSE;
+	aux = chess->board[str[1]-'1'][str[0]-'a'];
+	if(aux == NULL || !onturn(aux, chess))
+		return FALSE;
+
+	promotion = n == 5 ? toupper(str[4]) : 0;
+	for(i=1; i<=aux->m; i++) {		//Procura o movimento gerado correspondente
+		if(aux->pos[i]->file != str[2]-'a' || aux->pos[i]->rank != str[3]-'1')
+			continue;
+		if(promotion ? aux->pos[i]->x == promotion : !isupper(aux->pos[i]->x)) {
+			*piece = aux;
+			cpy_position(dest, aux->pos[i]);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+char* str_move(Move* move, char* str) {
+	str[0] = move->file + 'a';
+	str[1] = move->rank + '1';
+	str[2] = move->dest.file + 'a';
+	str[3] = move->dest.rank + '1';
+	str[4] = isupper(move->dest.x) ? tolower(move->dest.x) : '\0';	//Promocao
+	str[5] = '\0';
+	return str;
+}
+
+int genMoves_chess(Chess* chess, Move* list) {
+	char i, j, k;
+	int n;
+	n = 0;
+	for(i=0; i<8; i++)
+		for(j=0; j<8; j++)
+			if(chess->board[i][j] != NULL && onturn(chess->board[i][j], chess))
+				for(k=1; k<=chess->board[i][j]->m; k++) {
+					list[n].file = j;
+					list[n].rank = i;
+					cpy_position(&list[n++].dest, chess->board[i][j]->pos[k]);
+				}
+	return n;
+}
+
+void doMove_chess(Chess* chess, Move* move, Undo* undo) {
+	Piece* aux;
+	Position* dest;
+
+	dest = &move->dest;					//Salva os dados para desfazer o movimento
+	undo->piece = chess->board[move->rank][move->file];
+	if(chess->board[dest->rank][dest->file] == NULL)
+		undo->dest = initialize_piece(EMPTY, dest->file, dest->rank, chess->arena);
+	else
+		undo->dest = cpy_piece(NULL, chess->board[dest->rank][dest->file], chess->arena);
+	strcpy(undo->castling, chess->castling);
+	cpy_position(&undo->en_passant, &chess->en_passant);
+	undo->mid_turns = chess->mid_turns;
+
+	aux = cpy_piece(NULL, undo->piece, chess->arena);			//A copia e movida, a peca original volta ao desfazer
+	chess->board[move->rank][move->file] = aux;
+	if(isking(aux->id))
+		chess->king[chess->turn] = aux;
+	makeMove_chess(chess, aux, dest);
+}
+
+void undoMove_chess(Chess* chess, Undo* undo) {
+	backMove_chess(chess, undo->dest, undo->piece, undo->mid_turns, undo->castling, &undo->en_passant);
+	if(undo->dest->id == EMPTY)		//Desaloca peca vazia auxiliar
+		finalize_piece(undo->dest, chess->arena);
+}
+
+uint64_t zobrist(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+uint64_t key_chess(Chess* chess) {
+	char i, j;
+	uint64_t key;
+
+	key = 0;
+	for(i=0; i<8; i++)			//Pecas: indice (id, casa)
+		for(j=0; j<8; j++)
+			if(chess->board[i][j] != NULL)
+				key ^= zobrist(chess->board[i][j]->id*64 + i*8 + j);
+	if(chess->turn)				//Turno
+		key ^= zobrist(13*64);
+	for(i=0; chess->castling[i]; i++)	//Roque
+		key ^= zobrist(13*64 + chess->castling[i]);
+	if(chess->en_passant.x)			//En passant
+		key ^= zobrist(14*64 + chess->en_passant.file);
+	return key ? key : 1;			//0 indica entrada vazia na tabela de transposicao
+}
+
+int evaluate_chess(Chess* chess) {
+	char i, j;
+	int v, score;
+	Piece* piece;
+
+	score = 0;
+	for(i=0; i<8; i++)
+		for(j=0; j<8; j++) {
+			piece = chess->board[i][j];
+			if(piece == NULL || isking(piece->id))
+				continue;
+			v = score_piece(piece->id);
+			if(ispawn(piece->id))		//Peao: bonus por avanco
+				v += 4*(iswhite(piece->id) ? i-1 : 6-i);
+			else				//Demais pecas: bonus por centralizacao
+				v += 12 - 2*(abs(2*j-7) + abs(2*i-7))/2;
+			score += onturn(piece, chess) ? v : -v;
+			if(onturn(piece, chess))	//Mobilidade, calculada somente para o turno
+				score += piece->m;
+		}
+	return score;
+}
+
+static const char castling_state[] = "KQkq";	//Caractere de cada bit de roque
+static const unsigned char rights_state[64] = {[0] = 2, [4] = 3, [7] = 1, [56] = 8, [60] = 12, [63] = 4};	//Direitos perdidos ao mover de ou para a casa
+
+/*Calcula a chave zobrist de um registro State, com o mesmo esquema de key_chess.
+	Parametros
+		const State* st	posicao
+	Retorno
+		chave, sem o ajuste da chave nula
+*/
+static uint64_t hash_state(const State* st) {
+	int i;
+	uint64_t key;
+
+	key = 0;
+	for(i=0; i<64; i++)
+		if(st->board[i] != EMPTY)
+			key ^= zobrist(st->board[i]*64 + i);
+	if(st->turn)
+		key ^= zobrist(13*64);
+	for(i=0; i<4; i++)
+		if(st->castling & 1<<i)
+			key ^= zobrist(13*64 + castling_state[i]);
+	if(st->en_passant >= 0)
+		key ^= zobrist(14*64 + st->en_passant%8);
+	return key;
+}
+
+void loadFen_state(State* st, const Fen* f) {
+	int i;
+
+	for(i=0; i<64; i++) {
+		st->board[i] = f->board[i/8][i%8];
+		if(st->board[i] != EMPTY && isking(st->board[i]))
+			st->king[isblack(st->board[i])] = i;
+	}
+	st->turn = f->turn;
+	st->castling = 0;
+	for(i=0; i<4; i++)
+		if(NULL != strchr(f->castling, castling_state[i]))
+			st->castling |= 1<<i;
+	st->en_passant = f->en_passant.x ? f->en_passant.rank*8 + f->en_passant.file : -1;
+	st->mid_turns = f->mid_turns;
+	st->n_turns = f->n_turns;
+	st->key = hash_state(st);
+}
+
+void getFen_state(const State* st, Fen* f) {
+	int i, n;
+
+	for(i=0; i<64; i++)
+		f->board[i/8][i%8] = st->board[i];
+	f->turn = st->turn;
+	for(i=n=0; i<4; i++)
+		if(st->castling & 1<<i)
+			f->castling[n++] = castling_state[i];
+	f->castling[n] = '\0';
+	f->en_passant.file = st->en_passant >= 0 ? st->en_passant%8 : 0;
+	f->en_passant.rank = st->en_passant >= 0 ? st->en_passant/8 : 0;
+	f->en_passant.x = st->en_passant >= 0 ? 'e' : 0;
+	f->mid_turns = st->mid_turns;
+	f->n_turns = st->n_turns;
+}
+
+void getState_chess(Chess* chess, State* st) {
+	Fen f;
+	getFen_chess(chess, &f);
+	loadFen_state(st, &f);
+}
+
+void loadState_chess(Chess* chess, const State* st, Arena* arena) {
+	Fen f;
+	getFen_state(st, &f);
+	build_chess(chess, &f, arena);
+}
+
+State* clone_state(State* dest, const State* src) {
+	return (State*) memcpy(dest, src, sizeof(State));
+}
+
+/*Verifica se uma casa de um tabuleiro e atacada por alguma peca de uma cor, especializada pela cor.
+	Parametros
+		const signed char* board	tabuleiro de um registro State
+		int sq		casa rank*8+file
+		const char player	cor das pecas atacantes, constante: 0 - brancas, 1 - pretas
+	Retorno
+		TRUE se atacada, FALSE caso contrario
+*/
+SPECIALIZED boolean attacked_color(const signed char* board, int sq, const char player) {
+	int i, rank, file, r, f, id;
+
+	COUNT(threats, 1);
+	rank = sq/8;
+	file = sq%8;
+	r = rank + (player ? 1 : -1);			//Peoes: atacam a diagonal a frente
+	if(r >= 0 && r < 8)
+		for(f=file-1; f<=file+1; f+=2)
+			if(f >= 0 && f < 8 && board[r*8+f] == WP-player)
+				return TRUE;
+
+	for(i=0; i<8; i++) {				//Cavalos e rei
+		r = rank + knight_state[i][0];
+		f = file + knight_state[i][1];
+		if(r >= 0 && r < 8 && f >= 0 && f < 8 && board[r*8+f] == WN-player)
+			return TRUE;
+		r = rank + dir_state[i][0];
+		f = file + dir_state[i][1];
+		if(r >= 0 && r < 8 && f >= 0 && f < 8 && board[r*8+f] == WK-player)
+			return TRUE;
+	}
+
+	for(i=0; i<8; i++)				//Torres, bispos e damas: primeira peca de cada direcao
+		for(r=rank+dir_state[i][0], f=file+dir_state[i][1]; r >= 0 && r < 8 && f >= 0 && f < 8; r+=dir_state[i][0], f+=dir_state[i][1])
+			if((id = board[r*8+f]) != EMPTY) {
+				if(id == WQ-player || id == (i < 4 ? WR : WB)-player)
+					return TRUE;
+				break;
+			}
+	return FALSE;
+}
+
+/*Verifica se uma casa de um tabuleiro e atacada por alguma peca de uma cor.
+	Parametros
+		const signed char* board	tabuleiro de um registro State
+		int sq		casa rank*8+file
+		char player	cor das pecas atacantes: 0 - brancas, 1 - pretas
+	Retorno
+		TRUE se atacada, FALSE caso contrario
+*/
+static boolean attacked_board(const signed char* board, int sq, char player) {
+	return player ? attacked_color(board, sq, 1) : attacked_color(board, sq, 0);
+}
+
+boolean attacked_state(const State* st, int sq, char player) {
+	return attacked_board(st->board, sq, player);
+}
+
+/*Calcula o mapa das casas atacadas pelas pecas de uma cor num registro Chess: diagonais a frente dos peoes,
+saltos do cavalo, casas vizinhas do rei e raios das demais pecas ate a primeira casa ocupada, inclusive.
+	Parametros
+		Chess* chess	registro Chess
+		char player	cor das pecas atacantes: 0 - brancas, 1 - pretas
+	Retorno
+		casas atacadas, bit rank*8+file
+*/
+static uint64_t attacks_chess(Chess* chess, char player) {
+	int i, first, last, rank, file, r, f;
+	uint64_t map;
+	Piece* piece;
+
+	map = 0;
+	for(rank=0; rank<8; rank++)
+		for(file=0; file<8; file++) {
+			piece = chess->board[rank][file];
+			if(piece == NULL || isblack(piece->id) != player)
+				continue;
+			switch(piece->id + player) {
+				case WP: r = rank + (player ? -1 : 1);
+					 for(f=file-1; f<=file+1; f+=2)
+						if(r >= 0 && r < 8 && f >= 0 && f < 8)
+							map |= (uint64_t) 1 << (r*8+f);
+					 break;
+				case WN:
+				case WK: for(i=0; i<8; i++) {
+						r = rank + (piece->id + player == WN ? knight_state[i][0] : dir_state[i][0]);
+						f = file + (piece->id + player == WN ? knight_state[i][1] : dir_state[i][1]);
+						if(r >= 0 && r < 8 && f >= 0 && f < 8)
+							map |= (uint64_t) 1 << (r*8+f);
+					 }
+					 break;
+				default: first = piece->id + player == WB ? 4 : 0;	//Torre: direcoes 0 a 3, bispo: 4 a 7, dama: todas
+					 last = piece->id + player == WR ? 4 : 8;
+					 for(i=first; i<last; i++)
+						for(r=rank+dir_state[i][0], f=file+dir_state[i][1]; r >= 0 && r < 8 && f >= 0 && f < 8; r+=dir_state[i][0], f+=dir_state[i][1]) {
+							map |= (uint64_t) 1 << (r*8+f);
+							if(chess->board[r][f] != NULL)
+								break;
+						}
+					 break;
+			}
+		}
+	return map;
+}
+
+boolean incheck_chess(Chess* chess) {
+	if(chess->check < 0) {
+		chess->attacks = attacks_chess(chess, !chess->turn);
+		chess->check = chess->attacks >> (chess->king[(int) chess->turn]->pos[0]->rank*8 + chess->king[(int) chess->turn]->pos[0]->file) & 1;
+	}
+	return chess->check;
+}
+
+/*Acrescenta um movimento a lista se ele nao deixa o rei do turno em xeque, especializada pela cor do turno.
+	Parametros
+		const State* st	posicao
+		Move* list	movimentos
+		int n		numero de movimentos
+		int from	casa de origem
+		int to		casa destino
+		char x		tipo de ocupacao do destino
+		boolean promotion	acrescenta as quatro promocoes, de cavalo a dama
+		const char turn	cor do turno, constante
+	Retorno
+		novo numero de movimentos
+*/
+SPECIALIZED int add_state(const State* st, Move* list, int n, int from, int to, char x, boolean promotion, const char turn) {
+	static const char* promote = "NBRQ";
+	signed char board[64];
+	int i;
+
+	memcpy(board, st->board, sizeof(board));	//Efetua o movimento numa copia do tabuleiro
+	if(x == 'e')
+		board[to + (turn ? 8 : -8)] = EMPTY;
+	board[to] = board[from];
+	board[from] = EMPTY;
+	if(attacked_color(board, from == st->king[(int) turn] ? to : st->king[(int) turn], !turn))
+		return n;
+
+	for(i=0; i < (promotion ? 4 : 1); i++) {
+		list[n].file = from%8;
+		list[n].rank = from/8;
+		list[n].dest.file = to%8;
+		list[n].dest.rank = to/8;
+		list[n++].dest.x = promotion ? promote[i] : x;
+	}
+	return n;
+}
+
+/*Gera os movimentos possiveis de uma posicao, especializada pela cor do turno: direcao e linhas dos peoes, casas
+do roque e cor das pecas atacantes sao constantes.
+	Parametros
+		const State* st	posicao
+		Move* list	recipiente com no minimo MAX_MOVES elementos
+		const char turn	cor do turno, constante
+	Retorno
+		numero de movimentos
+*/
+SPECIALIZED int genTurn_state(const State* st, Move* list, const char turn) {
+	const int dir = turn ? -1 : 1;			//Avanco dos peoes
+	const int home = turn ? 56 : 0;			//Primeira casa da linha do rei
+	int sq, to, n, first, i, j, rank, file, r, f, begin, end;
+	signed char id;
+	Move tmp;
+
+	n = 0;
+	for(sq=0; sq<64; sq++) {
+		id = st->board[sq];
+		if(id == EMPTY || isblack(id) != turn)
+			continue;
+		first = n;
+		rank = sq/8;
+		file = sq%8;
+		switch(id + turn) {
+			case WP:
+				r = rank + dir;
+				for(f=file-1; f<=file+1; f++) {
+					if(f < 0 || f >= 8)
+						continue;
+					to = r*8 + f;
+					if(f != file && to == st->en_passant)
+						n = add_state(st, list, n, sq, to, 'e', FALSE, turn);
+					else
+						if(f != file ? st->board[to] != EMPTY && isblack(st->board[to]) != turn : st->board[to] == EMPTY)
+							n = add_state(st, list, n, sq, to, f != file ? 'x' : 0, r == 0 || r == 7, turn);
+				}
+				if(rank == (turn ? 6 : 1) && st->board[r*8+file] == EMPTY && st->board[(r+dir)*8+file] == EMPTY)	//Avanco de duas casas
+					n = add_state(st, list, n, sq, (r+dir)*8 + file, 0, FALSE, turn);
+				break;
+			case WN:
+				for(i=0; i<8; i++) {
+					r = rank + knight_state[i][0];
+					f = file + knight_state[i][1];
+					if(r < 0 || r >= 8 || f < 0 || f >= 8)
+						continue;
+					to = r*8 + f;
+					if(st->board[to] == EMPTY || isblack(st->board[to]) != turn)
+						n = add_state(st, list, n, sq, to, st->board[to] == EMPTY ? 0 : 'x', FALSE, turn);
+				}
+				break;
+			case WK:
+				for(i=0; i<8; i++) {
+					r = rank + dir_state[i][0];
+					f = file + dir_state[i][1];
+					if(r < 0 || r >= 8 || f < 0 || f >= 8)
+						continue;
+					to = r*8 + f;
+					if(st->board[to] == EMPTY || isblack(st->board[to]) != turn)
+						n = add_state(st, list, n, sq, to, st->board[to] == EMPTY ? 0 : 'x', FALSE, turn);
+				}
+				if(!attacked_color(st->board, sq, !turn)) {	//Roque: casas livres e nao atacadas
+					if((st->castling & 2<<2*turn) && st->board[home+3] == EMPTY && st->board[home+2] == EMPTY && st->board[home+1] == EMPTY && !attacked_color(st->board, home+3, !turn))
+						n = add_state(st, list, n, sq, home+2, 0, FALSE, turn);
+					if((st->castling & 1<<2*turn) && st->board[home+5] == EMPTY && st->board[home+6] == EMPTY && !attacked_color(st->board, home+5, !turn))
+						n = add_state(st, list, n, sq, home+6, 0, FALSE, turn);
+				}
+				break;
+			default:				//Torre, bispo e dama
+				begin = id + turn == WB ? 4 : 0;
+				end = id + turn == WR ? 4 : 8;
+				for(i=begin; i<end; i++)
+					for(r=rank+dir_state[i][0], f=file+dir_state[i][1]; r >= 0 && r < 8 && f >= 0 && f < 8; r+=dir_state[i][0], f+=dir_state[i][1]) {
+						to = r*8 + f;
+						if(st->board[to] != EMPTY) {
+							if(isblack(st->board[to]) != turn)
+								n = add_state(st, list, n, sq, to, 'x', FALSE, turn);
+							break;
+						}
+						n = add_state(st, list, n, sq, to, 0, FALSE, turn);
+					}
+		}
+
+		for(i=first+1; i<n; i++) {			//Ordena por destino (coluna, linha), como os vetores de movimentos das pecas
+			tmp = list[i];
+			for(j=i; j>first && list[j-1].dest.file*8 + list[j-1].dest.rank > tmp.dest.file*8 + tmp.dest.rank; j--)
+				list[j] = list[j-1];
+			list[j] = tmp;
+		}
+	}
+	return n;
+}
+
+int genMoves_state(const State* st, Move* list) {
+	int n;
+
+	COUNT(gen_calls, 1);
+	n = st->turn ? genTurn_state(st, list, 1) : genTurn_state(st, list, 0);	//Gerador escolhido uma vez por posicao
+	COUNT(gen_moves, n);
+	return n;
+}
+
+boolean legal_state(const State* st, Move* move) {
+	int from, to, dr, df, dir, sq, r;
+	signed char id, victim;
+	char x, promotion;
+	signed char board[64];
+
+	if(move->file < 0 || move->file >= 8 || move->rank < 0 || move->rank >= 8 || move->dest.file < 0 || move->dest.file >= 8 || move->dest.rank < 0 || move->dest.rank >= 8)
+		return FALSE;
+	from = move->rank*8 + move->file;
+	to = move->dest.rank*8 + move->dest.file;
+	id = st->board[from];
+	victim = st->board[to];
+	if(id == EMPTY || isblack(id) != st->turn || from == to || (victim != EMPTY && isblack(victim) == st->turn))
+		return FALSE;
+	promotion = isupper(move->dest.x) ? move->dest.x : 0;
+	if(promotion && (id + isblack(id) != WP || !strchr("NBRQ", promotion)))
+		return FALSE;
+	x = victim != EMPTY ? 'x' : 0;
+	dr = move->dest.rank - move->rank;
+	df = move->dest.file - move->file;
+
+	switch(id + isblack(id)) {			//Regra da peca
+		case WP:
+			dir = st->turn ? -1 : 1;
+			if(df == 0) {				//Avanco: uma casa ou duas da linha inicial
+				if(victim != EMPTY || !(dr == dir || (dr == 2*dir && move->rank == (st->turn ? 6 : 1) && st->board[from + 8*dir] == EMPTY)))
+					return FALSE;
+			}
+			else {					//Captura, comum ou en passant
+				if(abs(df) != 1 || dr != dir)
+					return FALSE;
+				if(to == st->en_passant)
+					x = 'e';
+				else
+					if(victim == EMPTY)
+						return FALSE;
+			}
+			if((move->dest.rank == 0 || move->dest.rank == 7) != (promotion != 0))	//Promocao obrigatoria na ultima linha
+				return FALSE;
+			break;
+		case WN:
+			if(abs(dr*df) != 2)
+				return FALSE;
+			break;
+		case WK:
+			if(abs(dr) <= 1 && abs(df) <= 1)
+				break;
+			r = st->turn ? 56 : 0;			//Roque: direito, casas livres, rei e casa intermediaria nao atacados
+			if(from != r+4 || dr || (to != r+2 && to != r+6) || victim != EMPTY)
+				return FALSE;
+			if(to == r+2 ? !(st->castling & 2<<2*st->turn) || st->board[r+3] != EMPTY || st->board[r+1] != EMPTY : !(st->castling & 1<<2*st->turn) || st->board[r+5] != EMPTY)
+				return FALSE;
+			if(attacked_board(st->board, from, !st->turn) || attacked_board(st->board, (from+to)/2, !st->turn))
+				return FALSE;
+			break;
+		default:					//Torre, bispo e dama: direcao da peca e caminho livre
+			if(dr && df && abs(dr) != abs(df))
+				return FALSE;
+			if(id + isblack(id) == WR ? dr && df : id + isblack(id) == WB && (!dr || !df))
+				return FALSE;
+			dir = (dr > 0) - (dr < 0);
+			dir = dir*8 + (df > 0) - (df < 0);
+			for(sq=from+dir; sq != to; sq+=dir)
+				if(st->board[sq] != EMPTY)
+					return FALSE;
+	}
+
+	memcpy(board, st->board, sizeof(board));	//Rei do turno fora de xeque apos o movimento
+	if(x == 'e')
+		board[to + (st->turn ? 8 : -8)] = EMPTY;
+	board[to] = board[from];
+	board[from] = EMPTY;
+	if(attacked_board(board, from == st->king[(int) st->turn] ? to : st->king[(int) st->turn], !st->turn))
+		return FALSE;
+	move->dest.x = promotion ? promotion : x;
+	return TRUE;
+}
+
+boolean parseMove_state(const State* st, const char* str, Move* move) {
+	int n;
+	n = strlen(str);
+	if((n != 4 && n != 5) || str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8' || str[2] < 'a' || str[2] > 'h' || str[3] < '1' || str[3] > '8')
+		return FALSE;
+	move->file = str[0] - 'a';
+	move->rank = str[1] - '1';
+	move->dest.file = str[2] - 'a';
+	move->dest.rank = str[3] - '1';
+	move->dest.x = n == 5 ? toupper(str[4]) : 0;
+	if(n == 5 && !strchr("NBRQ", move->dest.x))
+		return FALSE;
+	return legal_state(st, move);
+}
+
+void doMove_state(State* st, const Move* move) {
+	int from, to, sq;
+	signed char id, victim;
+	unsigned char castling;
+
+	COUNT(make, 1);
+	from = move->rank*8 + move->file;
+	to = move->dest.rank*8 + move->dest.file;
+	id = st->board[from];
+	victim = st->board[to];
+
+	if(st->en_passant >= 0)					//En passant anterior
+		st->key ^= zobrist(14*64 + st->en_passant%8);
+	st->en_passant = -1;
+
+	castling = st->castling & ~rights_state[from] & ~rights_state[to];	//Roque: rei ou torre movidos, torre capturada
+	if(castling != st->castling) {
+		for(sq=0; sq<4; sq++)
+			if((castling ^ st->castling) & 1<<sq)
+				st->key ^= zobrist(13*64 + castling_state[sq]);
+		st->castling = castling;
+	}
+
+	if(victim != EMPTY) {					//Captura
+		st->key ^= zobrist(victim*64 + to);
+		st->mid_turns = 0;
+	}
+	else
+		if(ispawn(id)) {
+			st->mid_turns = 0;
+			if(move->dest.x == 'e') {		//En passant: o peao capturado fica atras do destino
+				sq = to + (st->turn ? 8 : -8);
+				st->key ^= zobrist(st->board[sq]*64 + sq);
+				st->board[sq] = EMPTY;
+			}
+			else
+				if(abs(to - from) == 16) {	//Movimento en passant disponivel
+					st->en_passant = (from + to)/2;
+					st->key ^= zobrist(14*64 + st->en_passant%8);
+				}
+		}
+		else
+			st->mid_turns++;
+
+	if(isking(id)) {
+		st->king[(int) st->turn] = to;
+		if(abs(to - from) == 2) {			//Roque: movimenta a torre
+			sq = to > from ? from+3 : from-4;
+			st->key ^= zobrist(st->board[sq]*64 + sq) ^ zobrist(st->board[sq]*64 + (from+to)/2);
+			st->board[(from+to)/2] = st->board[sq];
+			st->board[sq] = EMPTY;
+		}
+	}
+
+	st->key ^= zobrist(id*64 + from);			//Movimenta a peca
+	if(isupper(move->dest.x))				//Promocao
+		id = genName_piece(move->dest.x) - isblack(id);
+	st->key ^= zobrist(id*64 + to);
+	st->board[to] = id;
+	st->board[from] = EMPTY;
+
+	st->n_turns += st->turn;
+	st->turn = !st->turn;
+	st->key ^= zobrist(13*64);
+}
+
+boolean incheck_state(const State* st) {
+	return attacked_board(st->board, st->king[(int) st->turn], !st->turn);
+}
+
+uint64_t key_state(const State* st) {
+	return st->key ? st->key : 1;		//0 indica entrada vazia na tabela de transposicao
+}
+
+int evaluate_state(const State* st, const Move* list, int n) {
+	int i, v, score;
+	signed char id;
+
+	score = 0;
+	for(i=0; i<64; i++) {
+		id = st->board[i];
+		if(id == EMPTY || isking(id))
+			continue;
+		v = score_piece(id);
+		if(ispawn(id))			//Peao: bonus por avanco
+			v += 4*(iswhite(id) ? i/8-1 : 6-i/8);
+		else				//Demais pecas: bonus por centralizacao
+			v += 12 - 2*(abs(2*(i%8)-7) + abs(2*(i/8)-7))/2;
+		score += isblack(id) == st->turn ? v : -v;
+	}
+	for(i=0; i<n; i++)			//Mobilidade: movimentos do turno, exceto os do rei
+		if(!isking(st->board[list[i].rank*8 + list[i].file]))
+			score++;
+	return score;
+}
+
+void initialize_ttable(TTable* tt, size_t mb) {
+	size_t m;
+	for(m=1; 2*m*sizeof(TTEntry) <= mb*1024*1024; m*=2);	//Maior potencia de 2 que cabe no tamanho
+	tt->entry = (TTEntry*) calloc(m, sizeof(TTEntry));
+	COUNT_ALLOC(ALLOC_TTABLE, m*sizeof(TTEntry));
+	tt->m = m;
+	tt->gen = 0;
+}
+
+void finalize_ttable(TTable* tt) {
+	free(tt->entry);
+	tt->entry = NULL;
+	tt->m = 0;
+}
+
+void clear_ttable(TTable* tt) {
+	memset(tt->entry, 0, tt->m*sizeof(TTEntry));
+	tt->gen = 0;
+}
+
+TTEntry* probe_ttable(TTable* tt, uint64_t key) {
+	TTEntry* e;
+	e = &tt->entry[key & (tt->m-1)];
+	COUNT(tt_probes, 1);
+	if(e->key != key)
+		return NULL;
+	COUNT(tt_hits, 1);
+	return e;
+}
+
+void store_ttable(TTable* tt, uint64_t key, int depth, int score, Bound bound, Move* best) {
+	TTEntry* e;
+	e = &tt->entry[key & (tt->m-1)];
+	//Substitui entradas de outra busca, de outra posicao ou de menor profundidade
+	if(e->key && e->gen == tt->gen && e->key != key && e->depth > depth)
+		return;
+	if(best != NULL)
+		e->best = *best;
+	else
+		if(e->key != key)
+			e->best.file = -1;	//Sem movimento
+	e->key = key;
+	e->score = score;
+	e->depth = depth;
+	e->bound = bound;
+	e->gen = tt->gen;
+}
+
+int hashfull_ttable(TTable* tt) {
+	size_t i, n;
+	for(i=n=0; i<1000 && i<tt->m; i++)
+		n += tt->entry[i].key && tt->entry[i].gen == tt->gen;
+	return tt->m < 1000 ? n*1000/tt->m : n;
+}
+
+static const char type_cache[] = {0, 'x', 'e', 'N', 'B', 'R', 'Q'};	//Tipo de movimento de cada codigo do cache de analise
+
+/*Calcula a soma de verificacao de uma entrada do cache de analise.
+	Parametros
+		uint64_t key	chave zobrist
+		uint64_t data	dados da entrada, sem a soma
+	Retorno
+		soma de 8 bits, nos bits 56 a 63
+*/
+static uint64_t sum_cache(uint64_t key, uint64_t data) {
+	return zobrist(key ^ (data & 0x00FFFFFFFFFFFFFFULL)) & 0xFF00000000000000ULL;
+}
+
+/*Cria um arquivo de cache de analise vazio. O arquivo e preparado com outro nome e so entao ligado ao caminho,
+de forma que nenhum processo abra um cache sem cabecalho; se outro processo o criou antes, o dele e mantido.
+	Parametros
+		const char* path	caminho
+		size_t mb		tamanho em MB
+	Retorno
+		TRUE se o arquivo existe ao final, FALSE em caso de erro
+*/
+static boolean create_cache(const char* path, size_t mb) {
+	CacheHeader h;
+	Fen f;
+	State st;
+	char* tmp;
+	int fd;
+	boolean ok;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+	h.version = CACHE_VERSION;
+	h.entry_size = sizeof(CacheEntry);
+	for(h.m=1; 2*h.m*sizeof(CacheEntry) <= mb*1024*1024; h.m*=2);	//Maior potencia de 2 que cabe no tamanho
+	parseFen(START_FEN, &f);
+	loadFen_state(&st, &f);
+	h.start_key = key_state(&st);
+
+	if(asprintf(&tmp, "%s.%ld.tmp", path, (long) getpid()) < 0)
+		return FALSE;
+	if((fd = open(tmp, O_RDWR | O_CREAT | O_EXCL, 0644)) < 0) {
+		free(tmp);
+		return FALSE;
+	}
+	ok = !ftruncate(fd, sizeof(h) + h.m*sizeof(CacheEntry)) && pwrite(fd, &h, sizeof(h), 0) == sizeof(h);
+	close(fd);
+	ok = ok && (!link(tmp, path) || errno == EEXIST);
+	unlink(tmp);
+	free(tmp);
+	return ok;
+}
+
+boolean open_cache(Cache* c, const char* path, size_t mb) {
+	struct stat st;
+	CacheHeader* h;
+	Fen f;
+	State start;
+
+	memset(c, 0, sizeof(Cache));
+	if((c->fd = open(path, O_RDWR)) < 0 && (errno != ENOENT || !create_cache(path, mb) || (c->fd = open(path, O_RDWR)) < 0))
+		return FALSE;
+	if(fstat(c->fd, &st) < 0 || st.st_size < (off_t) sizeof(CacheHeader)) {
+		close(c->fd);
+		errno = EINVAL;
+		return FALSE;
+	}
+	c->size = st.st_size;
+	c->map = mmap(NULL, c->size, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0);
+	if(c->map == MAP_FAILED) {
+		close(c->fd);
+		return FALSE;
+	}
+	h = (CacheHeader*) c->map;			//Versao, formato das entradas e esquema das chaves
+	parseFen(START_FEN, &f);
+	loadFen_state(&start, &f);
+	if(memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) || h->version != CACHE_VERSION || h->entry_size != sizeof(CacheEntry) ||
+	   !h->m || (h->m & (h->m-1)) || c->size != sizeof(CacheHeader) + h->m*sizeof(CacheEntry) || h->start_key != key_state(&start)) {
+		munmap(c->map, c->size);
+		close(c->fd);
+		errno = EINVAL;
+		return FALSE;
+	}
+	c->entry = (CacheEntry*) (h + 1);
+	c->m = h->m;
+	return TRUE;
+}
+
+void close_cache(Cache* c) {
+	munmap(c->map, c->size);
+	close(c->fd);
+	memset(c, 0, sizeof(Cache));
+}
+
+boolean probe_cache(Cache* c, uint64_t key, TTEntry* e) {
+	CacheEntry* entry;
+	uint64_t data;
+	int type;
+
+	entry = &c->entry[key & (c->m-1)];
+	data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+	if(!data || (__atomic_load_n(&entry->check, __ATOMIC_RELAXED) ^ data) != key || (data & 0xFF00000000000000ULL) != sum_cache(key, data))
+		return FALSE;
+	e->key = key;
+	e->score = (short) (data & 0xFFFF);
+	e->depth = data >> 16 & 0xFF;
+	e->bound = data >> 24 & 3;
+	e->gen = 0;
+	type = data >> 38 & 7;
+	if(type >= (int) sizeof(type_cache)) {
+		e->best.file = -1;			//Sem movimento
+		return TRUE;
+	}
+	e->best.file = (data >> 26 & 63)%8;
+	e->best.rank = (data >> 26 & 63)/8;
+	e->best.dest.file = (data >> 32 & 63)%8;
+	e->best.dest.rank = (data >> 32 & 63)/8;
+	e->best.dest.x = type_cache[type];
+	return TRUE;
+}
+
+void store_cache(Cache* c, uint64_t key, int depth, int score, Bound bound, const Move* best) {
+	CacheEntry* entry;
+	uint64_t data, old;
+	int type;
+
+	entry = &c->entry[key & (c->m-1)];
+	old = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+	if(old && (int) (old >> 16 & 0xFF) > depth)	//Mantem as analises mais profundas
+		return;
+	type = sizeof(type_cache);
+	if(best != NULL && best->file >= 0)
+		for(type=0; type < (int) sizeof(type_cache) && type_cache[type] != best->dest.x; type++);
+	data = (uint64_t) (uint16_t) score | (uint64_t) (depth & 0xFF) << 16 | (uint64_t) bound << 24 | (uint64_t) type << 38;
+	if(type < (int) sizeof(type_cache))
+		data |= (uint64_t) (best->rank*8 + best->file) << 26 | (uint64_t) (best->dest.rank*8 + best->dest.file) << 32;
+	data |= sum_cache(key, data);
+	__atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+}
+
+long long elapsed_search(Search* s) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - s->start.tv_sec)*1000LL + (now.tv_nsec - s->start.tv_nsec)/1000000;
+}
+
+long long clock_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000LL + now.tv_nsec;
+}
+
+/*Gera os movimentos de uma posicao da busca. Uma chamada a cada PHASE_SAMPLE tem o tempo somado a fase de
+geracao, extrapolado no fim da busca: o relogio nao e lido em todos os nos.
+	Parametros
+		Search* s	busca
+		const State* st	posicao
+		Move* list	recipiente com no minimo MAX_MOVES elementos
+	Retorno
+		numero de movimentos
+*/
+static int gen_search(Search* s, const State* st, Move* list) {
+#ifndef NO_STATS
+	int n;
+	long long t;
+	if(s->phase_calls[TIME_GEN]++ % PHASE_SAMPLE == 0) {
+		t = clock_ns();
+		n = genMoves_state(st, list);
+		s->phase[TIME_GEN] += clock_ns() - t;
+		return n;
+	}
+#endif
+	return genMoves_state(st, list);
+}
+
+/*Avalia uma posicao da busca. Uma chamada a cada PHASE_SAMPLE tem o tempo somado a fase de avaliacao, como
+em gen_search.
+	Parametros
+		Search* s	busca
+		const State* st	posicao
+		const Move* list	movimentos possiveis
+		int n		numero de movimentos
+	Retorno
+		pontuacao do ponto de vista do turno
+*/
+static int evaluate_search(Search* s, const State* st, const Move* list, int n) {
+#ifndef NO_STATS
+	int score;
+	long long t;
+	if(s->phase_calls[TIME_EVAL]++ % PHASE_SAMPLE == 0) {
+		t = clock_ns();
+		score = evaluate_state(st, list, n);
+		s->phase[TIME_EVAL] += clock_ns() - t;
+		return score;
+	}
+#endif
+	return evaluate_state(st, list, n);
+}
+
+#ifndef NO_STATS
+/*Extrapola o tempo das chamadas medidas de uma fase para todas as chamadas da busca.
+	Parametros
+		Search* s	busca
+		Timephase p	fase
+*/
+static void sample_search(Search* s, Timephase p) {
+	long long sampled;
+	sampled = (s->phase_calls[p] + PHASE_SAMPLE-1)/PHASE_SAMPLE;
+	if(sampled)
+		s->phase[p] = s->phase[p]*s->phase_calls[p]/sampled;
+}
+#endif
+
+/*Verifica os limites de nos e de tempo, ativando o sinal de parada se algum foi atingido.
+	Parametros
+		Search* s	busca
+*/
+static void checkLimits_search(Search* s) {
+	if(s->max_nodes >= 0 && s->nodes >= s->max_nodes)
+		s->stop = TRUE;
+	if(s->max_time >= 0 && !(s->nodes & 63) && elapsed_search(s) >= s->max_time)
+		s->stop = TRUE;
+}
+
+/*Verifica se a posicao atual repete uma posicao anterior do jogo ou do caminho da busca.
+	Parametros
+		Search* s	busca
+		const State* st	posicao atual
+		uint64_t key	chave da posicao atual
+		int ply		distancia da raiz: as chaves do caminho estao em s->path[0..ply-1]
+	Retorno
+		TRUE se repetida, FALSE caso contrario
+*/
+static boolean repetition_search(Search* s, const State* st, uint64_t key, int ply) {
+	int i, n;
+	COUNT(rep_probes, 1);
+	n = s->n_keys + ply;					//Indice da posicao atual na sequencia jogo + caminho
+	for(i=n-2; i>=0 && i>=n-st->mid_turns; i-=2) {		//Somente posicoes com o mesmo turno
+		COUNT(rep_chain, 1);
+		if((i >= s->n_keys ? s->path[i - s->n_keys] : s->keys[i]) == key)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*Atribui uma prioridade de ordenacao a cada movimento: movimento da tabela, capturas (MVV-LVA) e promocoes.
+	Parametros
+		const State* st	posicao
+		Move* list	movimentos
+		int n		numero de movimentos
+		Move* tt_move	movimento da tabela de transposicao, NULL se nenhum
+		int* order	recipiente para as prioridades
+*/
+static void order_search(const State* st, Move* list, int n, Move* tt_move, int* order) {
+	int i;
+	signed char victim;
+	for(i=0; i<n; i++) {
+		order[i] = 0;
+		if(tt_move != NULL && tt_move->file == list[i].file && tt_move->rank == list[i].rank && !cmp_position(&tt_move->dest, &list[i].dest)) {
+			order[i] = INT_MAX;
+			continue;
+		}
+		victim = st->board[list[i].dest.rank*8 + list[i].dest.file];
+		if(victim != EMPTY)
+			order[i] += 10*score_piece(victim) - score_piece(st->board[list[i].rank*8 + list[i].file])/10;
+		else
+			if(list[i].dest.x == 'e')
+				order[i] += 10*score_piece(WP);
+		if(isupper(list[i].dest.x))
+			order[i] += score_piece(genName_piece(list[i].dest.x));
+	}
+}
+
+/*Seleciona o movimento de maior prioridade a partir de um indice, trazendo-o para esse indice.
+	Parametros
+		Move* list	movimentos
+		int* order	prioridades
+		int n		numero de movimentos
+		int i		indice inicial
+*/
+static void pick_search(Move* list, int* order, int n, int i) {
+	int j, k, t;
+	Move tmp;
+	for(j=k=i; j<n; j++)
+		if(order[j] > order[k])
+			k = j;
+	tmp = list[i];
+	list[i] = list[k];
+	list[k] = tmp;
+	t = order[i];
+	order[i] = order[k];
+	order[k] = t;
+}
+
+int quiescence_search(Search* s, const State* st, int alpha, int beta, int ply) {
+	int i, n, score, best;
+	int order[MAX_MOVES];
+	Move list[MAX_MOVES];
+	State child;
+
+	s->nodes++;
+	checkLimits_search(s);
+	if(s->stop)
+		return 0;
+
+	n = gen_search(s, st, list);
+	best = evaluate_search(s, st, list, n);	//Avaliacao estatica: o turno pode nao capturar
+	if(best >= beta || ply >= MAX_PLY-1)
+		return best;
+	if(best > alpha)
+		alpha = best;
+
+	for(i=score=0; i<n; i++)		//Somente capturas e promocoes
+		if(st->board[list[i].dest.rank*8 + list[i].dest.file] != EMPTY || list[i].dest.x == 'e' || list[i].dest.x == 'Q')
+			list[score++] = list[i];
+	n = score;
+	order_search(st, list, n, NULL, order);
+	for(i=0; i<n; i++) {
+		pick_search(list, order, n, i);
+		child = *st;
+		doMove_state(&child, &list[i]);
+		score = -quiescence_search(s, &child, -beta, -alpha, ply+1);
+		if(s->stop)
+			return 0;
+		if(score > best) {
+			best = score;
+			if(score > alpha) {
+				alpha = score;
+				if(alpha >= beta)
+					break;
+			}
+		}
+	}
+	return best;
+}
+
+int alphaBeta_search(Search* s, const State* st, int depth, int alpha, int beta, int ply) {
+	int i, n, score, best, alpha0;
+	int order[MAX_MOVES];
+	uint64_t key;
+	Move list[MAX_MOVES];
+	Move* tt_move;
+	Move* best_move;
+	TTEntry* e;
+	TTEntry cached;
+	State child;
+
+	s->pv_len[ply] = 0;
+	if(depth <= 0)
+		return quiescence_search(s, st, alpha, beta, ply);
+	s->nodes++;
+	checkLimits_search(s);
+	if(s->stop)
+		return 0;
+
+	key = key_state(st);
+	if(ply && (st->mid_turns >= 50 || repetition_search(s, st, key, ply)))	//Empate, mesma regra de sit_chess
+		return 0;
+	if(ply >= MAX_PLY-1)
+		return evaluate_search(s, st, list, gen_search(s, st, list));
+
+	tt_move = NULL;
+	e = probe_ttable(s->tt, key);
+	if(e == NULL && s->cache != NULL && depth >= CACHE_DEPTH && probe_cache(s->cache, key, &cached))	//Analise de outra busca
+		e = &cached;
+	if(e != NULL) {
+		if(e->best.file >= 0)
+			tt_move = &e->best;
+		score = e->score;			//Pontuacoes de mate sao gravadas relativas ao no
+		score += score > MATE-MAX_PLY ? -ply : score < -MATE+MAX_PLY ? ply : 0;
+		if(ply && e->depth >= depth && (e->bound == EXACT || (e->bound == LOWER && score >= beta) || (e->bound == UPPER && score <= alpha)))
+			return score;
+	}
+
+	n = gen_search(s, st, list);
+	if(!n)						//Xeque-mate ou afogamento
+		return incheck_state(st) ? -MATE+ply : 0;
+	order_search(st, list, n, tt_move, order);
+
+	alpha0 = alpha;
+	best = -INF;
+	best_move = NULL;
+	s->path[ply] = key;
+	for(i=0; i<n; i++) {
+		pick_search(list, order, n, i);
+		child = *st;
+		doMove_state(&child, &list[i]);
+		score = -alphaBeta_search(s, &child, depth-1, -beta, -alpha, ply+1);
+		if(s->stop)
+			break;
+		if(score > best) {
+			best = score;
+			best_move = &list[i];
+			if(score > alpha) {
+				alpha = score;
+				s->pv[ply][0] = list[i];	//Atualiza a variante principal
+				memcpy(s->pv[ply]+1, s->pv[ply+1], s->pv_len[ply+1]*sizeof(Move));
+				s->pv_len[ply] = s->pv_len[ply+1]+1;
+				if(alpha >= beta)
+					break;
+			}
+		}
+	}
+	if(s->stop)
+		return 0;
+
+	score = best;
+	score += score > MATE-MAX_PLY ? ply : score < -MATE+MAX_PLY ? -ply : 0;
+	store_ttable(s->tt, key, depth, score, best >= beta ? LOWER : best > alpha0 ? EXACT : UPPER, best_move);
+	if(s->cache != NULL && depth >= CACHE_DEPTH)
+		store_cache(s->cache, key, depth, score, best >= beta ? LOWER : best > alpha0 ? EXACT : UPPER, best_move);
+	return best;
+}
+
+/*Completa uma variante pelos melhores movimentos da tabela de transposicao, ate a profundidade da busca: a
+variante de uma nova busca termina onde o filho foi respondido pela tabela ou nao melhorou a janela.
+	Parametros
+		Search* s	busca
+		const State* root	raiz
+		Move* line	variante, a partir da raiz
+		int len		tamanho da variante
+		int depth	profundidade da busca
+	Retorno
+		novo tamanho da variante
+*/
+static int extend_search(Search* s, const State* root, Move* line, int len, int depth) {
+	int i;
+	uint64_t keys[MAX_PLY];
+	TTEntry* e;
+	State st;
+	Move m;
+
+	st = *root;
+	for(i=0; i<len; i++) {
+		keys[i] = key_state(&st);
+		doMove_state(&st, &line[i]);
+	}
+	while(len < depth && len < MAX_PLY-1) {
+		keys[len] = key_state(&st);
+		for(i=len-2; i>=0 && keys[i] != keys[len]; i-=2);	//Ciclo: a variante terminaria em repeticao
+		if(i >= 0 || NULL == (e = probe_ttable(s->tt, keys[len])) || e->best.file < 0)
+			break;
+		m = e->best;
+		if(!legal_state(&st, &m))
+			break;
+		line[len++] = m;
+		doMove_state(&st, &m);
+	}
+	return len;
+}
+
+/*Busca a raiz com multiplas variantes: a variante k e o melhor movimento entre os que nao estao nas k anteriores,
+com janela aberta somente abaixo da melhor pontuacao ja encontrada para ela. Os movimentos escolhidos sao levados
+para o inicio da lista, na ordem, e os demais mantem a ordem anterior: a proxima iteracao comeca pelas variantes
+da anterior, e a tabela de transposicao e compartilhada entre as variantes.
+	Parametros
+		Search* s	busca
+		const State* root	raiz
+		Move* list	movimentos da raiz, reordenados
+		int n		numero de movimentos
+		int depth	profundidade
+	Retorno
+		pontuacao da melhor variante, 0 se a busca foi interrompida
+*/
+static int multi_search(Search* s, const State* root, Move* list, int n, int depth) {
+	int i, k, m, best, score;
+	int scores[MAX_MULTIPV];
+	char len[MAX_MULTIPV];
+	Move lines[MAX_MULTIPV][MAX_PLY];
+	Move tmp;
+	State child;
+
+	s->nodes++;
+	s->pv_len[0] = 0;
+	s->path[0] = key_state(root);
+	m = s->multipv < n ? s->multipv : n;
+	for(k=0; k<m; k++) {
+		best = -INF;
+		for(i=k; i<n; i++) {
+			child = *root;
+			doMove_state(&child, &list[i]);
+			score = -alphaBeta_search(s, &child, depth-1, -INF, -best, 1);
+			if(s->stop)
+				return 0;
+			if(score > best) {
+				best = score;
+				tmp = list[i];				//Leva o movimento para a posicao da variante
+				memmove(list+k+1, list+k, (i-k)*sizeof(Move));
+				list[k] = tmp;
+				lines[k][0] = tmp;
+				memcpy(lines[k]+1, s->pv[1], s->pv_len[1]*sizeof(Move));
+				len[k] = s->pv_len[1]+1;
+				scores[k] = score;
+			}
+		}
+	}
+
+	for(k=0; k<m; k++) {				//Iteracao completa
+		len[k] = extend_search(s, root, lines[k], len[k], depth);
+		memcpy(s->lines[k], lines[k], len[k]*sizeof(Move));
+		s->lines_len[k] = len[k];
+		s->lines_score[k] = scores[k];
+	}
+	s->n_lines = m;
+	memcpy(s->pv[0], lines[0], len[0]*sizeof(Move));
+	s->pv_len[0] = len[0];
+	return scores[0];
+}
+
+/*Escreve as linhas info do protocolo UCI com o resultado de uma iteracao, uma por variante com multipv.
+	Parametros
+		Search* s	busca
+*/
+static void info_search(Search* s) {
+	int i, k;
+	long long t;
+	char str[6];
+	char score[20];
+	char multipv[20];
+
+	t = elapsed_search(s);
+	for(k=0; k < (s->multipv > 0 ? s->n_lines : 1); k++) {
+		multipv[0] = '\0';
+		if(s->multipv > 0)
+			sprintf(multipv, " multipv %d", k+1);
+		fprintf(s->out, "info depth %d%s score %s nodes %lld nps %lld hashfull %d time %lld pv", s->depth, multipv, str_score(s->multipv > 0 ? s->lines_score[k] : s->score, score),
+			s->nodes, s->nodes*1000/(t ? t : 1), hashfull_ttable(s->tt), t);
+		for(i=0; i < (s->multipv > 0 ? s->lines_len[k] : s->pv_len[0]); i++)
+			fprintf(s->out, " %s", str_move(s->multipv > 0 ? &s->lines[k][i] : &s->pv[0][i], str));
+		fprintf(s->out, "\n");
+	}
+	fflush(s->out);
+}
+
+/*Responde a busca pelo cache de analise, sem busca, se a raiz tem uma pontuacao exata de profundidade nao menor
+que a maxima e o movimento gravado e possivel. Nao se aplica a buscas sem limite ou multi-PV, nem quando o
+historico do jogo pode tornar a raiz ou a variante um empate por repeticao. A variante segue os movimentos
+gravados no cache; as pontuacoes das profundidades anteriores, desconhecidas, recebem a pontuacao gravada, e
+s->cached indica a resposta.
+	Parametros
+		Search* s		busca
+		const State* root	raiz
+		Move* list		movimentos da raiz
+		int n			numero de movimentos
+	Retorno
+		TRUE se a busca foi respondida, FALSE caso contrario
+*/
+static boolean cached_search(Search* s, const State* root, Move* list, int n) {
+	TTEntry e, next;
+	int i, d;
+	State st;
+	Move m;
+
+	if(s->cache == NULL || s->infinite || s->multipv > 0 || (s->n_keys > 0 && root->mid_turns > 0) || !probe_cache(s->cache, key_state(root), &e) || e.bound != EXACT || e.depth < s->max_depth || e.best.file < 0)
+		return FALSE;
+	for(i=0; i<n && (e.best.file != list[i].file || e.best.rank != list[i].rank || cmp_position(&e.best.dest, &list[i].dest)); i++);
+	if(i == n)
+		return FALSE;
+	s->best = s->pv[0][0] = list[i];
+	s->pv_len[0] = 1;
+	st = *root;
+	s->path[0] = key_state(&st);
+	doMove_state(&st, &list[i]);
+	for(d=1; d < e.depth && d < MAX_PLY; d++) {	//Variante pelos movimentos gravados, sem repeticoes
+		s->path[d] = key_state(&st);
+		if(repetition_search(s, &st, s->path[d], d) || !probe_cache(s->cache, s->path[d], &next) || next.best.file < 0)
+			break;
+		m = next.best;
+		if(!legal_state(&st, &m))
+			break;
+		s->pv[0][s->pv_len[0]++] = m;
+		doMove_state(&st, &m);
+	}
+	s->depth = e.depth;
+	s->score = e.score;
+	for(d=1; d<=s->depth; d++)
+		s->scores[d] = e.score;
+	s->change_depth = s->depth;		//Respondida sem nos e sem tempo de busca
+	s->change_time = s->change_nodes = 0;
+	s->cached = TRUE;
+	if(s->out != NULL)
+		info_search(s);
+	return TRUE;
+}
+
+boolean iterate_search(Search* s) {
+	int d, n, score, pieces;
+	int order[MAX_MOVES];
+	Move list[MAX_MOVES];
+	State root;
+
+	clock_gettime(CLOCK_MONOTONIC, &s->start);
+	memset(s->phase, 0, sizeof(s->phase));
+	memset(s->phase_calls, 0, sizeof(s->phase_calls));
+	s->phase[TIME_TOTAL] = clock_ns();
+	s->nodes = 0;
+	s->depth = 0;
+	s->score = 0;
+	s->change_depth = 0;
+	s->change_time = s->change_nodes = 0;
+	s->cached = FALSE;
+	s->tt->gen++;
+	getState_chess(s->chess, &root);		//A busca trabalha sobre copias da posicao, o jogo nao e alterado
+	if(!(n = gen_search(s, &root, list))) {		//Nenhum movimento possivel
+		flush_stats();
+		return FALSE;
+	}
+	s->best = list[0];				//Garante um movimento mesmo se a busca for interrompida
+	s->n_lines = 0;
+	if(s->multipv > MAX_MULTIPV)
+		s->multipv = MAX_MULTIPV;
+	if(s->multipv > 0) {				//Ordem inicial da raiz: capturas e promocoes
+		order_search(&root, list, n, NULL, order);
+		for(d=0; d<n; d++)
+			pick_search(list, order, n, d);
+	}
+
+	if(!cached_search(s, &root, list, n))		//Posicao ja analisada ate a profundidade pedida
+		for(d=1; d<=s->max_depth && d<MAX_PLY; d++) {
+			score = s->multipv > 0 ? multi_search(s, &root, list, n, d) : alphaBeta_search(s, &root, d, -INF, INF, 0);
+			if(s->stop)			//Iteracao incompleta e descartada
+				break;
+			s->depth = d;
+			s->score = score;
+			s->scores[d] = score;
+			if(s->pv_len[0] && (d == 1 || code_move(&s->best) != code_move(&s->pv[0][0]))) {	//Novo melhor movimento
+				s->change_depth = d;
+				s->change_time = elapsed_search(s);
+				s->change_nodes = s->nodes;
+			}
+			if(s->pv_len[0])
+				s->best = s->pv[0][0];
+			if(s->out != NULL)
+				info_search(s);
+			if(abs(score) > MATE-MAX_PLY && !s->infinite)	//Mate encontrado
+				break;
+		}
+	s->phase[TIME_TOTAL] = clock_ns() - s->phase[TIME_TOTAL];
+#ifndef NO_STATS
+	sample_search(s, TIME_GEN);
+	sample_search(s, TIME_EVAL);
+	s->phase[TIME_SEARCH] = s->phase[TIME_TOTAL] - s->phase[TIME_GEN] - s->phase[TIME_EVAL];
+	if(s->phase[TIME_SEARCH] < 0)		//Erro da amostragem
+		s->phase[TIME_SEARCH] = 0;
+#else
+	s->phase[TIME_GEN] = s->phase[TIME_EVAL] = -1;	//Fases nao medidas
+	s->phase[TIME_SEARCH] = s->phase[TIME_TOTAL];
+#endif
+	for(d=pieces=0; d<64; d++)
+		pieces += root.board[d] != EMPTY;
+	record_latency(pieces, n, s->phase);
+	COUNT(nodes, s->nodes);
+	flush_stats();
+	return TRUE;
+}
+
+void initialize_mate(Mate* m, size_t mb) {
+	size_t k;
+	memset(m, 0, sizeof(Mate));
+	for(k=1; 2*k*sizeof(PNEntry) <= mb*1024*1024; k*=2);	//Maior potencia de 2 que cabe no tamanho
+	m->entry = (PNEntry*) calloc(k, sizeof(PNEntry));
+	COUNT_ALLOC(ALLOC_TTABLE, k*sizeof(PNEntry));
+	m->m = k;
+	m->max_nodes = -1;
+}
+
+void finalize_mate(Mate* m) {
+	free(m->entry);
+	m->entry = NULL;
+	m->m = 0;
+}
+
+/*Combina a chave de uma posicao com a profundidade restante: a mesma posicao tem entradas distintas por
+profundidade e nao ha ciclos entre elas.
+	Parametros
+		uint64_t key	chave zobrist da posicao
+		int depth	profundidade restante em meios-turnos
+	Retorno
+		chave da entrada
+*/
+static uint64_t key_mate(uint64_t key, int depth) {
+	key ^= (uint64_t) (depth+1) * 0x9E3779B97F4A7C15ULL;
+	return key ? key : 1;
+}
+
+/*Le os numeros de prova de uma posicao na tabela da busca de mate. Posicoes ausentes recebem os valores iniciais.
+	Parametros
+		Mate* m			busca
+		uint64_t key		chave da entrada
+		uint32_t* phi		recipiente para o numero de prova do turno
+		uint32_t* delta		recipiente para o numero de refutacao do turno
+		uint32_t init		numero de refutacao inicial
+*/
+static void probe_mate(Mate* m, uint64_t key, uint32_t* phi, uint32_t* delta, uint32_t init) {
+	PNEntry* e;
+	e = &m->entry[key & (m->m-1)];
+	COUNT(tt_probes, 1);
+	if(e->key != key || e->gen != m->gen) {
+		*phi = 1;
+		*delta = init;
+		return;
+	}
+	COUNT(tt_hits, 1);
+	*phi = e->phi;
+	*delta = e->delta;
+}
+
+/*Grava os numeros de prova de uma posicao na tabela da busca de mate. Entradas de outra busca, da mesma posicao
+ou de menos trabalho sao substituidas.
+	Parametros
+		Mate* m		busca
+		uint64_t key	chave da entrada
+		uint32_t phi	numero de prova do turno
+		uint32_t delta	numero de refutacao do turno
+		long long work	nos visitados na avaliacao
+*/
+static void store_mate(Mate* m, uint64_t key, uint32_t phi, uint32_t delta, long long work) {
+	PNEntry* e;
+	e = &m->entry[key & (m->m-1)];
+	if(e->key && e->gen == m->gen && e->key != key && e->work > work)
+		return;
+	e->key = key;
+	e->phi = phi;
+	e->delta = delta;
+	e->work = work < PN_INF ? work : PN_INF;
+	e->gen = m->gen;
+}
+
+/*Expande uma posicao da busca de mate ate que os numeros de prova atinjam os limites (procedimento MID do df-pn,
+na forma negamax). O atacante joga com profundidade restante impar; com profundidade 0 so resta verificar o mate.
+	Parametros
+		Mate* m			busca
+		const State* st		posicao
+		int depth		profundidade restante em meios-turnos
+		uint32_t thphi		limite do numero de prova
+		uint32_t thdelta	limite do numero de refutacao
+		uint32_t* phi		recipiente para o numero de prova do turno
+		uint32_t* delta		recipiente para o numero de refutacao do turno
+*/
+static void mid_mate(Mate* m, const State* st, int depth, uint32_t thphi, uint32_t thdelta, uint32_t* phi, uint32_t* delta) {
+	int i, n, k, best;
+	uint32_t sum, min, min2;
+	long long start;
+	uint32_t phis[MAX_MOVES];
+	uint32_t deltas[MAX_MOVES];
+	Move list[MAX_MOVES];
+	State child;
+
+	start = m->nodes++;
+	if(m->max_nodes >= 0 && m->nodes >= m->max_nodes)
+		m->stop = TRUE;
+	n = genMoves_state(st, list);
+	if(!n || !depth) {			//Sem movimentos (mate ou afogamento) ou fim da profundidade: folha
+		if(!n && (depth%2 || incheck_state(st))) {	//O turno perde: mate, ou o atacante afogado
+			*phi = PN_INF;
+			*delta = 0;
+		}
+		else {
+			*phi = 0;
+			*delta = PN_INF;
+		}
+		store_mate(m, key_mate(key_state(st), depth), *phi, *delta, 1);
+		return;
+	}
+	for(i=k=0; i<n; i++) {			//Numeros dos filhos; os lances do atacante sem xeque sao menos promissores
+		child = *st;
+		doMove_state(&child, &list[i]);
+		if(depth%2 && !incheck_state(&child)) {
+			if(depth == 1)		//Ultimo lance: so um xeque pode ser mate
+				continue;
+			probe_mate(m, key_mate(key_state(&child), depth-1), &phis[k], &deltas[k], 3);
+		}
+		else
+			probe_mate(m, key_mate(key_state(&child), depth-1), &phis[k], &deltas[k], 1);
+		list[k++] = list[i];
+	}
+
+	while(TRUE) {				//Os numeros dos filhos ficam locais: entradas substituidas na tabela nao se perdem
+		sum = 0;
+		min = min2 = PN_INF;
+		best = 0;
+		for(i=0; i<k; i++) {
+			sum = sum + phis[i] < PN_INF ? sum + phis[i] : PN_INF;
+			if(deltas[i] < min) {
+				min2 = min;
+				min = deltas[i];
+				best = i;
+			}
+			else
+				if(deltas[i] < min2)
+					min2 = deltas[i];
+		}
+		*phi = min;			//O turno vence se algum filho perde
+		*delta = sum;			//O turno perde se todos os filhos vencem
+		if(*phi >= thphi || *delta >= thdelta || m->stop)
+			break;
+		child = *st;			//Filho mais promissor, ate superar o segundo (limite 1+epsilon)
+		doMove_state(&child, &list[best]);
+		mid_mate(m, &child, depth-1, thdelta - sum + phis[best], min2 + min2/4 + 1 < thphi ? min2 + min2/4 + 1 : thphi, &phis[best], &deltas[best]);
+	}
+	store_mate(m, key_mate(key_state(st), depth), *phi, *delta, m->nodes - start);
+}
+
+/*Resolve uma posicao da busca de mate com uma profundidade fixa.
+	Parametros
+		Mate* m			busca
+		const State* st		posicao
+		int depth		profundidade restante em meios-turnos
+	Retorno
+		1 se o turno vence, 0 se nao pode vencer, -1 se o limite de nos foi atingido
+*/
+static int prove_mate(Mate* m, const State* st, int depth) {
+	uint32_t phi, delta;
+	mid_mate(m, st, depth, PN_INF, PN_INF, &phi, &delta);
+	return delta >= PN_INF ? 1 : phi >= PN_INF ? 0 : -1;
+}
+
+/*Menor profundidade em que o atacante, no turno, tem mate provado.
+	Parametros
+		Mate* m			busca
+		const State* st		posicao
+		int depth		profundidade maxima em meios-turnos (impar)
+	Retorno
+		profundidade do mate, -1 se nao ha mate provado
+*/
+static int distance_mate(Mate* m, const State* st, int depth) {
+	int d;
+	for(d=1; d<=depth; d+=2)
+		if(prove_mate(m, st, d) == 1)
+			return d;
+	return -1;
+}
+
+/*Extrai a variante de um mate provado: o atacante escolhe um lance que mantem a distancia do mate e o defensor
+o lance que a torna maxima.
+	Parametros
+		Mate* m			busca
+		const State* root	posicao
+		int depth		distancia do mate em meios-turnos
+*/
+static void line_mate(Mate* m, const State* root, int depth) {
+	int i, n, d, best, max;
+	Move list[MAX_MOVES];
+	State st, child;
+
+	st = *root;
+	m->pv_len = 0;
+	while(depth > 0 && !m->stop) {
+		n = genMoves_state(&st, list);
+		best = -1;
+		max = -1;
+		for(i=0; i<n && !m->stop; i++) {
+			child = st;
+			doMove_state(&child, &list[i]);
+			if(depth%2) {			//Atacante: primeiro lance que mantem o mate
+				if(prove_mate(m, &child, depth-1) == 0) {
+					best = i;
+					max = depth-1;
+					break;
+				}
+			}
+			else
+				if((d = distance_mate(m, &child, depth-1)) > max) {	//Defensor: defesa mais longa
+					best = i;
+					max = d;
+					if(d == depth-1)
+						break;
+				}
+		}
+		if(best < 0)
+			break;
+		m->pv[m->pv_len++] = list[best];
+		doMove_state(&st, &list[best]);
+		depth = max;
+	}
+}
+
+int solve_mate(Mate* m, const State* st, int n) {
+	int k, r;
+
+	m->gen++;
+	m->nodes = 0;
+	m->stop = FALSE;
+	m->pv_len = 0;
+	for(k=1, r=0; k<=n && 2*k-1 < MAX_PLY; k++)	//Mates mais curtos primeiro: a primeira prova e a mais curta
+		if((r = prove_mate(m, st, 2*k-1)) != 0)
+			break;
+	if(r == 1)
+		line_mate(m, st, 2*k-1);
+	COUNT(nodes, m->nodes);
+	return r == 1 ? k : r;
+}
+
+void initialize_mcts(Mcts* m, size_t mb) {
+	memset(m, 0, sizeof(Mcts));
+	m->m = mb*1024*1024/sizeof(MctsNode);
+	if(m->m > UINT32_MAX)				//Indices de 32 bits
+		m->m = UINT32_MAX;
+	if(m->m < 1)
+		m->m = 1;
+	m->node = (MctsNode*) malloc(m->m*sizeof(MctsNode));	//Paginas tocadas somente quando usadas
+	COUNT_ALLOC(ALLOC_TTABLE, m->m*sizeof(MctsNode));
+	m->threads = 1;
+	m->cpuct = MCTS_CPUCT;
+	m->max_playouts = -1;
+	m->max_time = -1;
+}
+
+void finalize_mcts(Mcts* m) {
+	free(m->node);
+	m->node = NULL;
+	m->m = 0;
+}
+
+/*Converte uma pontuacao em centipeoes na chance de vitoria do turno.
+	Parametros
+		int score	pontuacao do ponto de vista do turno
+	Retorno
+		valor entre 0 e 1
+*/
+static double value_mcts(int score) {
+	return 1/(1 + pow(10, -score/(double) MCTS_CP));
+}
+
+/*Converte uma chance de vitoria em centipeoes, limitada a +-6 MCTS_CP (chances de 1 em um milhao).
+	Parametros
+		double v	valor entre 0 e 1
+	Retorno
+		pontuacao
+*/
+static int score_mcts(double v) {
+	if(v < 1e-6)
+		v = 1e-6;
+	if(v > 1-1e-6)
+		v = 1-1e-6;
+	return (int) lround(MCTS_CP*log10(v/(1-v)));
+}
+
+/*Cria os filhos de um no no pool. As probabilidades a priori crescem com a prioridade de ordenacao da busca
+alfa-beta (capturas e promocoes) e somam 1. Somente a thread que reservou o no (MCTS_BUSY) chama a funcao.
+	Parametros
+		Mcts* m		busca
+		MctsNode* node	no
+		const State* st	posicao do no
+		Move* list	movimentos possiveis
+		int n		numero de movimentos, ao menos 1
+	Retorno
+		TRUE se os filhos foram criados, FALSE se o pool se esgotou (a busca e interrompida)
+*/
+static boolean expand_mcts(Mcts* m, MctsNode* node, const State* st, Move* list, int n) {
+	int i;
+	int order[MAX_MOVES];
+	size_t k;
+	double sum;
+	MctsNode* child;
+
+	k = __atomic_fetch_add(&m->n, n, __ATOMIC_RELAXED);
+	if(k + n > m->m) {
+		m->full = TRUE;
+		m->stop = TRUE;
+		return FALSE;
+	}
+	order_search(st, list, n, NULL, order);
+	for(i=0, sum=0; i<n; i++)
+		sum += 1 + (order[i] > 0 ? order[i] : 0)/1000.0;
+	for(i=0; i<n; i++) {
+		child = &m->node[k+i];
+		child->value = 0;
+		child->visits = child->virtual = 0;
+		child->child = 0;
+		child->n_child = 0;
+		child->state = MCTS_NEW;
+		child->move = list[i];
+		child->prior = (1 + (order[i] > 0 ? order[i] : 0)/1000.0)/sum;
+	}
+	node->child = k;
+	node->n_child = n;
+	__atomic_store_n(&node->state, MCTS_OPEN, __ATOMIC_RELEASE);	//Publica os filhos
+	return TRUE;
+}
+
+/*Escolhe o filho de maior valor PUCT: Q + cpuct * P * sqrt(N) / (1 + n). As visitas em andamento contam como
+derrotas, afastando as demais threads do mesmo caminho.
+	Parametros
+		Mcts* m		busca
+		MctsNode* node	no expandido, com filhos
+	Retorno
+		indice do filho
+*/
+static int select_mcts(Mcts* m, MctsNode* node) {
+	int i, best, n, visits;
+	double q, u, fpu, sq, max;
+	MctsNode* child;
+
+	visits = __atomic_load_n(&node->visits, __ATOMIC_RELAXED);
+	n = visits + __atomic_load_n(&node->virtual, __ATOMIC_RELAXED);
+	sq = sqrt((double) n + 1);
+	fpu = (visits ? 1 - (double) __atomic_load_n(&node->value, __ATOMIC_RELAXED)/MCTS_SCALE/visits : 0.5) - MCTS_FPU;
+	best = 0;
+	max = -1e9;
+	for(i=0; i<node->n_child; i++) {
+		child = &m->node[node->child + i];
+		n = __atomic_load_n(&child->visits, __ATOMIC_RELAXED) + __atomic_load_n(&child->virtual, __ATOMIC_RELAXED);
+		q = n ? (double) __atomic_load_n(&child->value, __ATOMIC_RELAXED)/MCTS_SCALE/n : fpu;
+		u = q + m->cpuct*child->prior*sq/(1 + n);
+		if(u > max) {
+			max = u;
+			best = i;
+		}
+	}
+	return best;
+}
+
+/*Um playout: selecao a partir da raiz, expansao e avaliacao da folha e atualizacao do caminho.
+	Parametros
+		Mcts* m		busca
+		Search* s	busca quiescente da thread, com as chaves do jogo; s->path recebe as chaves do caminho
+*/
+static void playout_mcts(Mcts* m, Search* s) {
+	int i, n, ply;
+	uint32_t path[MAX_PLY];
+	unsigned char state;
+	double v;
+	Move list[MAX_MOVES];
+	MctsNode* node;
+	State st;
+
+	st = m->root;
+	node = &m->node[0];
+	path[0] = 0;
+	ply = 0;
+	__atomic_fetch_add(&node->virtual, 1, __ATOMIC_RELAXED);
+	while(TRUE) {
+		if(ply > 0 && (st.mid_turns >= 50 || repetition_search(s, &st, st.key, ply))) {	//Empate, mesma regra de sit_chess
+			v = 0.5;
+			break;
+		}
+		state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+		if(state == MCTS_OPEN && !node->n_child) {	//Posicao final ja conhecida
+			v = incheck_state(&st) ? 1 : 0.5;
+			break;
+		}
+		if(state != MCTS_OPEN || ply >= MAX_PLY-1) {	//Folha, expandida a partir da segunda visita: valor para o jogador que fez o movimento do no
+			n = genMoves_state(&st, list);
+			if(state == MCTS_NEW && ply < MAX_PLY-1 && (!ply || __atomic_load_n(&node->visits, __ATOMIC_RELAXED)) && __atomic_compare_exchange_n(&node->state, &state, MCTS_BUSY, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				if(!n) {
+					node->child = 0;
+					node->n_child = 0;
+					__atomic_store_n(&node->state, MCTS_OPEN, __ATOMIC_RELEASE);
+				}
+				else if(!expand_mcts(m, node, &st, list, n))
+					__atomic_store_n(&node->state, MCTS_NEW, __ATOMIC_RELEASE);
+			}
+			if(!n)
+				v = incheck_state(&st) ? 1 : 0.5;
+			else
+				v = 1 - value_mcts(quiescence_search(s, &st, -INF, INF, ply));
+			break;
+		}
+		s->path[ply] = st.key;
+		i = select_mcts(m, node);
+		node = &m->node[node->child + i];
+		doMove_state(&st, &node->move);
+		path[++ply] = node - m->node;
+		__atomic_fetch_add(&node->virtual, 1, __ATOMIC_RELAXED);
+	}
+	for(; ply >= 0; ply--) {				//Do ponto de vista de cada jogador, alternadamente
+		node = &m->node[path[ply]];
+		__atomic_fetch_add(&node->value, (int64_t) (v*MCTS_SCALE), __ATOMIC_RELAXED);
+		__atomic_fetch_add(&node->visits, 1, __ATOMIC_RELAXED);
+		__atomic_fetch_sub(&node->virtual, 1, __ATOMIC_RELAXED);
+		v = 1 - v;
+	}
+}
+
+/*Obtem o movimento mais visitado da raiz, sua pontuacao e a variante pelos filhos mais visitados.
+	Parametros
+		Mcts* m		busca
+*/
+static void pv_mcts(Mcts* m) {
+	int i, best, visits, max;
+	MctsNode* node;
+	MctsNode* child;
+
+	m->pv_len = 0;
+	node = &m->node[0];
+	while(m->pv_len < MAX_PLY && __atomic_load_n(&node->state, __ATOMIC_ACQUIRE) == MCTS_OPEN && node->n_child) {
+		for(i=0, best=-1, max=0; i<node->n_child; i++)
+			if((visits = __atomic_load_n(&m->node[node->child + i].visits, __ATOMIC_RELAXED)) > max) {
+				max = visits;
+				best = i;
+			}
+		if(best < 0)
+			break;
+		child = &m->node[node->child + best];
+		if(!m->pv_len) {
+			m->best = child->move;
+			m->score = score_mcts((double) __atomic_load_n(&child->value, __ATOMIC_RELAXED)/MCTS_SCALE/max);
+		}
+		m->pv[m->pv_len++] = child->move;
+		node = child;
+	}
+}
+
+/*Escreve uma linha info com a variante atual: nodes e nps contam playouts, hashfull e a ocupacao do pool.
+	Parametros
+		Mcts* m		busca
+*/
+static void info_mcts(Mcts* m) {
+	int i;
+	long long t, playouts;
+	size_t n;
+	char str[6];
+	char score[20];
+
+	pv_mcts(m);
+	t = (clock_ns() - m->start)/1000000;
+	playouts = __atomic_load_n(&m->playouts, __ATOMIC_RELAXED);
+	n = __atomic_load_n(&m->n, __ATOMIC_RELAXED);
+	fprintf(m->out, "info depth %d score %s nodes %lld nps %lld hashfull %d time %lld pv", m->pv_len, str_score(m->score, score), playouts, playouts*1000/(t ? t : 1), (int) ((n < m->m ? n : m->m)*1000/m->m), t);
+	for(i=0; i<m->pv_len; i++)
+		fprintf(m->out, " %s", str_move(&m->pv[i], str));
+	fprintf(m->out, "\n");
+	fflush(m->out);
+}
+
+/*Executa playouts ate a parada. Os limites de tempo sao verificados a cada 16 playouts da thread.
+	Parametros
+		Mcts* m		busca
+		boolean main	thread que chamou search_mcts: escreve as linhas info periodicas
+*/
+static void work_mcts(Mcts* m, boolean main) {
+	long long k, t, info;
+	Search* s;
+
+	s = (Search*) calloc(1, sizeof(Search));	//Somente para a busca quiescente e a repeticao
+	s->keys = m->keys;
+	s->n_keys = m->n_keys;
+	s->max_nodes = -1;
+	s->max_time = -1;
+	info = m->start + 1000000000LL;
+	for(k=1; !m->stop; k++) {
+		playout_mcts(m, s);
+		if(m->max_playouts >= 0 && __atomic_add_fetch(&m->playouts, 1, __ATOMIC_RELAXED) >= m->max_playouts)
+			m->stop = TRUE;
+		else if(m->max_playouts < 0)
+			__atomic_fetch_add(&m->playouts, 1, __ATOMIC_RELAXED);
+		if(k & 15)
+			continue;
+		t = clock_ns();
+		if(m->max_time >= 0 && (t - m->start)/1000000 >= m->max_time)
+			m->stop = TRUE;
+		if(main && m->out != NULL && t >= info && !m->stop) {
+			info_mcts(m);
+			info += 1000000000LL;
+		}
+	}
+	__atomic_fetch_add(&m->nodes, s->nodes, __ATOMIC_RELAXED);
+	COUNT(nodes, s->nodes);
+	flush_stats();
+	free(s);
+}
+
+/*Funcao das threads auxiliares de search_mcts.
+	Parametros
+		void* arg	busca
+	Retorno
+		NULL
+*/
+static void* thread_mcts(void* arg) {
+	work_mcts((Mcts*) arg, FALSE);
+	return NULL;
+}
+
+boolean search_mcts(Mcts* m, const State* st) {
+	int i;
+	Move list[MAX_MOVES];
+	pthread_t* tid;
+
+	if(!genMoves_state(st, list))
+		return FALSE;
+	m->root = *st;
+	m->start = clock_ns();
+	m->full = FALSE;
+	m->playouts = m->nodes = 0;
+	m->best = list[0];
+	m->score = 0;
+	memset(&m->node[0], 0, sizeof(MctsNode));	//Raiz: MCTS_NEW
+	m->n = 1;
+	if(m->threads < 1)
+		m->threads = 1;
+	tid = (pthread_t*) malloc(m->threads*sizeof(pthread_t));
+	for(i=1; i<m->threads; i++)
+		pthread_create(&tid[i], NULL, thread_mcts, m);
+	work_mcts(m, TRUE);
+	for(i=1; i<m->threads; i++)
+		pthread_join(tid[i], NULL);
+	free(tid);
+	m->time = (clock_ns() - m->start)/1000000;
+	if(m->n > m->m)					//Reservas que nao couberam no pool
+		m->n = m->m;
+	if(m->out != NULL)
+		info_mcts(m);
+	else
+		pv_mcts(m);
+	return TRUE;
+}
+
+boolean epdToFen(char* line, char* fen, size_t n) {
+	char* tok[6];
+	char* save;
+	char* buf;
+	int k;
+
+	buf = strdup(line);
+	for(k=0; k<6 && NULL != (tok[k] = strtok_r(k ? NULL : buf, " \t\r\n", &save)); k++);
+	//Campos 5 e 6 somente se numericos (FEN); numa linha EPD sao operacoes
+	if(k < 6 || !isdigit(tok[4][0]) || !isdigit(tok[5][0]))
+		tok[4] = "0", tok[5] = "1";
+	if(k < 4 || (size_t) snprintf(fen, n, "%s %s %s %s %s %s", tok[0], tok[1], tok[2], tok[3], tok[4], tok[5]) >= n) {
+		free(buf);
+		return FALSE;
+	}
+	free(buf);
+	return TRUE;
+}
+
+boolean epdOperand(const char* line, const char* op, char* buf, size_t n) {
+	int k, len;
+	const char* end;
+
+	for(k=0; k<4; k++) {				//Campos da posicao
+		for(; isspace(*line); line++);
+		for(; *line && !isspace(*line); line++);
+	}
+	len = strlen(op);
+	while(*line) {
+		for(; isspace(*line) || *line == ';'; line++);
+		for(end=line; *end && *end != ';'; end++)	//Fim da operacao, fora das aspas
+			if(*end == '"' && NULL == (end = strchr(end+1, '"'))) {
+				end = line + strlen(line);
+				break;
+			}
+		if(!strncmp(line, op, len) && (isspace(line[len]) || line+len == end)) {
+			for(line+=len; line < end && isspace(*line); line++);
+			for(; end > line && isspace(end[-1]); end--);
+			if(end-line >= 2 && *line == '"' && end[-1] == '"')
+				line++, end--;
+			if((size_t) (end-line) >= n)
+				return FALSE;
+			memcpy(buf, line, end-line);
+			buf[end-line] = '\0';
+			return TRUE;
+		}
+		line = *end ? end+1 : end;
+	}
+	return FALSE;
+}
+
+char* str_score(int score, char* str) {
+	if(abs(score) > MATE-MAX_PLY)
+		sprintf(str, "mate %d", score > 0 ? (MATE-score+1)/2 : -(MATE+score)/2);
+	else
+		sprintf(str, "cp %d", score);
+	return str;
+}
+
+const char* str_sit(Gamesit sit) {
+	switch(sit) {
+		case W_WINS: return "Xeque-mate -- Vitoria: BRANCO";
+		case B_WINS: return "Xeque-mate -- Vitoria: PRETO";
+		case STALEMATE: return "Empate -- Afogamento";
+		case FIFTY: return "Empate -- Regra dos 50 Movimentos";
+		case MATERIAL: return "Empate -- Falta de Material";
+		case REPETITION: return "Empate -- Tripla Repeticao";
+		default: return NULL;
+	}
+}
+
+/*Separa os campos de um movimento em notacao algebrica padrao (SAN).
+	Parametros
+		const char* san		movimento, sem terminador
+		int n			tamanho
+		char turn		turno
+		Piecename* type		recipiente para o tipo da peca (cor branca)
+		char* file		recipiente para a coluna destino
+		char* rank		recipiente para a linha destino
+		char* from_file		recipiente para a coluna de origem, -1 se nao indicada
+		char* from_rank		recipiente para a linha de origem, -1 se nao indicada
+		char* promotion		recipiente para a letra da promocao, 0 se nenhuma
+	Retorno
+		TRUE se o movimento e bem formado, FALSE caso contrario
+*/
+static boolean fields_san(const char* san, int n, char turn, Piecename* type, char* file, char* rank, char* from_file, char* from_rank, char* promotion) {
+	int i;
+
+	while(n && (san[n-1] == '+' || san[n-1] == '#' || san[n-1] == '!' || san[n-1] == '?'))	//Xeque e anotacoes
+		n--;
+	*from_file = *from_rank = -1;
+	*promotion = 0;
+	if((n == 3 || n == 5) && (san[0] == 'O' || san[0] == '0')) {	//Roque
+		if(san[1] != '-' || san[2] != san[0] || (n == 5 && (san[3] != '-' || san[4] != san[0])))
+			return FALSE;
+		*type = WK;
+		*from_file = 4;
+		*from_rank = turn ? 7 : 0;
+		*file = n == 3 ? 6 : 2;
+		*rank = *from_rank;
+		return TRUE;
+	}
+	i = 0;
+	*type = WP;
+	if(n && strchr("KQRBN", san[0]) != NULL)	//Peca; sem letra, peao
+		*type = genName_piece(san[i++]);
+	if(n >= 2 && san[n-2] == '=') {			//Promocao
+		*promotion = san[n-1];
+		n -= 2;
+	}
+	else
+		if(*type == WP && n >= 3 && strchr("QRBN", san[n-1]) != NULL)
+			*promotion = san[--n];
+	if(n-i < 2 || san[n-2] < 'a' || san[n-2] > 'h' || san[n-1] < '1' || san[n-1] > '8')
+		return FALSE;
+	*file = san[n-2]-'a';
+	*rank = san[n-1]-'1';
+	for(n-=2; i<n; i++) {				//Desambiguacao e captura
+		if(san[i] >= 'a' && san[i] <= 'h')
+			*from_file = san[i]-'a';
+		else
+			if(san[i] >= '1' && san[i] <= '8')
+				*from_rank = san[i]-'1';
+			else
+				if(san[i] != 'x' && san[i] != ':' && san[i] != '-')
+					return FALSE;
+	}
+	return TRUE;
+}
+
+/*Encontra o unico movimento da lista que corresponde aos campos de um movimento SAN.
+	Parametros
+		const Move* list	movimentos possiveis
+		int n			numero de movimentos
+		const Piecename* ids	id da peca na origem de cada movimento
+		Piecename type		tipo da peca (cor branca)
+		char file		coluna destino
+		char rank		linha destino
+		char from_file		coluna de origem, -1 se nao indicada
+		char from_rank		linha de origem, -1 se nao indicada
+		char promotion		letra da promocao, 0 se nenhuma
+	Retorno
+		indice do movimento, -1 se nenhum ou ambiguo
+*/
+static int match_san(const Move* list, int n, const Piecename* ids, Piecename type, char file, char rank, char from_file, char from_rank, char promotion) {
+	int i, found;
+	for(i=0, found=-1; i<n; i++) {
+		if((ids[i]+1)/2 != (type+1)/2 || list[i].dest.file != file || list[i].dest.rank != rank)	//Tipo da peca, sem cor
+			continue;
+		if((from_file >= 0 && list[i].file != from_file) || (from_rank >= 0 && list[i].rank != from_rank))
+			continue;
+		if(promotion ? list[i].dest.x != promotion : isupper(list[i].dest.x))
+			continue;
+		if(found >= 0)					//Ambiguo
+			return -1;
+		found = i;
+	}
+	return found;
+}
+
+boolean parseSan_chess(Chess* chess, const char* san, int n, Piece** piece, Position* dest) {
+	int i, found;
+	char file, rank, from_file, from_rank, promotion;
+	Piecename type;
+	Piecename ids[MAX_MOVES];
+	Move list[MAX_MOVES];
+
+	if(!fields_san(san, n, chess->turn, &type, &file, &rank, &from_file, &from_rank, &promotion))
+		return FALSE;
+	n = genMoves_chess(chess, list);
+	for(i=0; i<n; i++)
+		ids[i] = chess->board[(int) list[i].rank][(int) list[i].file]->id;
+	if((found = match_san(list, n, ids, type, file, rank, from_file, from_rank, promotion)) < 0)
+		return FALSE;
+	*piece = chess->board[(int) list[found].rank][(int) list[found].file];
+	cpy_position(dest, &list[found].dest);
+	return TRUE;
+}
+
+boolean parseSan_state(const State* st, const char* san, int n, Move* move) {
+	int i, found;
+	char file, rank, from_file, from_rank, promotion;
+	Piecename type;
+	Piecename ids[MAX_MOVES];
+	Move list[MAX_MOVES];
+
+	if(!fields_san(san, n, st->turn, &type, &file, &rank, &from_file, &from_rank, &promotion))
+		return FALSE;
+	n = genMoves_state(st, list);
+	for(i=0; i<n; i++)
+		ids[i] = st->board[list[i].rank*8 + list[i].file];
+	if((found = match_san(list, n, ids, type, file, rank, from_file, from_rank, promotion)) < 0)
+		return FALSE;
+	*move = list[found];
+	return TRUE;
+}
+
+char* genSan_chess(Chess* chess, Move* move, char* san) {
+	int i, n;
+	boolean other, file, rank;
+	char* p;
+	Piece* piece;
+	Piece* aux;
+	Position* dest;
+	Move list[MAX_MOVES];
+	Undo undo;
+
+	p = san;
+	piece = chess->board[(int) move->rank][(int) move->file];
+	dest = &move->dest;
+	if(isking(piece->id) && abs(dest->file - move->file) == 2)	//Roque
+		p += sprintf(p, dest->file == 6 ? "O-O" : "O-O-O");
+	else {
+		if(ispawn(piece->id)) {
+			if(dest->file != move->file)			//Captura
+				*p++ = move->file + 'a';
+		}
+		else {
+			*p++ = toupper(genChar_piece(piece->id));
+			n = genMoves_chess(chess, list);		//Desambiguacao: outras pecas do mesmo tipo com o mesmo destino
+			other = file = rank = FALSE;
+			for(i=0; i<n; i++) {
+				aux = chess->board[(int) list[i].rank][(int) list[i].file];
+				if(aux == piece || aux->id != piece->id || list[i].dest.file != dest->file || list[i].dest.rank != dest->rank)
+					continue;
+				other = TRUE;
+				file |= list[i].file == move->file;	//Outra peca na mesma coluna
+				rank |= list[i].rank == move->rank;	//Outra peca na mesma linha
+			}
+			if(other && (!file || rank))			//Coluna, se suficiente; senao linha; senao ambas
+				*p++ = move->file + 'a';
+			if(other && file)
+				*p++ = move->rank + '1';
+		}
+		if(chess->board[(int) dest->rank][(int) dest->file] != NULL || dest->x == 'e')
+			*p++ = 'x';
+		*p++ = dest->file + 'a';
+		*p++ = dest->rank + '1';
+		if(isupper(dest->x)) {					//Promocao
+			*p++ = '=';
+			*p++ = dest->x;
+		}
+	}
+	doMove_chess(chess, move, &undo);				//Xeque e mate
+	if(incheck_chess(chess))
+		*p++ = genMoves_chess(chess, list) ? '+' : '#';
+	undoMove_chess(chess, &undo);
+	*p = '\0';
+	return san;
+}
+
+void packFen(const Fen* f, Packed* p) {
+	int sq, k;
+	const char* c;
+	const signed char* board;
+	uint8_t occupied[8], pieces[16];	//Locais: p pode ser alias de f
+
+	memset(occupied, 0, sizeof(occupied));
+	memset(pieces, 0, sizeof(pieces));
+	board = &f->board[0][0];
+	for(sq=k=0; sq<64; sq++)					//Ocupacao e pecas, na ordem das casas
+		if(board[sq] != EMPTY) {
+			occupied[sq >> 3] |= 1 << (sq & 7);
+			pieces[k >> 1] |= board[sq] << ((k & 1) << 2);
+			k++;
+		}
+	memcpy(p->occupied, occupied, sizeof(occupied));
+	memcpy(p->pieces, pieces, sizeof(pieces));
+	p->flags = f->turn;						//Turno e roque
+	for(c=f->castling; *c; c++)
+		p->flags |= 2 << (strchr("KQkq", *c) - "KQkq");
+	p->en_passant = f->en_passant.x ? f->en_passant.file+1 : 0;	//A linha do en passant depende do turno
+	p->mid_turns = f->mid_turns;
+	for(k=0; k<4; k++)
+		p->n_turns[k] = (uint32_t) f->n_turns >> 8*k;
+	p->reserved = 0;
+}
+
+boolean unpackFen(const Packed* p, Fen* f) {
+	int sq, k, i;
+	uint32_t n;
+
+	if(p->flags >> 5 || p->en_passant > 8 || p->reserved)
+		return FALSE;
+	memset(f->board, EMPTY, sizeof(f->board));
+	for(sq=k=0; sq<64; sq++)					//Pecas das casas ocupadas
+		if(p->occupied[sq/8] >> (sq%8) & 1) {
+			if(k == 32)
+				return FALSE;
+			f->board[sq/8][sq%8] = p->pieces[k/2] >> (k%2 ? 4 : 0) & 0xF;
+			k++;
+		}
+	f->turn = p->flags & 1;
+	for(i=k=0; k<4; k++)
+		if(p->flags & 2 << k)
+			f->castling[i++] = "KQkq"[k];
+	f->castling[i] = '\0';
+	f->en_passant.x = 0;
+	if(p->en_passant) {
+		f->en_passant.file = p->en_passant-1;
+		f->en_passant.rank = f->turn ? 2 : 5;
+		f->en_passant.x = 'e';
+	}
+	f->mid_turns = p->mid_turns;
+	for(n=k=0; k<4; k++)
+		n |= (uint32_t) p->n_turns[k] << 8*k;
+	if(n > INT_MAX)
+		return FALSE;
+	f->n_turns = n;
+	return validFen(f);						//Pecas, roque, en passant e xeque
+}
+
+void pack_chess(Chess* chess, Packed* p) {
+	Fen f;
+	getFen_chess(chess, &f);
+	packFen(&f, p);
+}
+
+boolean loadPacked_chess(Chess* chess, const Packed* p, Arena* arena) {
+	Fen f;
+	if(!unpackFen(p, &f))
+		return FALSE;
+	build_chess(chess, &f, arena);
+	return TRUE;
+}
+
+size_t encode_packed(char** fen, size_t n, Packed* p) {
+	size_t i, valid;
+	Fen f;
+	for(i=valid=0; i<n; i++)
+		if(parseFen(fen[i], &f)) {
+			packFen(&f, &p[i]);
+			valid++;
+		}
+		else
+			memset(&p[i], 0, sizeof(Packed));
+	return valid;
+}
+
+size_t decode_packed(const Packed* p, size_t n, char (*fen)[FEN_SIZE]) {
+	size_t i, valid;
+	Fen f;
+	for(i=valid=0; i<n; i++)
+		if(unpackFen(&p[i], &f)) {
+			writeFen(&f, fen[i]);
+			valid++;
+		}
+		else
+			fen[i][0] = '\0';
+	return valid;
+}
+
+FILE* create_packfile(const char* path) {
+	FILE* file;
+	char header[sizeof(Packed)];
+	if(NULL == (file = fopen(path, "wb")))
+		return NULL;
+	memset(header, 0, sizeof(header));		//Cabecalho do tamanho de um registro: registros alinhados no arquivo
+	memcpy(header, PACK_MAGIC, strlen(PACK_MAGIC));
+	if(fwrite(header, sizeof(header), 1, file) != 1) {
+		fclose(file);
+		return NULL;
+	}
+	return file;
+}
+
+boolean open_packfile(PackFile* pf, const char* path) {
+	struct stat st;
+
+	memset(pf, 0, sizeof(PackFile));
+	if((pf->fd = open(path, O_RDONLY)) < 0)
+		return FALSE;
+	if(fstat(pf->fd, &st) < 0 || st.st_size < (off_t) sizeof(Packed) || (st.st_size - sizeof(Packed)) % sizeof(Packed)) {
+		close(pf->fd);
+		errno = EINVAL;
+		return FALSE;
+	}
+	pf->size = st.st_size;
+	pf->map = mmap(NULL, pf->size, PROT_READ, MAP_SHARED, pf->fd, 0);
+	if(pf->map == MAP_FAILED || memcmp(pf->map, PACK_MAGIC, strlen(PACK_MAGIC))) {
+		if(pf->map != MAP_FAILED)
+			munmap(pf->map, pf->size);
+		close(pf->fd);
+		errno = pf->map == MAP_FAILED ? errno : EINVAL;
+		return FALSE;
+	}
+	pf->rec = (const Packed*) pf->map + 1;
+	pf->n = pf->size/sizeof(Packed) - 1;
+	return TRUE;
+}
+
+void close_packfile(PackFile* pf) {
+	munmap(pf->map, pf->size);
+	close(pf->fd);
+}
+
+unsigned short code_move(const Move* move) {
+	unsigned short code;
+	code = (move->rank*8 + move->file) | (move->dest.rank*8 + move->dest.file) << 6;
+	if(isupper(move->dest.x))				//Promocao: N, B, R ou Q
+		code |= (strchr("NBRQ", move->dest.x) - "NBRQ" + 1) << 12;
+	return code;
+}
+
+uint64_t key_explorer(const State* st) {
+	int sq;
+	uint64_t key;
+
+	key = st->key;
+	if(st->en_passant >= 0) {
+		sq = st->en_passant + (st->turn ? 8 : -8);	//Casa do peao que avancou duas casas
+		if((sq%8 == 0 || st->board[sq-1] != WP - st->turn) && (sq%8 == 7 || st->board[sq+1] != WP - st->turn))
+			key ^= zobrist(14*64 + st->en_passant%8);	//Sem peao para capturar: en passant ignorado
+	}
+	return key ? key : 1;			//Como em key_state
+}
+
+int cmp_explorer(const void* a, const void* b) {
+	const ExplorerEntry* e1;
+	const ExplorerEntry* e2;
+	e1 = (const ExplorerEntry*) a;
+	e2 = (const ExplorerEntry*) b;
+	if(e1->key != e2->key)
+		return e1->key < e2->key ? -1 : 1;
+	return (int) e1->move - (int) e2->move;
+}
+
+/*Soma as contagens de uma entrada de indice de aberturas a outra, limitadas a 2^32-1.
+	Parametros
+		ExplorerEntry* dest	entrada somada
+		const ExplorerEntry* src	entrada
+*/
+static void add_explorer(ExplorerEntry* dest, const ExplorerEntry* src) {
+	dest->white = dest->white + src->white < dest->white ? UINT32_MAX : dest->white + src->white;
+	dest->draws = dest->draws + src->draws < dest->draws ? UINT32_MAX : dest->draws + src->draws;
+	dest->black = dest->black + src->black < dest->black ? UINT32_MAX : dest->black + src->black;
+}
+
+size_t compact_explorer(ExplorerEntry* e, size_t n) {
+	size_t i, j;
+	if(!n)
+		return 0;
+	qsort(e, n, sizeof(ExplorerEntry), cmp_explorer);
+	for(i=1, j=0; i<n; i++)
+		if(e[i].key == e[j].key && e[i].move == e[j].move)
+			add_explorer(&e[j], &e[i]);
+		else
+			e[++j] = e[i];
+	return j+1;
+}
+
+/*Escreve um inteiro sem sinal em tamanho variavel: 7 bits por byte, o bit 7 indica continuacao.
+	Parametros
+		uint8_t* p	recipiente com no minimo 10 bytes
+		uint64_t v	valor
+	Retorno
+		numero de bytes escritos
+*/
+static int putVarint_explorer(uint8_t* p, uint64_t v) {
+	int n;
+	for(n=0; v >= 0x80; v >>= 7)
+		p[n++] = (uint8_t) (v | 0x80);
+	p[n++] = (uint8_t) v;
+	return n;
+}
+
+/*Le um inteiro sem sinal de tamanho variavel.
+	Parametros
+		const uint8_t** p	posicao de leitura, avancada
+		const uint8_t* end	fim dos dados
+	Retorno
+		valor, 0 se os dados terminam antes
+*/
+static uint64_t getVarint_explorer(const uint8_t** p, const uint8_t* end) {
+	uint64_t v;
+	int shift;
+	for(v=0, shift=0; *p < end && shift < 64; shift += 7) {
+		v |= (uint64_t) (**p & 0x7F) << shift;
+		if(!(*(*p)++ & 0x80))
+			return v;
+	}
+	return 0;
+}
+
+/*Grava o bloco atual de um indice de aberturas comprimido e o registra no diretorio.
+	Parametros
+		ExplorerWriter* w	indice
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de erro de escrita
+*/
+static boolean flush_explorer(ExplorerWriter* w) {
+	uint8_t buf[EXPLORER_BLOCK*5*10];
+	uint64_t key;
+	size_t n;
+	int i;
+
+	if(!w->n)
+		return TRUE;
+	if(w->header.blocks == w->m_dir) {
+		w->m_dir = w->m_dir ? 2*w->m_dir : 1024;
+		w->dir = (ExplorerBlock*) realloc(w->dir, w->m_dir*sizeof(ExplorerBlock));
+	}
+	w->dir[w->header.blocks].key = key = w->block[0].key;
+	w->dir[w->header.blocks++].offset = w->offset;
+	for(i=n=0; i<w->n; i++) {			//Diferenca da chave anterior, movimento e contagens
+		n += putVarint_explorer(buf+n, w->block[i].key - key);
+		n += putVarint_explorer(buf+n, w->block[i].move);
+		n += putVarint_explorer(buf+n, w->block[i].white);
+		n += putVarint_explorer(buf+n, w->block[i].draws);
+		n += putVarint_explorer(buf+n, w->block[i].black);
+		key = w->block[i].key;
+	}
+	w->header.entries += w->n;
+	w->offset += n;
+	w->n = 0;
+	return fwrite(buf, 1, n, w->file) == n;
+}
+
+boolean create_explorer(ExplorerWriter* w, const char* path) {
+	Fen f;
+	State st;
+
+	memset(w, 0, sizeof(ExplorerWriter));
+	if(NULL == (w->file = fopen(path, "wb")))
+		return FALSE;
+	memcpy(w->header.magic, EXPLORER_MAGIC, sizeof(w->header.magic));
+	w->header.version = EXPLORER_VERSION;
+	w->header.block = EXPLORER_BLOCK;
+	parseFen(START_FEN, &f);
+	loadFen_state(&st, &f);
+	w->header.start_key = key_state(&st);
+	w->offset = sizeof(ExplorerHeader);
+	if(fwrite(&w->header, sizeof(ExplorerHeader), 1, w->file) != 1) {	//Cabecalho provisorio, reescrito ao concluir
+		fclose(w->file);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+boolean write_explorer(ExplorerWriter* w, const ExplorerEntry* e) {
+	if(w->n && w->block[w->n-1].key == e->key && w->block[w->n-1].move == e->move) {
+		add_explorer(&w->block[w->n-1], e);
+		return TRUE;
+	}
+	if(w->n == EXPLORER_BLOCK && !flush_explorer(w))	//Bloco cheio: a ultima entrada nao muda mais
+		return FALSE;
+	w->block[w->n++] = *e;
+	return TRUE;
+}
+
+boolean finish_explorer(ExplorerWriter* w, uint64_t games) {
+	boolean ok;
+
+	ok = flush_explorer(w);
+	w->header.dir = w->offset;
+	w->header.games = games;
+	ok = ok && fwrite(w->dir, sizeof(ExplorerBlock), w->header.blocks, w->file) == w->header.blocks;
+	ok = ok && !fseek(w->file, 0, SEEK_SET) && fwrite(&w->header, sizeof(ExplorerHeader), 1, w->file) == 1;
+	ok = !fclose(w->file) && ok;
+	free(w->dir);
+	return ok;
+}
+
+boolean open_explorer(Explorer* ex, const char* path) {
+	struct stat st;
+	const ExplorerHeader* h;
+	Fen f;
+	State start;
+
+	memset(ex, 0, sizeof(Explorer));
+	if((ex->fd = open(path, O_RDONLY)) < 0)
+		return FALSE;
+	if(fstat(ex->fd, &st) < 0 || st.st_size < (off_t) sizeof(ExplorerHeader)) {
+		close(ex->fd);
+		errno = EINVAL;
+		return FALSE;
+	}
+	ex->size = st.st_size;
+	ex->map = mmap(NULL, ex->size, PROT_READ, MAP_SHARED, ex->fd, 0);
+	if(ex->map == MAP_FAILED) {
+		close(ex->fd);
+		return FALSE;
+	}
+	h = (const ExplorerHeader*) ex->map;		//Versao, tamanho dos blocos, diretorio e esquema das chaves
+	parseFen(START_FEN, &f);
+	loadFen_state(&start, &f);
+	if(memcmp(h->magic, EXPLORER_MAGIC, sizeof(h->magic)) || h->version != EXPLORER_VERSION || h->block != EXPLORER_BLOCK ||
+	   h->dir > ex->size || (ex->size - h->dir)/sizeof(ExplorerBlock) < h->blocks || h->entries > h->blocks*EXPLORER_BLOCK ||
+	   h->start_key != key_state(&start)) {
+		munmap(ex->map, ex->size);
+		close(ex->fd);
+		errno = EINVAL;
+		return FALSE;
+	}
+	madvise(ex->map, ex->size, MADV_RANDOM);
+	ex->header = h;
+	ex->dir = (const ExplorerBlock*) ((const char*) ex->map + h->dir);
+	return TRUE;
+}
+
+void close_explorer(Explorer* ex) {
+	munmap(ex->map, ex->size);
+	close(ex->fd);
+}
+
+int search_explorer(const Explorer* ex, uint64_t key, ExplorerEntry* res, int m) {
+	const uint8_t* p;
+	const uint8_t* end;
+	size_t lo, hi, mid, b, i, n;
+	uint64_t k;
+	ExplorerEntry e;
+	int found, steps;
+
+	lo = 0;					//Primeiro bloco com chave maior ou igual, em [lo, hi]
+	hi = ex->header->blocks;
+	for(steps=0; lo < hi; steps++) {
+		if(steps < 8 && hi-lo > 16 && key > ex->dir[lo].key && key < ex->dir[hi-1].key)	//Interpolacao
+			mid = lo + (size_t) ((double) (key - ex->dir[lo].key) / (double) (ex->dir[hi-1].key - ex->dir[lo].key) * (hi-1-lo));
+		else
+			mid = lo + (hi-lo)/2;
+		if(ex->dir[mid].key < key)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+
+	found = 0;
+	end = (const uint8_t*) ex->map + ex->header->dir;
+	for(b = lo ? lo-1 : 0; b < ex->header->blocks && ex->dir[b].key <= key; b++) {	//A chave pode comecar no bloco anterior
+		p = (const uint8_t*) ex->map + ex->dir[b].offset;
+		n = b < ex->header->blocks-1 ? EXPLORER_BLOCK : ex->header->entries - b*EXPLORER_BLOCK;
+		for(i=0, k=ex->dir[b].key; i<n && p < end; i++) {
+			k += getVarint_explorer(&p, end);
+			e.move = getVarint_explorer(&p, end);
+			e.white = getVarint_explorer(&p, end);
+			e.draws = getVarint_explorer(&p, end);
+			e.black = getVarint_explorer(&p, end);
+			if(k > key)
+				return found;
+			if(k == key) {
+				e.key = k;
+				if(found < m)
+					res[found] = e;
+				found++;
+			}
+		}
+	}
+	return found;
+}
+
+#ifndef NO_STATS
+__thread Stats stats __attribute__((tls_model("initial-exec")));
+static Stats total_stats;		//Totais do processo, atualizados atomicamente
+#endif
+
+void flush_stats(void) {
+#ifndef NO_STATS
+	size_t i;
+	long long* src;
+	long long* dest;
+	src = (long long*) &stats;		//Stats contem somente campos long long
+	dest = (long long*) &total_stats;
+	for(i=0; i<sizeof(Stats)/sizeof(long long); i++)
+		if(src[i])
+			__atomic_fetch_add(&dest[i], src[i], __ATOMIC_RELAXED);
+	memset(&stats, 0, sizeof(Stats));
+#endif
+}
+
+void get_stats(Stats* st) {
+#ifndef NO_STATS
+	size_t i;
+	long long* src;
+	long long* total;
+	long long* dest;
+	src = (long long*) &stats;
+	total = (long long*) &total_stats;
+	dest = (long long*) st;
+	for(i=0; i<sizeof(Stats)/sizeof(long long); i++)
+		dest[i] = __atomic_load_n(&total[i], __ATOMIC_RELAXED) + src[i];
+#else
+	memset(st, 0, sizeof(Stats));
+#endif
+}
+
+char* str_stats(char* str) {
+#ifndef NO_STATS
+	static const char* name[ALLOC_SUBSYSTEMS] = {"arena", "chess", "ttable", "game"};
+	int i, k;
+	Stats st;
+
+	get_stats(&st);
+	k = snprintf(str, STATS_SIZE, "gen_calls %lld gen_moves %lld threats %lld make %lld unmake %lld rep_probes %lld rep_chain %lld tt_probes %lld tt_hits %lld nodes %lld",
+		st.gen_calls, st.gen_moves, st.threats, st.make, st.unmake, st.rep_probes, st.rep_chain, st.tt_probes, st.tt_hits, st.nodes);
+	for(i=0; i<ALLOC_SUBSYSTEMS && k < STATS_SIZE; i++)
+		k += snprintf(str+k, STATS_SIZE-k, " alloc_%s %lld alloc_%s_bytes %lld", name[i], st.allocs[i], name[i], st.alloc_bytes[i]);
+#else
+	str[0] = '\0';
+#endif
+	return str;
+}
+
+static Histogram latency[TIME_PHASES][PIECE_CLASSES];	//Latencias das decisoes da IA por fase e numero de pecas
+static Histogram branching[BRANCH_CLASSES];		//Latencias totais por numero de movimentos possiveis
+
+/*Calcula o intervalo de uma amostra: valores exatos ate HIST_SUB, depois HIST_SUB intervalos por potencia de 2.
+	Parametros
+		long long v	amostra
+	Retorno
+		indice do intervalo
+*/
+static int bucket_histogram(long long v) {
+	int k, i;
+	if(v < HIST_SUB)
+		return v < 0 ? 0 : v;
+	k = 63 - __builtin_clzll(v);			//Potencia de 2, maior ou igual a 3
+	i = (k-2)*HIST_SUB + ((v >> (k-3)) & (HIST_SUB-1));
+	return i < HIST_BUCKETS ? i : HIST_BUCKETS-1;
+}
+
+/*Calcula o maior valor de um intervalo.
+	Parametros
+		int i	indice do intervalo
+	Retorno
+		maior valor
+*/
+static long long upper_histogram(int i) {
+	int k;
+	if(i < HIST_SUB)
+		return i;
+	k = i/HIST_SUB + 2;
+	return ((long long) (HIST_SUB + i%HIST_SUB + 1) << (k-3)) - 1;
+}
+
+void record_histogram(Histogram* h, long long v) {
+	long long max;
+	__atomic_fetch_add(&h->count[bucket_histogram(v)], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&h->n, 1, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+	while(v > max && !__atomic_compare_exchange_n(&h->max, &max, v, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+long long percentile_histogram(const Histogram* h, double p) {
+	int i;
+	long long n, c, max;
+	n = __atomic_load_n(&h->n, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+	for(i=0, c=0; i<HIST_BUCKETS; i++) {
+		c += __atomic_load_n(&h->count[i], __ATOMIC_RELAXED);
+		if(c > 0 && c >= p/100*n)
+			return upper_histogram(i) < max ? upper_histogram(i) : max;
+	}
+	return max;
+}
+
+void record_latency(int pieces, int moves, const long long* phase) {
+	int i, c;
+	c = pieces <= 2 ? 0 : (pieces-1)/8;
+	if(c >= PIECE_CLASSES)
+		c = PIECE_CLASSES-1;
+	for(i=0; i<TIME_PHASES; i++)
+		if(phase[i] >= 0)
+			record_histogram(&latency[i][c], phase[i]);
+	c = moves < 20 ? moves/10 : moves < 35 ? 2 : 3;
+	record_histogram(&branching[c], phase[TIME_TOTAL]);
+}
+
+/*Escreve os percentis de um histograma nao vazio.
+	Parametros
+		FILE* fp		arquivo
+		const char* prefix	prefixo da linha
+		const char* name	descricao do histograma
+		const Histogram* h	histograma
+*/
+static void print_histogram(FILE* fp, const char* prefix, const char* name, const Histogram* h) {
+	if(!__atomic_load_n(&h->n, __ATOMIC_RELAXED))
+		return;
+	fprintf(fp, "%s%s n %lld p50 %.3f p90 %.3f p99 %.3f max %.3f ms\n", prefix, name, h->n, percentile_histogram(h, 50)/1e6,
+		percentile_histogram(h, 90)/1e6, percentile_histogram(h, 99)/1e6, percentile_histogram(h, 100)/1e6);
+}
+
+void print_latency(FILE* fp, const char* prefix) {
+	static const char* phase[TIME_PHASES] = {"gen", "eval", "search", "total"};
+	static const char* pieces[PIECE_CLASSES] = {"2-8", "9-16", "17-24", "25-32"};
+	static const char* moves[BRANCH_CLASSES] = {"0-9", "10-19", "20-34", "35+"};
+	int i, j;
+	char name[32];
+
+	for(i=0; i<TIME_PHASES; i++)
+		for(j=0; j<PIECE_CLASSES; j++) {
+			snprintf(name, sizeof(name), "%s pieces %s", phase[i], pieces[j]);
+			print_histogram(fp, prefix, name, &latency[i][j]);
+		}
+	for(j=0; j<BRANCH_CLASSES; j++) {
+		snprintf(name, sizeof(name), "total moves %s", moves[j]);
+		print_histogram(fp, prefix, name, &branching[j]);
+	}
+}
@@ -0,0 +1,1549 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include "chess.h"
+
+#define FALSE 0
+#define TRUE 1
+#define ARENA_CLASSES 12	//Classes de tamanho de bloco da arena: 16 a 32768 bytes
+#define ARENA_CHUNK 65536	//Tamanho de cada pedaco de memoria da arena
+#define boolean char
+#define MAX_PLY 64		//Profundidade maxima de busca
+#define MATE 30000		//Pontuacao de xeque-mate
+#define INF 32000		//Pontuacao infinita
+#define TT_MB 16		//Tamanho padrao da tabela de transposicao, em MB
+#define PACK_MAGIC "CHESSPK1"	//Identificacao de um arquivo de posicoes compactadas
+#define CACHE_MAGIC "CHESSAC1"	//Identificacao de um arquivo de cache de analise
+#define CACHE_VERSION 1		//Versao do formato do cache de analise
+#define CACHE_DEPTH 3		//Profundidade minima das pontuacoes gravadas no cache de analise
+#define CACHE_MB 64		//Tamanho padrao de um novo cache de analise, em MB
+#define EXPLORER_MAGIC "CHESSEX1"	//Identificacao de um indice de aberturas
+#define EXPLORER_VERSION 2	//Versao do formato do indice de aberturas
+#define EXPLORER_BLOCK 128	//Entradas de cada bloco comprimido do indice de aberturas
+#define PN_INF 0x3FFFFFFF	//Numero de prova infinito da busca de mate
+#define MATE_MB 16		//Tamanho padrao da tabela da busca de mate, em MB
+#define MCTS_MB 64		//Tamanho padrao do pool de nos da arvore MCTS, em MB
+#define MCTS_SCALE 65536	//Escala dos resultados somados nos nos MCTS: inteiros atualizados atomicamente
+#define MCTS_CPUCT 1.5		//Constante de exploracao padrao da selecao PUCT
+#define MCTS_FPU 0.2		//Reducao do valor de um filho nao visitado em relacao ao pai (first play urgency)
+#define MCTS_CP 400		//Centipeoes de uma diferenca de 10 vezes nas chances: valor = 1/(1+10^(-cp/MCTS_CP))
+#define HIST_SUB 8		//Divisoes de cada potencia de 2 nos histogramas de latencia: erro maximo de 12,5%
+#define HIST_BUCKETS 320	//Intervalos dos histogramas de latencia: ate 2^41 ns
+#define PIECE_CLASSES 4		//Classes de numero de pecas das latencias: 2-8, 9-16, 17-24 e 25-32
+#define BRANCH_CLASSES 4	//Classes de numero de movimentos possiveis das latencias: 0-9, 10-19, 20-34 e 35 ou mais
+#define PHASE_SAMPLE 64		//Uma chamada medida a cada PHASE_SAMPLE nas fases de geracao e avaliacao da busca
+
+#ifdef NO_STATS			//Contadores de instrumentacao removidos na compilacao (make CPPFLAGS=-DNO_STATS)
+#define COUNT(field, n) ((void) 0)
+#define COUNT_ALLOC(sub, bytes) ((void) 0)
+#else				//Contadores da thread atual, somados aos totais do processo por flush_stats
+#define COUNT(field, n) (stats.field += (n))
+#define COUNT_ALLOC(sub, bytes) (stats.allocs[sub]++, stats.alloc_bytes[sub] += (bytes))
+#endif
+
+#if defined(__GNUC__)		//Funcao copiada em cada chamada, especializada pelos argumentos constantes (ex.: a cor do turno)
+#define SPECIALIZED static inline __attribute__((always_inline))
+#else
+#define SPECIALIZED static inline
+#endif
+
+typedef struct arena Arena;
+typedef struct position Position;
+typedef struct piece Piece;
+typedef struct chess Chess;
+typedef struct fen Fen;
+typedef struct state State;
+typedef struct move Move;
+typedef struct undo Undo;
+typedef struct tt_entry TTEntry;
+typedef struct ttable TTable;
+typedef struct search Search;
+typedef struct packed Packed;
+typedef struct packfile PackFile;
+typedef struct cache_header CacheHeader;
+typedef struct cache_entry CacheEntry;
+typedef struct cache Cache;
+typedef struct explorer_entry ExplorerEntry;
+typedef struct explorer_header ExplorerHeader;
+typedef struct explorer_block ExplorerBlock;
+typedef struct explorer_writer ExplorerWriter;
+typedef struct pn_entry PNEntry;
+typedef struct mate Mate;
+typedef struct mcts_node MctsNode;
+typedef struct mcts Mcts;
+typedef struct stats Stats;
+typedef struct histogram Histogram;
+
+typedef enum {			//Subsistemas das alocacoes de memoria contabilizadas
+	ALLOC_ARENA,		//Pedacos e blocos grandes das arenas
+	ALLOC_CHESS,		//Registros Chess, arenas proprias e posicoes fora das arenas
+	ALLOC_TTABLE,		//Tabelas de transposicao
+	ALLOC_GAME,		//Jogos da biblioteca: historico e buscas
+	ALLOC_SUBSYSTEMS
+} Subsystem;
+
+struct stats {					//Contadores de instrumentacao
+	long long gen_calls;			//Chamadas da geracao de movimentos
+	long long gen_moves;			//Movimentos gerados
+	long long threats;			//Consultas de ameaca a uma casa
+	long long make;				//Movimentos efetuados
+	long long unmake;			//Movimentos desfeitos
+	long long rep_probes;			//Consultas de repeticao ao historico do jogo e ao caminho da busca
+	long long rep_chain;			//Posicoes comparadas nas consultas de repeticao
+	long long tt_probes;			//Consultas a tabela de transposicao
+	long long tt_hits;			//Consultas a tabela de transposicao com a posicao encontrada
+	long long nodes;			//Nos de busca
+	long long allocs[ALLOC_SUBSYSTEMS];	//Alocacoes de memoria por subsistema
+	long long alloc_bytes[ALLOC_SUBSYSTEMS];	//Bytes alocados por subsistema
+};
+
+typedef enum {			//Fases de uma decisao da IA medidas nas latencias
+	TIME_GEN,		//Geracao de movimentos
+	TIME_EVAL,		//Avaliacao das posicoes
+	TIME_SEARCH,		//Restante da busca
+	TIME_TOTAL,		//Decisao completa
+	TIME_PHASES
+} Timephase;
+
+struct histogram {			//Histograma de latencias em ns, intervalos log-lineares (HDR)
+	long long count[HIST_BUCKETS];	//Amostras de cada intervalo
+	long long n;			//Numero de amostras
+	long long max;			//Maior amostra
+};
+
+#ifndef NO_STATS
+extern __thread Stats stats __attribute__((tls_model("initial-exec")));
+#endif
+
+typedef enum {		//Identificacao das pecas
+	BP = 1,		//As pecas pretas assumem valores impares, as pecas brancas, valores pares
+	WP,
+	BN,
+	WN,
+	BB,
+	WB,
+	BR,
+	WR,
+	BQ,
+	WQ,
+	BK,
+	WK,
+	EMPTY = -1	//Nenhuma peca
+} Piecename;
+
+struct position {	//Posicao
+	char file;
+	char rank;
+	char x;		//Tipo de ocupacao: 0 - normal, 'x' - captura, 'e' - en passant, maiusculo - captura e promocao, outros - promocao
+};
+
+struct piece {					//Peca
+	Piecename id;				//Identificacao
+	Position** pos;				//Vetor com a posicao atual e com os possiveis movimentos para a jogada
+	char m;					//Numero de movimentos possiveis calculados
+};
+
+struct chess {				//Estrutura para o jogo de xadrez
+	uint64_t* history;		//Chaves das posicoes do jogo gravadas, na memoria do jogo
+	int n_history;			//Numero de posicoes no historico
+	Piece* board[8][8];		//Tabuleiro com as pecas, posicao vazia assume valor NULL
+	Piece* king[2];			//Reis
+	char n_pieces;			//Numero total de pecas no jogo
+	char* castling;			//String de roque do FEN
+	Position en_passant;		//Posicao de captura en passant
+	char turn;			//Turno: 0 - pecas brancas, 1 - pecas pretas
+	char mid_turns;			//Numero de meios-turnos
+	int n_turns;			//Numero de turnos
+	Arena* arena;			//Memoria do jogo: pecas, posicoes, roque e historico
+	boolean own_arena;		//A arena foi criada pelo jogo e e desalocada com ele
+	char material[WK+1];		//Numero de pecas de cada id, atualizado nas capturas e promocoes
+	char bishops[2][2];		//Bispos de cada cor (0 - brancas, 1 - pretas) por cor da casa (0 - escura, 1 - clara)
+	short n_moves[2];		//Movimentos possiveis de cada cor, da ultima geracao
+	uint64_t attacks;		//Casas atacadas pelas pecas fora do turno (bit rank*8+file), valido se check >= 0
+	signed char check;		//Rei do turno em xeque: TRUE, FALSE ou -1 se ainda nao calculado na posicao
+};
+
+struct arena {				//Memoria de um jogo: blocos em classes de potencias de 2 com listas livres, reinicio em O(1)
+	char* first;			//Primeiro pedaco; cada pedaco comeca com o ponteiro para o seguinte
+	char* chunk;			//Pedaco atual
+	size_t used;			//Bytes usados do pedaco atual
+	void* free[ARENA_CLASSES];	//Blocos livres de cada classe
+	void* big;			//Blocos maiores que a maior classe, alocados a parte
+	size_t in_use;			//Bytes em uso, com os cabecalhos
+	size_t peak;			//Maximo de bytes em uso desde o ultimo reinicio
+	size_t reserved;		//Bytes reservados em pedacos
+};
+
+struct fen {				//Campos de um codigo FEN
+	signed char board[8][8];	//Id das pecas, EMPTY se vazia
+	char turn;			//Turno: 0 - pecas brancas, 1 - pecas pretas
+	char castling[5];		//Roque
+	Position en_passant;		//En passant
+	int mid_turns;			//Numero de meios-turnos
+	int n_turns;			//Numero de turnos
+};
+
+struct state {				//Posicao como valor plano, sem ponteiros: copiada por atribuicao ou memcpy, sem alocacao
+	signed char board[64];		//Id das pecas, EMPTY se vazia: casa rank*8+file
+	uint64_t key;			//Chave zobrist, atualizada a cada movimento
+	int n_turns;			//Numero de turnos
+	char turn;			//Turno: 0 - pecas brancas, 1 - pecas pretas
+	unsigned char castling;		//Roque: bits 0 a 3 para KQkq
+	signed char en_passant;		//Casa de captura en passant, -1 se nao ha
+	unsigned char mid_turns;	//Numero de meios-turnos
+	signed char king[2];		//Casas dos reis
+};
+
+struct packed {				//Posicao compactada em 32 bytes, sem dependencia de alinhamento ou ordem de bytes
+	uint8_t occupied[8];		//Casas ocupadas: casa rank*8+file no bit file do byte rank
+	uint8_t pieces[16];		//Id das pecas das casas ocupadas, em ordem, 4 bits cada (menos significativos primeiro)
+	uint8_t flags;			//Bit 0: turno, bits 1 a 4: roque KQkq
+	uint8_t en_passant;		//Coluna do en passant mais 1, 0 se nao ha
+	uint8_t mid_turns;		//Numero de meios-turnos
+	uint8_t n_turns[4];		//Numero de turnos, little endian
+	uint8_t reserved;		//Zero
+};					//Posicao toda zerada: invalida (sem reis)
+
+struct packfile {			//Arquivo de posicoes compactadas mapeado em memoria: cabecalho de 32 bytes seguido dos registros
+	int fd;
+	void* map;			//Arquivo inteiro
+	size_t size;
+	const Packed* rec;		//Registros, acesso direto por indice
+	size_t n;			//Numero de registros
+};
+
+struct explorer_entry {			//Estatisticas de um movimento numa posicao do indice de aberturas
+	uint64_t key;			//Chave zobrist da posicao
+	uint32_t white;			//Jogos vencidos pelas brancas
+	uint32_t draws;			//Empates
+	uint32_t black;			//Jogos vencidos pelas pretas
+	uint16_t move;			//Codigo de 16 bits do movimento, como em query_moves
+};
+
+struct explorer_header {		//Cabecalho de 64 bytes de um indice de aberturas
+	char magic[8];			//EXPLORER_MAGIC
+	uint32_t version;		//EXPLORER_VERSION
+	uint32_t block;			//Entradas por bloco
+	uint64_t entries;		//Numero de entradas (posicao, movimento)
+	uint64_t blocks;		//Numero de blocos
+	uint64_t dir;			//Posicao do diretorio de blocos no arquivo
+	uint64_t games;			//Jogos indexados
+	uint64_t start_key;		//Chave da posicao inicial: confere o esquema das chaves zobrist
+	uint8_t reserved[8];		//Zero
+};
+
+struct explorer_block {			//Entrada do diretorio de blocos de um indice de aberturas
+	uint64_t key;			//Primeira chave do bloco
+	uint64_t offset;		//Posicao do bloco no arquivo
+};
+
+struct explorer {			//Indice de aberturas mapeado em memoria, somente leitura: cabecalho, blocos e diretorio
+	int fd;
+	void* map;			//Arquivo inteiro
+	size_t size;
+	const ExplorerHeader* header;
+	const ExplorerBlock* dir;	//Diretorio, em ordem de chave
+};
+
+struct explorer_writer {		//Gravacao sequencial de um indice de aberturas
+	FILE* file;
+	ExplorerEntry block[EXPLORER_BLOCK];	//Bloco atual, ainda nao gravado
+	int n;
+	ExplorerBlock* dir;		//Diretorio dos blocos gravados
+	size_t m_dir;
+	ExplorerHeader header;
+	uint64_t offset;		//Fim dos dados gravados
+};
+
+struct move {			//Movimento
+	char file;		//Coluna de origem
+	char rank;		//Linha de origem
+	Position dest;		//Posicao destino
+};
+
+struct undo {			//Dados para desfazer um movimento
+	Piece* piece;		//Peca original do movimento
+	Piece* dest;		//Copia da peca na posicao destino (id EMPTY se vazia)
+	char castling[5];	//String de roque anterior
+	Position en_passant;	//En passant anterior
+	char mid_turns;		//Meios-turnos anteriores
+};
+
+typedef enum {			//Tipo de limite de uma pontuacao na tabela de transposicao
+	EXACT,
+	LOWER,
+	UPPER
+} Bound;
+
+struct tt_entry {		//Entrada da tabela de transposicao
+	uint64_t key;		//Chave zobrist da posicao, 0 se vazia
+	short score;		//Pontuacao
+	char depth;		//Profundidade da busca
+	char bound;		//Tipo de limite
+	unsigned char gen;	//Geracao da busca que gravou a entrada
+	Move best;		//Melhor movimento
+};
+
+struct ttable {			//Tabela de transposicao
+	TTEntry* entry;		//Entradas
+	size_t m;		//Numero de entradas (potencia de 2)
+	unsigned char gen;	//Geracao atual
+};
+
+struct cache_header {			//Cabecalho de 64 bytes de um arquivo de cache de analise
+	char magic[8];			//CACHE_MAGIC
+	uint32_t version;		//CACHE_VERSION
+	uint32_t entry_size;		//Tamanho de uma entrada
+	uint64_t m;			//Numero de entradas (potencia de 2)
+	uint64_t start_key;		//Chave da posicao inicial: confere o esquema das chaves zobrist
+	uint8_t reserved[32];		//Zero
+};
+
+struct cache_entry {			//Entrada do cache de analise: duas palavras de 64 bits, cada uma gravada atomicamente
+	uint64_t check;			//Chave zobrist xor data: escritas concorrentes ou interrompidas nao conferem com a chave
+	uint64_t data;			//Pontuacao (bits 0 a 15), profundidade (16 a 23), limite (24 e 25), origem (26 a 31),
+					//destino (32 a 37), tipo do movimento (38 a 40, 7 sem movimento), soma de verificacao (56 a 63)
+};
+
+struct cache {				//Cache de analise persistente, arquivo mapeado com MAP_SHARED e compartilhado entre processos
+	int fd;
+	void* map;			//Arquivo inteiro
+	size_t size;
+	CacheEntry* entry;		//Entradas
+	size_t m;			//Numero de entradas (potencia de 2)
+};
+
+struct search {				//Estado de uma busca
+	Chess* chess;			//Jogo, copiado para um registro State no inicio da busca
+	TTable* tt;			//Tabela de transposicao
+	Cache* cache;			//Cache de analise persistente, NULL se nao usado
+	volatile boolean stop;		//Sinal de parada
+	boolean infinite;		//Busca sem limite, aguarda o sinal de parada
+	int max_depth;			//Profundidade maxima
+	long long max_nodes;		//Numero maximo de nos, -1 se sem limite
+	long long max_time;		//Tempo maximo em ms, -1 se sem limite
+	long long nodes;		//Nos visitados
+	struct timespec start;		//Inicio da busca
+	const uint64_t* keys;		//Chaves das posicoes anteriores do jogo (repeticao), somente leitura
+	int n_keys;			//Numero de chaves
+	uint64_t path[MAX_PLY];		//Chaves das posicoes do caminho atual da busca
+	Move pv[MAX_PLY][MAX_PLY];	//Variantes principais por profundidade
+	char pv_len[MAX_PLY];		//Tamanho das variantes principais
+	Move best;			//Melhor movimento encontrado
+	int score;			//Pontuacao do melhor movimento
+	int scores[MAX_PLY];		//Pontuacao de cada iteracao completa, pela profundidade
+	int depth;			//Profundidade completa alcancada
+	int change_depth;		//Iteracao em que o melhor movimento atual apareceu
+	long long change_time;		//Tempo em ms ao fim dessa iteracao
+	long long change_nodes;		//Nos visitados ao fim dessa iteracao
+	boolean cached;			//Busca respondida pelo cache de analise: pontuacoes das profundidades anteriores desconhecidas
+	FILE* out;			//Saida das linhas info, NULL para nenhuma
+	int multipv;			//Numero de variantes principais (multi-PV), ate MAX_MULTIPV; 0 para a busca comum
+	Move lines[MAX_MULTIPV][MAX_PLY];	//Variantes da ultima iteracao completa com multipv, da melhor para a pior
+	char lines_len[MAX_MULTIPV];	//Tamanho das variantes
+	int lines_score[MAX_MULTIPV];	//Pontuacao das variantes
+	int n_lines;			//Numero de variantes
+	long long phase[TIME_PHASES];	//Tempo de cada fase da ultima busca em ns (geracao e avaliacao somente sem NO_STATS, estimadas por amostragem)
+	long long phase_calls[TIME_PHASES];	//Chamadas de cada fase na ultima busca
+};
+
+struct pn_entry {			//Entrada da tabela da busca de mate
+	uint64_t key;			//Chave zobrist da posicao combinada com a profundidade restante, 0 se vazia
+	uint32_t phi;			//Numero de prova do turno: 0 se o turno vence, PN_INF se nao pode vencer
+	uint32_t delta;			//Numero de refutacao do turno: PN_INF se o turno vence, 0 se nao pode vencer
+	uint32_t work;			//Nos visitados na avaliacao da posicao (prioridade na substituicao)
+	unsigned char gen;		//Geracao da busca que gravou a entrada
+};
+
+struct mate {				//Busca de mate forcado por numeros de prova em profundidade (df-pn)
+	PNEntry* entry;			//Tabela de transposicao propria, indexada por posicao e profundidade restante
+	size_t m;			//Numero de entradas (potencia de 2)
+	unsigned char gen;		//Geracao atual
+	long long max_nodes;		//Numero maximo de nos, -1 se sem limite
+	long long nodes;		//Nos visitados
+	boolean stop;			//Limite de nos atingido
+	Move pv[MAX_PLY];		//Variante do mate mais curto, com a defesa mais longa
+	int pv_len;
+};
+
+typedef enum {			//Estado de expansao de um no MCTS
+	MCTS_NEW,		//Folha ainda nao expandida
+	MCTS_BUSY,		//Sendo expandida por uma thread
+	MCTS_OPEN		//Expandida: filhos em child..child+n_child-1 (nenhum se a posicao e final)
+} Mctsstate;
+
+struct mcts_node {			//No da arvore MCTS, 32 bytes; os campos de contagem sao atualizados atomicamente
+	int64_t value;			//Soma dos resultados para o jogador que fez o movimento do no, em 1/MCTS_SCALE
+	int32_t visits;			//Visitas concluidas
+	int32_t virtual;		//Visitas em andamento (perda virtual: contam como derrotas ate a atualizacao)
+	uint32_t child;			//Indice do primeiro filho no pool
+	uint16_t n_child;		//Numero de filhos
+	unsigned char state;		//Mctsstate
+	Move move;			//Movimento que leva ao no
+	float prior;			//Probabilidade a priori do movimento
+};
+
+struct mcts {				//Busca em arvore Monte Carlo (PUCT) com varias threads sobre a mesma arvore
+	MctsNode* node;			//Pool de nos: a raiz e node[0], os filhos de um no sao contiguos
+	size_t m;			//Capacidade do pool
+	size_t n;			//Nos usados (atomico)
+	int threads;			//Numero de threads da busca
+	double cpuct;			//Constante de exploracao
+	long long max_playouts;		//Numero maximo de playouts, -1 se sem limite
+	long long max_time;		//Tempo maximo em ms, -1 se sem limite
+	volatile boolean stop;		//Sinal de parada
+	boolean full;			//A busca parou por falta de nos no pool
+	const uint64_t* keys;		//Chaves das posicoes anteriores do jogo (repeticao), somente leitura
+	int n_keys;
+	FILE* out;			//Saida das linhas info (uma por segundo e ao final), NULL para nenhuma
+	State root;			//Posicao da raiz
+	long long start;		//Inicio da busca (clock_ns)
+	long long playouts;		//Playouts concluidos (atomico)
+	long long nodes;		//Nos visitados nas avaliacoes das folhas
+	long long time;			//Duracao da busca em ms
+	Move best;			//Movimento mais visitado da raiz
+	int score;			//Pontuacao em centipeoes correspondente ao valor do melhor movimento
+	Move pv[MAX_PLY];		//Variante pelos filhos mais visitados
+	int pv_len;
+};
+
+/*Obtem os contadores de instrumentacao do processo: totais ja somados por flush_stats mais os da thread atual.
+	Parametros
+		Stats* st	recipiente
+*/
+void get_stats(Stats* st);
+
+/*Remove um caractere de uma string.
+	Parametros
+		char* str	string
+		char c		caractere
+	Retorno
+		TRUE se o caractere foi encontrado, FALSE caso contrario
+*/
+boolean strrmc(char* str, char c);
+
+/*Inicializa uma arena vazia. Os pedacos sao alocados sob demanda.
+	Parametros
+		Arena* arena	arena
+*/
+void initialize_arena(Arena* arena);
+
+/*Desaloca toda a memoria de uma arena.
+	Parametros
+		Arena* arena	arena
+*/
+void finalize_arena(Arena* arena);
+
+/*Libera de uma vez todos os blocos de uma arena, mantendo os pedacos para reuso.
+	Parametros
+		Arena* arena	arena
+*/
+void reset_arena(Arena* arena);
+
+/*Aloca um bloco de uma arena.
+	Parametros
+		Arena* arena	arena
+		size_t n	tamanho em bytes
+	Retorno
+		bloco alinhado a 16 bytes
+*/
+void* alloc_arena(Arena* arena, size_t n);
+
+/*Redimensiona um bloco de uma arena. O bloco so muda de lugar ao exceder sua classe.
+	Parametros
+		Arena* arena	arena
+		void* p		bloco, ou NULL
+		size_t n	novo tamanho em bytes
+	Retorno
+		bloco
+*/
+void* realloc_arena(Arena* arena, void* p, size_t n);
+
+/*Devolve um bloco a lista livre de sua classe.
+	Parametros
+		Arena* arena	arena
+		void* p		bloco, ou NULL
+*/
+void free_arena(Arena* arena, void* p);
+
+/*Inicializa um registro Position.
+	Parametros
+		char file	file
+		char rank	rank
+		char x		x
+		Arena* arena	memoria do jogo
+	Retorno	
+		estrutura alocada e ja com seus valores definidos
+*/
+Position* initialize_position(char file, char rank, char x, Arena* arena);
+
+/*Desaloca um registro Position.
+	Parametros
+		Position* pos	elemento a ser desalocado
+		Arena* arena	memoria do jogo
+*/
+void finalize_position(Position* pos, Arena* arena);
+
+/*Compara dois registros Positions.
+	Parametros
+		Position* p1	elemento um
+		Position* p2	elemento dois
+	Retorno
+		0, se sao iguais, um valor maior que zero se p1 tem menos prioridade que p2 e um valor menor que zero caso contrario
+*/
+char cmp_position(Position* p1, Position* p2);
+
+/*Retorna a mediana entre tres posicoes.
+	Parametros
+		Position** v	vetor com os elementos
+		char n		numero de elementos
+	Retorno
+		indice da mediana
+*/
+char median(Position** v, char n);
+
+/*Ordena um vetor de registros Positions atraves do algoritmo Quicksort.
+	Parametros
+		Position** pos		vetor com os elementos
+		char n			numero de elementos
+*/
+void sort_position(Position** pos, char n);
+
+/*Realiza uma busca binaria por um registro Position num vetor.
+	Parametros
+		Position** v		vetor
+		char n			numero de elementos
+		Position* key		chave de busca
+	Retorno
+		TRUE caso a chave seja encontrada, FALSE caso contrario
+*/
+boolean search_position(Position** v, char n, Position* key);
+
+/*Efetua uma copia de um registro posicao.
+	Parametros
+		Position* des		destino, se NULL e feita uma alocacao
+		Position* src		fonte
+	Retorno
+		copia
+*/
+Position* cpy_position(Position* dest, Position* src);
+
+/*Inicializa um registro Piece, efetuando uma alocacao.
+	Parametros
+		Piecename id	id
+		char file	file
+		char rank	rank
+		Arena* arena	memoria do jogo
+	Retorno
+		Piece alocada
+*/
+Piece* initialize_piece(Piecename id, char file, char rank, Arena* arena);
+
+/*Desaloca um registro Piece.
+	Parametros
+		Piece* piece	elemento a ser desalocado
+		Arena* arena	memoria do jogo
+*/
+void finalize_piece(Piece* piece, Arena* arena);
+
+/*Gera o id de uma peca a partir de um caractere.
+	Parametros
+		char c		caractere
+	Retorno
+		id da peca
+*/
+Piecename genName_piece(char c);
+
+/*Gera o caractere correspondente ao id da peca.
+	Parametros
+		Piecename id	id da peca
+	Retorno
+		caractere
+*/
+char genChar_piece(Piecename id);
+
+/*Retorna a pontuacao referente ao id da peca.
+	Parametros
+		Piecename id	id da peca
+	Retorno
+		pontuacao
+*/
+int score_piece(Piecename id);
+
+/*Verifica e o id e de uma peca branca.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e branca, FALSE caso contrario
+*/
+boolean iswhite(Piecename id);
+
+/*Verifica e o id e de uma peca preta.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e preta, FALSE caso contrario
+*/
+boolean isblack(Piecename id);
+
+/*Verifica se e rei.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e peao, FALSE caso contrario
+*/
+boolean isking(Piecename id);
+
+/*Verifica se e rainha.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e peao, FALSE caso contrario
+*/
+boolean isqueen(Piecename id);
+
+/*Verifica se a regra de movimentacao da peca compoe a regra de movimentacao de uma rainha.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e peao, FALSE caso contrario
+*/
+boolean isqueenMove(Piecename id);
+
+/*Verifica se e torre.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e torre, FALSE caso contrario
+*/
+boolean isrook(Piecename id);
+
+/*Verifica se e peao.
+	Parametros
+		Piecename id	id
+	Retorno
+		TRUE se e peao, FALSE caso contrario
+*/
+boolean ispawn(Piecename id);
+
+/*Muda a cor de uma peca.
+	Parametros
+		Piecename	id
+*/
+Piecename invert_piece(Piecename id);
+
+/*Verifica se a peca pode ser movimentada no turno atual.
+	Parametros
+		Piece* piece	peca
+		Chess* chess	registro Chess do jogo
+	Retorno
+		TRUE se sim, FALSE se nao
+*/
+boolean onturn(Piece* piece, Chess* chess);
+
+/*Verifica se o peao ja foi movido.
+	Parametros
+		Piece* pawn	peao
+	Retorno
+		TRUE se ja foi movido, FALSE caso contrario
+*/
+boolean moved(Piece* pawn);
+
+/*Compara dois registros Piece.
+	Parametros
+		Piece* p1	elemento um
+		Piece* p2	elemento dois
+	Retorno
+		0, se sao iguais, um valor maior que zero se p1 tem menos prioridade que p2 e um valor menor que zero caso contrario
+*/
+char cmp_piece(Piece* p1, Piece* p2);
+
+/*Efetua uma copia de uma peca.
+	Parametros
+		Position* des		destino, se NULL e feita uma alocacao
+		Position* src		fonte
+		Arena* arena		memoria do jogo
+	Retorno
+		copia
+*/
+Piece* cpy_piece(Piece* dest, Piece* src, Arena* arena);
+
+/*Procura num vetor de registros Piece por uma posicao de movimentacao de um tipo de peca.
+	Parametros
+		Position* key		posicao chave de busca
+		Piece** piece		vetor com os registros de pecas
+		char n			numero total de elementos do vetor
+		char k			indice da peca chave
+	Retorno
+		vetor com os registros Piece em que a chave foi encontrada.
+*/
+Piece** searchPositions_piece(Position* key, Piece** piece, char n, char k);
+
+/*Adiciona uma posicao de movimento, se possivel, a uma peca.
+	Parametros
+		Piece* piece	registro da peca
+		Chess* chess	registro Chess do jogo
+		boolean tk	opcao para verificar ou nao ameaca ao rei
+		char file	coluna
+		char rank	linha
+	Retorno
+		TRUE se a posicao esta vazia, FALSE caso contrario
+*/
+boolean insertMove_piece(Piece* piece, Chess* chess, boolean tk, char file, char rank);
+
+/*Funcoes de movimentacao das pecas que nao dependem da cor, chamadas pelo tipo da peca na geracao do turno (a
+dama usa as da torre e do bispo). Geram os movimentos possiveis para suas pecas.
+	Parametros
+		Piece*		registro Piece da peca
+		Chess*		registro Chess do jogo
+		boolean tk	opcao para verificar ou nao ameaca ao rei
+*/
+void rook(Piece* rook, Chess* chess, boolean tk);
+void bishop(Piece* bishop, Chess* chess, boolean tk);
+void knight(Piece* knight, Chess* chess, boolean tk);
+
+/*Verifica se uma dada posicao esta ameacao por alguma peca de cor especificada.
+	Parametros
+		Chess* chess		registro chess
+		char file		coluna
+		char rank		linha
+		char player		cor
+	Retorno
+		TRUE se ameacada, FALSE caso contrario
+*/
+boolean threat(Chess* chess, char file, char rank, char player);
+
+/*Verifica se um movimento ameaca o rei.
+	Parametros
+		Chess* chess	registro Chess
+		Piece* piece	peca a ser movida
+		char file	coluna da posicao alvo
+		char rank	linha da posicao alvo
+	Retorno
+		TRUE se o movimento ameaca o rei, FALSE caso contrario
+*/
+boolean threatKing(Chess* chess, Piece* piece, char file, char rank);
+
+/*Interpreta e valida estritamente um codigo FEN, sem alocacoes: formato de cada campo, um rei de cada cor,
+numero de pecas, peoes fora das linhas 1 e 8, roque coerente com reis e torres, en passant coerente com o turno
+e rei fora do turno sem xeque.
+	Parametros
+		const char* fen		codigo FEN
+		Fen* f			recipiente para os campos
+	Retorno
+		TRUE se valido, FALSE caso contrario
+*/
+boolean parseFen(const char* fen, Fen* f);
+
+/*Valida os campos de uma posicao: um rei de cada cor, numero de pecas, peoes fora das linhas 1 e 8, roque coerente
+com reis e torres, en passant coerente com o turno, contadores e rei fora do turno sem xeque.
+	Parametros
+		const Fen* f		campos
+	Retorno
+		TRUE se valida, FALSE caso contrario
+*/
+boolean validFen(const Fen* f);
+
+/*Escreve o codigo FEN de uma posicao, sem alocacoes.
+	Parametros
+		const Fen* f		campos
+		char* fen		recipiente com no minimo FEN_SIZE caracteres
+	Retorno
+		fen
+*/
+char* writeFen(const Fen* f, char* fen);
+
+/*Inicializa um registro Chess, efetuando uma alocacao, a partir um codigo FEN.
+	Parametros
+		char* fen	codigo FEN
+	Retorno
+		registro Chess, NULL se o codigo e invalido
+*/
+Chess* initialize_chess(char* fen);
+
+/*Carrega um codigo FEN num registro Chess ja alocado (e vazio). Nada e alocado se o codigo e invalido.
+	Parametros
+		Chess* chess	registro Chess
+		char* fen	codigo FEN
+		Arena* arena	memoria do jogo, reiniciada por clear_chess; se NULL, o jogo cria a sua
+	Retorno
+		TRUE em caso de sucesso, FALSE se o codigo e invalido
+*/
+boolean load_chess(Chess* chess, char* fen, Arena* arena);
+
+/*Desaloca o conteudo de um registro Chess, sem desalocar o registro. A arena do jogo e reiniciada em O(1).
+	Parametros
+		Chess* chess	registro Chess
+*/
+void clear_chess(Chess* chess);
+
+/*Desaloca um registro Chess.
+	Parametros
+		Chess* chess	registro Chess
+*/
+void finalize_chess(Chess* chess);
+
+/*Gera o codigo FEN de um jogo de xadrez, sem alocacoes.
+	Parametros
+		Chess* chess	registro chess
+		char* fen	recipiente com no minimo FEN_SIZE caracteres
+	Retorno
+		fen
+*/
+char* genFen_chess(Chess* chess, char* fen);
+
+/*Copia os campos da posicao de um jogo de xadrez.
+	Parametros
+		Chess* chess	registro chess
+		Fen* f		recipiente para os campos
+*/
+void getFen_chess(Chess* chess, Fen* f);
+
+/*Efetua a troca de duas posicoes no tabuleiro.
+	Parametros
+		Chess* chess	registro Chess
+		char file1	coluna da primeira posicao
+		char rank1	linha da primeira posicao
+		char file2	coluna da segunda posicao
+		char rank2	linha da segunda posicao
+*/
+void swapPiece_chess(Chess* chess, char file1, char rank1, char file2, char rank2);
+
+/*Atualiza o vetor de posicoes de uma com as posicoes possiveis para o turno. Os vetor e ordenado.
+	Parametros
+		Piece* piece	peca
+		Chess* chess	registro Chess
+*/
+void updateMovesPositions_piece(Piece* piece, Chess* chess);
+
+/*Atualiza o vetor de posicoes de cada peca com as posicoes possiveis para o turno. Os vetores sao ordenados.
+	Parametros
+		Chess* chess	registro Chess
+*/
+void updateMovesPositions_chess(Chess* chess, char wb);
+
+/*Grava a posicao do jogo no historico de chaves zobrist usado pela tripla repeticao e escreve o seu codigo FEN.
+	Parametros
+		Chess* chess	registro Chess
+		char* fen	recipiente com no minimo FEN_SIZE caracteres
+	Retorno
+		codigo FEN
+*/
+char* recordGame_chess(Chess* chess, char* fen);
+
+/*Analisa a situacao de um jogo de xadrez pelos contadores mantidos a cada movimento: repeticao das chaves do
+historico desde o ultimo movimento irreversivel, material, movimentos possiveis, xeque e meios-turnos.
+	Parametros
+		Chess* chess		registro Chess
+	Retorno
+		situacao do jogo
+*/
+Gamesit sit_chess(Chess* chess);
+
+/*Verifica se o turno tem algum movimento possivel.
+	Parametros
+		Chess* chess	registro Chess
+	Retorno
+		TRUE se ha movimento possivel, FALSE caso contrario
+*/
+boolean hasMoves_chess(Chess* chess);
+
+/*Verifica se o material restante nao permite xeque-mate: somente reis, reis e uma peca menor, ou reis e bispos
+todos em casas da mesma cor.
+	Parametros
+		Chess* chess	registro Chess
+	Retorno
+		TRUE se o material e insuficiente, FALSE caso contrario
+*/
+boolean insufficient_chess(Chess* chess);
+
+/*Realiza um movimento num jogo de xadrez.
+	Parametros
+		Chess* chess	registro Chess do jogo
+		Piece* piece	peca
+		Position* dest	posicao destino
+	Retorno
+		TRUE se o movimento foi realizado, FALSE se o movimento e invalido
+*/
+boolean makeMove_chess(Chess* chess, Piece* piece, Position* dest);
+
+/*Desfaz um movimento, a partir de dados do estado anterior.
+	Parametros
+		Chess* chess		registro Chess
+		Piece* dest		peca na posicao destino
+		Piece* piece		peca do movimento
+		int mid_turns		numero de meios-turnos anterior
+		char* castling		string de roque anterior
+		Position* en_passant	registro de movimento en_passant anterior
+*/
+void backMove_chess(Chess* chess, Piece* dest, Piece* piece, int mid_turns, char* castling, Position* en_passant);
+
+/*Calcula a pontuacao de um movimento.
+	Parametros
+		Chess* chess		registro Chess
+		Piece* piece		peca
+		Position* dest		posicao destino
+		long long* phase	tempos das fases em ns, acrescidos da geracao e da avaliacao
+	Retorno
+		pontuacao
+*/
+double moveScore_chess(Chess* chess, Piece* piece, Position* dest, long long* phase);
+
+/*Gera um movimento utilizando uma metrica de decisao.
+	Parametros
+		Chess* chess		registro Chess
+		Piece** piece		recipiente para a peca ser movida
+		Position* dest		recipiente para a posicao destino
+	Retorno
+		TRUE se ha um movimento possivel, FALSE caso contrario
+*/
+boolean moveAI_chess(Chess* chess, Piece** piece, Position* dest);
+
+/*Define uma posicao destino e uma peca a ser movida a partir da leitura de uma anotacao em notacao algebrica simplificada.
+	Parametros
+		FILE* fp		entrada
+		Chess* chess		registro Chess do jogo
+		Piece** piece		ponteiro para a peca
+		Position dest		posicao destino
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de insucesso e -1 se houve falha na leitura do arquivo
+*/
+char readPieceMove_chess(FILE* fp, Chess* chess, Piece** piece, Position* dest);
+
+/*Interpreta um movimento em notacao algebrica simplificada (ex.: e2e4, e7e8q) no turno atual.
+	Parametros
+		Chess* chess		registro Chess do jogo
+		char* str		anotacao do movimento
+		Piece** piece		ponteiro para a peca
+		Position* dest		posicao destino, com o tipo de ocupacao do movimento gerado
+	Retorno
+		TRUE se a anotacao corresponde a um movimento possivel, FALSE caso contrario
+*/
+boolean parseMove_chess(Chess* chess, char* str, Piece** piece, Position* dest);
+
+/*Gera a anotacao em notacao algebrica simplificada de um movimento.
+	Parametros
+		Move* move	movimento
+		char* str	recipiente com no minimo 6 caracteres
+	Retorno
+		str
+*/
+char* str_move(Move* move, char* str);
+
+/*Lista os movimentos possiveis para o turno atual.
+	Parametros
+		Chess* chess	registro Chess
+		Move* list	recipiente com no minimo MAX_MOVES elementos
+	Retorno
+		numero de movimentos
+*/
+int genMoves_chess(Chess* chess, Move* list);
+
+/*Efetua um movimento, guardando os dados para desfaze-lo com undoMove_chess.
+	Parametros
+		Chess* chess	registro Chess
+		Move* move	movimento possivel no turno
+		Undo* undo	recipiente para os dados do estado anterior
+*/
+void doMove_chess(Chess* chess, Move* move, Undo* undo);
+
+/*Desfaz um movimento efetuado com doMove_chess.
+	Parametros
+		Chess* chess	registro Chess
+		Undo* undo	dados do estado anterior
+*/
+void undoMove_chess(Chess* chess, Undo* undo);
+
+/*Mistura os bits de um inteiro (splitmix64), usado para gerar as chaves zobrist sem tabela.
+	Parametros
+		uint64_t x	inteiro
+	Retorno
+		valor pseudoaleatorio
+*/
+uint64_t zobrist(uint64_t x);
+
+/*Calcula a chave zobrist da posicao.
+	Parametros
+		Chess* chess	registro Chess
+	Retorno
+		chave
+*/
+uint64_t key_chess(Chess* chess);
+
+/*Verifica se o rei do turno esta em xeque pelo mapa de casas atacadas pelas pecas fora do turno. O mapa e o
+resultado ficam guardados ate o proximo movimento.
+	Parametros
+		Chess* chess	registro Chess
+	Retorno
+		TRUE se em xeque, FALSE caso contrario
+*/
+boolean incheck_chess(Chess* chess);
+
+/*Avalia estaticamente a posicao do ponto de vista do turno.
+	Parametros
+		Chess* chess	registro Chess
+	Retorno
+		pontuacao em centipeoes
+*/
+int evaluate_chess(Chess* chess);
+
+/*Copia os campos de uma posicao valida para um registro State, calculando a chave.
+	Parametros
+		State* st	destino
+		const Fen* f	campos da posicao
+*/
+void loadFen_state(State* st, const Fen* f);
+
+/*Copia os campos de um registro State para um registro Fen.
+	Parametros
+		const State* st	posicao
+		Fen* f		destino
+*/
+void getFen_state(const State* st, Fen* f);
+
+/*Copia a posicao atual de um jogo para um registro State.
+	Parametros
+		Chess* chess	registro Chess
+		State* st	destino
+*/
+void getState_chess(Chess* chess, State* st);
+
+/*Carrega um registro State num registro Chess ja alocado (e vazio); o historico comeca na posicao.
+	Parametros
+		Chess* chess	registro Chess
+		const State* st	posicao
+		Arena* arena	memoria do jogo, NULL para uma arena propria
+*/
+void loadState_chess(Chess* chess, const State* st, Arena* arena);
+
+/*Copia um registro State. A copia e independente: nenhum dado e compartilhado.
+	Parametros
+		State* dest	destino
+		const State* src	fonte
+	Retorno
+		dest
+*/
+State* clone_state(State* dest, const State* src);
+
+/*Lista os movimentos possiveis para o turno, na mesma ordem de genMoves_chess.
+	Parametros
+		const State* st	posicao
+		Move* list	recipiente com no minimo MAX_MOVES elementos
+	Retorno
+		numero de movimentos
+*/
+int genMoves_state(const State* st, Move* list);
+
+/*Verifica se um movimento e possivel sem gerar os demais: regra da peca, caminho livre, roque (direito, casas
+livres e nao atacadas) e rei do turno fora de xeque apos o movimento. Concorda com genMoves_state.
+	Parametros
+		const State* st	posicao
+		Move* move	movimento: origem, destino e, em move->dest.x, a promocao maiuscula (N, B, R ou Q) ou
+				qualquer outro valor; se possivel, move->dest.x recebe o tipo de ocupacao do movimento gerado
+	Retorno
+		TRUE se o movimento e possivel, FALSE caso contrario
+*/
+boolean legal_state(const State* st, Move* move);
+
+/*Interpreta e valida um movimento em notacao algebrica simplificada com legal_state.
+	Parametros
+		const State* st	posicao
+		const char* str	movimento (ex.: e2e4, e7e8q)
+		Move* move	recipiente para o movimento
+	Retorno
+		TRUE se o movimento e possivel, FALSE caso contrario
+*/
+boolean parseMove_state(const State* st, const char* str, Move* move);
+
+/*Interpreta um lance em notacao SAN no turno atual, como parseSan_chess.
+	Parametros
+		const State* st	posicao
+		const char* san	lance
+		int n		tamanho do lance
+		Move* move	recipiente para o movimento
+	Retorno
+		TRUE se o lance corresponde a exatamente um movimento possivel, FALSE caso contrario
+*/
+boolean parseSan_state(const State* st, const char* san, int n, Move* move);
+
+/*Efetua um movimento no proprio registro. Para manter a posicao anterior, o movimento e feito numa copia.
+	Parametros
+		State* st	posicao
+		const Move* move	movimento possivel no turno
+*/
+void doMove_state(State* st, const Move* move);
+
+/*Verifica se uma casa e atacada por alguma peca de uma cor.
+	Parametros
+		const State* st	posicao
+		int sq		casa rank*8+file
+		char player	cor das pecas atacantes: 0 - brancas, 1 - pretas
+	Retorno
+		TRUE se atacada, FALSE caso contrario
+*/
+boolean attacked_state(const State* st, int sq, char player);
+
+/*Verifica se o rei do turno esta em xeque.
+	Parametros
+		const State* st	posicao
+	Retorno
+		TRUE se em xeque, FALSE caso contrario
+*/
+boolean incheck_state(const State* st);
+
+/*Retorna a chave zobrist da posicao, igual a de key_chess.
+	Parametros
+		const State* st	posicao
+	Retorno
+		chave
+*/
+uint64_t key_state(const State* st);
+
+/*Avalia estaticamente a posicao do ponto de vista do turno, com os mesmos termos de evaluate_chess.
+	Parametros
+		const State* st	posicao
+		const Move* list	movimentos possiveis no turno (mobilidade)
+		int n		numero de movimentos
+	Retorno
+		pontuacao em centipeoes
+*/
+int evaluate_state(const State* st, const Move* list, int n);
+
+/*Inicializa uma tabela de transposicao.
+	Parametros
+		TTable* tt	tabela
+		size_t mb	tamanho em MB
+*/
+void initialize_ttable(TTable* tt, size_t mb);
+
+/*Desaloca as entradas de uma tabela de transposicao.
+	Parametros
+		TTable* tt	tabela
+*/
+void finalize_ttable(TTable* tt);
+
+/*Apaga todas as entradas de uma tabela de transposicao.
+	Parametros
+		TTable* tt	tabela
+*/
+void clear_ttable(TTable* tt);
+
+/*Procura uma posicao na tabela de transposicao.
+	Parametros
+		TTable* tt	tabela
+		uint64_t key	chave da posicao
+	Retorno
+		entrada encontrada, NULL caso contrario
+*/
+TTEntry* probe_ttable(TTable* tt, uint64_t key);
+
+/*Grava o resultado da busca de uma posicao na tabela de transposicao.
+	Parametros
+		TTable* tt	tabela
+		uint64_t key	chave da posicao
+		int depth	profundidade
+		int score	pontuacao
+		Bound bound	tipo de limite
+		Move* best	melhor movimento, NULL se nenhum
+*/
+void store_ttable(TTable* tt, uint64_t key, int depth, int score, Bound bound, Move* best);
+
+/*Estima a ocupacao da tabela pela busca atual.
+	Parametros
+		TTable* tt	tabela
+	Retorno
+		ocupacao em permil
+*/
+int hashfull_ttable(TTable* tt);
+
+/*Abre um cache de analise, criando o arquivo se ele nao existe. Varios processos podem abrir o mesmo arquivo:
+as entradas sao lidas e gravadas sem bloqueio, e entradas incompletas sao descartadas na leitura.
+	Parametros
+		Cache* c		recipiente
+		const char* path	caminho
+		size_t mb		tamanho em MB de um novo arquivo; um arquivo existente mantem o seu
+	Retorno
+		TRUE em caso de sucesso, FALSE se o arquivo nao pode ser criado ou lido, ou tem outra versao
+*/
+boolean open_cache(Cache* c, const char* path, size_t mb);
+
+/*Desfaz o mapeamento de um cache de analise. As entradas gravadas permanecem no arquivo.
+	Parametros
+		Cache* c	cache
+*/
+void close_cache(Cache* c);
+
+/*Busca uma posicao no cache de analise.
+	Parametros
+		Cache* c	cache
+		uint64_t key	chave zobrist
+		TTEntry* e	recipiente para a entrada, com os campos da tabela de transposicao
+	Retorno
+		TRUE se a posicao foi encontrada, FALSE caso contrario
+*/
+boolean probe_cache(Cache* c, uint64_t key, TTEntry* e);
+
+/*Grava o resultado da busca de uma posicao no cache de analise, se a profundidade nao e menor que a da entrada
+da mesma posicao ou de outra posicao na mesma casa.
+	Parametros
+		Cache* c	cache
+		uint64_t key	chave zobrist
+		int depth	profundidade
+		int score	pontuacao
+		Bound bound	tipo de limite
+		const Move* best	melhor movimento, NULL se nenhum
+*/
+void store_cache(Cache* c, uint64_t key, int depth, int score, Bound bound, const Move* best);
+
+/*Retorna o tempo decorrido desde o inicio da busca.
+	Parametros
+		Search* s	busca
+	Retorno
+		tempo em ms
+*/
+long long elapsed_search(Search* s);
+
+/*Le o relogio monotonico.
+	Retorno
+		tempo em ns
+*/
+long long clock_ns(void);
+
+/*Acrescenta uma amostra a um histograma. Seguro entre threads.
+	Parametros
+		Histogram* h	histograma
+		long long v	amostra em ns
+*/
+void record_histogram(Histogram* h, long long v);
+
+/*Calcula um percentil de um histograma.
+	Parametros
+		const Histogram* h	histograma
+		double p		percentil, de 0 a 100
+	Retorno
+		limite superior do intervalo do percentil, limitado a maior amostra, em ns
+*/
+long long percentile_histogram(const Histogram* h, double p);
+
+/*Registra as latencias de uma decisao da IA nos histogramas do processo, por numero de pecas e, para o
+tempo total, por numero de movimentos possiveis.
+	Parametros
+		int pieces		numero de pecas da posicao
+		int moves		numero de movimentos possiveis
+		const long long* phase	tempo de cada fase em ns, fases com tempo negativo nao sao registradas
+*/
+void record_latency(int pieces, int moves, const long long* phase);
+
+/*Inicializa uma busca de mate.
+	Parametros
+		Mate* m		busca
+		size_t mb	tamanho da tabela em MB
+*/
+void initialize_mate(Mate* m, size_t mb);
+
+/*Desaloca a tabela de uma busca de mate.
+	Parametros
+		Mate* m		busca
+*/
+void finalize_mate(Mate* m);
+
+/*Procura o mate forcado mais curto do turno em ate n lances, por busca de numeros de prova em profundidade com
+limite de profundidade. A prova e exata: sem avaliacao heuristica, apenas a geracao de movimentos. A variante
+fica em m->pv, com a defesa que adia o mate o maximo possivel.
+	Parametros
+		Mate* m		busca, com m->max_nodes definido
+		const State* st	posicao
+		int n		numero maximo de lances do turno, ate MAX_PLY/2
+	Retorno
+		numero de lances do mate mais curto, 0 se provado que nao ha mate em ate n lances, -1 se o limite de nos
+		foi atingido antes da prova
+*/
+int solve_mate(Mate* m, const State* st, int n);
+
+/*Inicializa uma busca MCTS: pool de nos, uma thread, sem limites.
+	Parametros
+		Mcts* m		busca
+		size_t mb	tamanho do pool em MB
+*/
+void initialize_mcts(Mcts* m, size_t mb);
+
+/*Desaloca o pool de nos de uma busca MCTS.
+	Parametros
+		Mcts* m		busca
+*/
+void finalize_mcts(Mcts* m);
+
+/*Busca em arvore Monte Carlo a partir de uma posicao, com m->threads threads sobre a mesma arvore. Cada playout
+desce pela selecao PUCT com perda virtual, expande a folha ja visitada (probabilidades a priori pelas capturas e
+promocoes) e a avalia pela busca quiescente, convertida em chance de vitoria. A busca termina no limite de playouts ou de
+tempo, no sinal de parada ou quando o pool se esgota.
+	Parametros
+		Mcts* m		busca, com os limites definidos
+		const State* st	posicao
+	Retorno
+		TRUE se ha um movimento possivel, FALSE caso contrario
+*/
+boolean search_mcts(Mcts* m, const State* st);
+
+/*Busca alfa-beta com aprofundamento iterativo. O resultado fica em s->best e s->score e, com s->multipv,
+as melhores variantes ficam em s->lines.
+	Parametros
+		Search* s	busca, com os limites definidos
+	Retorno
+		TRUE se ha um movimento possivel, FALSE caso contrario
+*/
+boolean iterate_search(Search* s);
+
+/*Busca alfa-beta (negamax) com tabela de transposicao. Cada filho e uma copia da posicao: nada a desfazer.
+	Parametros
+		Search* s	busca
+		const State* st	posicao
+		int depth	profundidade restante
+		int alpha	limite inferior
+		int beta	limite superior
+		int ply	distancia da raiz
+	Retorno
+		pontuacao da posicao do ponto de vista do turno
+*/
+int alphaBeta_search(Search* s, const State* st, int depth, int alpha, int beta, int ply);
+
+/*Busca quiescente: somente capturas e promocoes ate a posicao ficar calma.
+	Parametros
+		Search* s	busca
+		const State* st	posicao
+		int alpha	limite inferior
+		int beta	limite superior
+		int ply	distancia da raiz
+	Retorno
+		pontuacao da posicao do ponto de vista do turno
+*/
+int quiescence_search(Search* s, const State* st, int alpha, int beta, int ply);
+
+/*Converte uma linha FEN ou EPD num codigo FEN completo (contadores padrao se ausentes).
+	Parametros
+		char* line	linha de entrada
+		char* fen	recipiente para o FEN
+		size_t n	tamanho do recipiente
+	Retorno
+		TRUE se a linha contem os 4 campos obrigatorios, FALSE caso contrario
+*/
+boolean epdToFen(char* line, char* fen, size_t n);
+
+/*Obtem o operando de uma operacao de uma linha EPD (ex.: bm, am, id, dm), sem as aspas.
+	Parametros
+		const char* line	linha EPD
+		const char* op		codigo da operacao
+		char* buf		recipiente para o operando
+		size_t n		tamanho do recipiente
+	Retorno
+		TRUE se a operacao esta presente, FALSE caso contrario
+*/
+boolean epdOperand(const char* line, const char* op, char* buf, size_t n);
+
+/*Gera a anotacao UCI de uma pontuacao (cp <x> ou mate <n>).
+	Parametros
+		int score	pontuacao
+		char* str	recipiente com no minimo 20 caracteres
+	Retorno
+		str
+*/
+char* str_score(int score, char* str);
+
+/*Interpreta um lance em notacao SAN (desambiguacao, capturas, promocoes, roque, xeque) no turno atual.
+	Parametros
+		Chess* chess		registro Chess do jogo
+		const char* san		lance
+		int n			tamanho do lance
+		Piece** piece		ponteiro para a peca
+		Position* dest		posicao destino
+	Retorno
+		TRUE se o lance corresponde a exatamente um movimento possivel, FALSE caso contrario
+*/
+boolean parseSan_chess(Chess* chess, const char* san, int n, Piece** piece, Position* dest);
+
+/*Escreve um movimento do turno atual em notacao SAN, com desambiguacao minima e indicacao de xeque ou mate.
+	Parametros
+		Chess* chess		registro Chess do jogo
+		Move* move		movimento possivel
+		char* san		recipiente com no minimo 8 caracteres
+	Retorno
+		san
+*/
+char* genSan_chess(Chess* chess, Move* move, char* san);
+
+/*Compacta uma posicao valida em 32 bytes.
+	Parametros
+		const Fen* f		campos da posicao
+		Packed* p		recipiente
+*/
+void packFen(const Fen* f, Packed* p);
+
+/*Descompacta e valida uma posicao.
+	Parametros
+		const Packed* p		posicao compactada
+		Fen* f			recipiente para os campos
+	Retorno
+		TRUE se a posicao e valida, FALSE caso contrario
+*/
+boolean unpackFen(const Packed* p, Fen* f);
+
+/*Compacta a posicao de um jogo de xadrez.
+	Parametros
+		Chess* chess	registro Chess
+		Packed* p	recipiente
+*/
+void pack_chess(Chess* chess, Packed* p);
+
+/*Carrega uma posicao compactada num registro Chess ja alocado (e vazio). Nada e alocado se a posicao e invalida.
+	Parametros
+		Chess* chess		registro Chess
+		const Packed* p		posicao compactada
+		Arena* arena		memoria do jogo, como em load_chess
+	Retorno
+		TRUE em caso de sucesso, FALSE se a posicao e invalida
+*/
+boolean loadPacked_chess(Chess* chess, const Packed* p, Arena* arena);
+
+/*Compacta um vetor de codigos FEN. Posicoes invalidas sao zeradas.
+	Parametros
+		char** fen		codigos FEN
+		size_t n		numero de codigos
+		Packed* p		recipiente com n posicoes
+	Retorno
+		numero de posicoes validas
+*/
+size_t encode_packed(char** fen, size_t n, Packed* p);
+
+/*Descompacta um vetor de posicoes em codigos FEN. Posicoes invalidas geram strings vazias.
+	Parametros
+		const Packed* p		posicoes compactadas
+		size_t n		numero de posicoes
+		char (*fen)[FEN_SIZE]	recipiente com n codigos
+	Retorno
+		numero de posicoes validas
+*/
+size_t decode_packed(const Packed* p, size_t n, char (*fen)[FEN_SIZE]);
+
+/*Cria um arquivo de posicoes compactadas, escrevendo o cabecalho. Os registros sao acrescentados com fwrite.
+	Parametros
+		const char* path	caminho
+	Retorno
+		arquivo aberto para escrita, NULL em caso de erro
+*/
+FILE* create_packfile(const char* path);
+
+/*Mapeia em memoria um arquivo de posicoes compactadas, somente leitura.
+	Parametros
+		PackFile* pf		recipiente
+		const char* path	caminho
+	Retorno
+		TRUE em caso de sucesso, FALSE se o arquivo nao pode ser lido ou nao e um arquivo de posicoes
+*/
+boolean open_packfile(PackFile* pf, const char* path);
+
+/*Desfaz o mapeamento de um arquivo de posicoes compactadas.
+	Parametros
+		PackFile* pf		arquivo
+*/
+void close_packfile(PackFile* pf);
+
+/*Codifica um movimento em 16 bits, como em query_moves: casa de origem (bits 0 a 5), casa destino (6 a 11) e
+promocao (12 a 14, 0 nenhuma, 1 a 4 de cavalo a dama).
+	Parametros
+		const Move* move	movimento
+	Retorno
+		codigo
+*/
+unsigned short code_move(const Move* move);
+
+/*Retorna a chave de uma posicao no indice de aberturas: a chave zobrist sem a coluna do en passant quando nenhum
+peao do turno pode captura-lo, para que a mesma posicao tenha uma unica chave com ou sem a casa no FEN.
+	Parametros
+		const State* st	posicao
+	Retorno
+		chave
+*/
+uint64_t key_explorer(const State* st);
+
+/*Compara duas entradas de indice de aberturas pela chave e depois pelo movimento (funcao de qsort).
+	Parametros
+		const void* a	entrada
+		const void* b	entrada
+	Retorno
+		negativo, zero ou positivo
+*/
+int cmp_explorer(const void* a, const void* b);
+
+/*Ordena entradas de indice de aberturas e soma as contagens das entradas da mesma posicao e movimento.
+	Parametros
+		ExplorerEntry* e	entradas
+		size_t n		numero de entradas
+	Retorno
+		numero de entradas distintas, no inicio do vetor
+*/
+size_t compact_explorer(ExplorerEntry* e, size_t n);
+
+/*Cria um indice de aberturas para gravacao.
+	Parametros
+		ExplorerWriter* w	recipiente
+		const char* path	caminho
+	Retorno
+		TRUE em caso de sucesso, FALSE se o arquivo nao pode ser criado
+*/
+boolean create_explorer(ExplorerWriter* w, const char* path);
+
+/*Acrescenta uma entrada ao indice em gravacao. As entradas devem vir em ordem de chave e movimento; entradas
+iguais consecutivas tem as contagens somadas. Cada bloco e gravado comprimido: diferencas das chaves e
+contagens em inteiros de tamanho variavel.
+	Parametros
+		ExplorerWriter* w		indice
+		const ExplorerEntry* e		entrada
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de erro de escrita
+*/
+boolean write_explorer(ExplorerWriter* w, const ExplorerEntry* e);
+
+/*Conclui um indice de aberturas: grava o ultimo bloco, o diretorio e o cabecalho, e fecha o arquivo.
+	Parametros
+		ExplorerWriter* w	indice
+		uint64_t games		numero de jogos indexados
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de erro de escrita
+*/
+boolean finish_explorer(ExplorerWriter* w, uint64_t games);
+
+/*Mapeia em memoria um indice de aberturas, somente leitura.
+	Parametros
+		Explorer* ex		recipiente
+		const char* path	caminho
+	Retorno
+		TRUE em caso de sucesso, FALSE se o arquivo nao pode ser lido ou nao e um indice desta versao
+*/
+boolean open_explorer(Explorer* ex, const char* path);
+
+/*Desfaz o mapeamento de um indice de aberturas.
+	Parametros
+		Explorer* ex	indice
+*/
+void close_explorer(Explorer* ex);
+
+/*Busca as entradas de uma posicao no indice de aberturas: busca por interpolacao no diretorio (chaves zobrist
+sao uniformes) e leitura sequencial dos blocos da chave.
+	Parametros
+		const Explorer* ex	indice
+		uint64_t key		chave zobrist da posicao
+		ExplorerEntry* res	recipiente com m elementos
+		int m			capacidade
+	Retorno
+		numero de entradas da posicao, em ordem de movimento; somente as m primeiras sao escritas
+*/
+int search_explorer(const Explorer* ex, uint64_t key, ExplorerEntry* res, int m);
+
+#endif
@@ -0,0 +1,4218 @@
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "engine.h"
+#include "tools.h"
+
+#define PACK_BLOCK 4096		//Posicoes convertidas de uma vez pelos modos --pack e --unpack
+#define SAMPLE_MAGIC "CHESSTD1"	//Identificacao de um arquivo de posicoes rotuladas para treino
+#define INDEX_MB 256		//Memoria padrao das posicoes do modo --index, em MB, dividida entre as threads
+#define INDEX_READ 4096		//Entradas lidas de uma vez de cada sequencia ordenada na intercalacao do modo --index
+#define INACCURACY 50		//Perda em centipeoes de um lance imprecisao (?!) no modo --annotate
+#define MISTAKE 100		//Perda de um erro (?)
+#define BLUNDER 300		//Perda de um erro grave (??)
+#define LOSS_CAP 1000		//Pontuacoes limitadas no calculo da perda: lances de uma posicao ganha nao sao erros
+#define RESULT_MB 16		//Memoria padrao do cache de resultados do modo --server, em MB
+#define RESULT_SHARDS 16	//Particoes do cache de resultados, cada uma com sua exclusao mutua
+
+typedef struct uci Uci;
+typedef struct batch Batch;
+typedef struct workqueue WorkQueue;
+typedef struct session Session;
+typedef struct server Server;
+typedef struct result_entry ResultEntry;
+typedef struct result_shard ResultShard;
+typedef struct result_cache ResultCache;
+typedef struct pgn Pgn;
+typedef struct pgn_token PgnToken;
+typedef struct index_run IndexRun;
+typedef struct index_reader IndexReader;
+typedef struct match Match;
+typedef struct sample Sample;
+typedef struct writer Writer;
+typedef struct bloom Bloom;
+typedef struct generator Generator;
+typedef struct annotation Annotation;
+typedef struct annotator Annotator;
+
+struct sample {				//Posicao rotulada para treino, 36 bytes, sem dependencia de alinhamento ou ordem de bytes
+	Packed pos;			//Posicao
+	uint8_t score[2];		//Pontuacao da busca para o turno, inteiro de 16 bits little endian
+	int8_t result;			//Resultado da partida para o turno: 1 vitoria, 0 empate, -1 derrota
+	uint8_t reserved;		//Zero
+};
+
+struct writer {				//Escrita bufferizada compartilhada entre threads, com fsync periodico
+	int fd;
+	char* buf;			//Dados ainda nao escritos
+	size_t n;
+	size_t m;
+	long long written;		//Bytes escritos no total
+	long long unsynced;		//Bytes escritos desde o ultimo fsync
+	long long sync;			//Bytes entre cada fsync
+	boolean error;			//Houve erro de escrita
+	pthread_mutex_t lock;
+};
+
+struct bloom {				//Filtro de Bloom de chaves zobrist, limitado e sem travas
+	uint64_t* bits;
+	uint64_t mask;			//Numero de bits menos 1 (potencia de 2)
+};
+
+struct generator {			//Geracao de posicoes rotuladas por partidas da IA contra si mesma
+	int max_depth;			//Limites de cada busca
+	long long max_nodes;
+	int random_plies;		//Meios-turnos aleatorios no inicio de cada partida, sem amostras
+	int max_plies;			//Meios-turnos ate o empate por adjudicacao
+	long long target;		//Numero de posicoes a gerar, -1 sem limite
+	uint64_t seed;			//Semente das threads
+	size_t hash;			//Tabela de transposicao de cada thread, em MB
+	Bloom bloom;			//Posicoes ja geradas
+	Writer out;			//Saida
+	pthread_mutex_t lock;		//Exclusao mutua dos contadores
+	long long positions;		//Posicoes gravadas
+	long long games;		//Partidas jogadas
+	long long noisy;		//Posicoes descartadas: xeque ou melhor movimento tatico
+	long long duplicates;		//Posicoes descartadas: repetidas
+};
+
+struct match {				//Partidas da IA contra si mesma entre duas configuracoes, A e B, numa thread
+	char** opening;			//Posicoes iniciais (FEN), cada uma jogada duas vezes com as cores trocadas
+	int n_opening;
+	int games;			//Numero de partidas
+	int* next;			//Proxima partida a iniciar, compartilhado entre as threads
+	int max_depth[2];		//Limites de cada busca das configuracoes A e B
+	long long max_nodes[2];
+	long long max_time[2];
+	int max_plies;			//Meios-turnos ate o empate por adjudicacao
+	size_t hash;			//Tabela de transposicao de cada configuracao, em MB
+	FILE* pgn;			//Saida das partidas, NULL para nenhuma
+	pthread_mutex_t* lock;		//Exclusao mutua do contador de partidas e da saida
+	uint64_t* keys;			//Chaves das posicoes da partida (repeticao)
+	int m_keys;
+	int score[3];			//Vitorias de A, vitorias de B e empates
+	long long plies;		//Meios-turnos jogados
+	long long nodes;		//Nos visitados
+	long long* latency;		//Tempo de cada movimento, em microssegundos
+	size_t n_latency;
+	size_t m_latency;
+	Arena arena;			//Memoria das partidas, reutilizada a cada partida
+	size_t peak;			//Soma dos picos de memoria das partidas
+	size_t max_peak;		//Maior pico de memoria de uma partida
+};
+
+struct uci {			//Estado do protocolo UCI
+	Chess* chess;		//Posicao atual
+	TTable tt;		//Tabela de transposicao
+	Search search;		//Busca
+	Mcts mcts;		//Busca em arvore Monte Carlo
+	boolean use_mcts;	//Opcao Engine: busca em arvore Monte Carlo em vez da alfa-beta
+	uint64_t* keys;		//Chaves das posicoes do jogo (repeticao)
+	int m_keys;
+	pthread_t thread;	//Thread da busca
+	boolean searching;	//Ha uma busca em andamento
+	FILE* out;		//Saida
+};
+
+struct batch {				//Analise em lote de posicoes
+	FILE* in;			//Entrada: uma posicao FEN ou EPD por linha
+	FILE* out;			//Saida: uma linha de resultado por posicao
+	pthread_mutex_t in_lock;	//Exclusao mutua da leitura
+	pthread_mutex_t out_lock;	//Exclusao mutua da escrita
+	pthread_cond_t out_cond;	//Sinaliza avanco da escrita ordenada
+	long long next_in;		//Numero de sequencia da proxima linha lida
+	long long next_out;		//Numero de sequencia da proxima linha escrita (modo ordenado)
+	char** pending;			//Resultados aguardando escrita, indexados por sequencia modulo window
+	int window;			//Numero maximo de resultados pendentes
+	boolean ordered;		//Mantem a ordem da entrada
+	int max_depth;			//Limites de cada busca
+	long long max_nodes;
+	long long max_time;
+	size_t hash;			//Tamanho da tabela de transposicao de cada thread, em MB
+	Cache* cache;			//Cache de analise persistente compartilhado pelas threads, NULL se nao usado
+	long long positions;		//Posicoes analisadas
+	long long nodes;		//Nos visitados no total
+	long long mates;		//Posicoes com mate provado (--mate)
+	long long unknown;		//Posicoes sem prova no limite de nos (--mate)
+	long long solved;		//Posicoes resolvidas (--suite)
+	long long scored;		//Posicoes com solucao conhecida, operacao bm ou am (--suite)
+	Histogram solve_time;		//Tempo ate a solucao das posicoes resolvidas (--suite)
+};
+
+struct workqueue {			//Fila limitada de tarefas entre threads
+	void** item;			//Vetor circular de itens
+	int m;				//Capacidade
+	int head;			//Indice do primeiro item
+	int n;				//Numero de itens
+	boolean closed;			//Fila fechada: nao aceita itens, pop retorna NULL quando vazia
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
+struct session {			//Partida de um cliente do servidor
+	int fd;				//Socket do cliente, -1 se livre
+	int id;				//Indice na tabela de sessoes
+	Chess chess;			//Jogo, valido se playing
+	Arena arena;			//Memoria do jogo, reutilizada entre as partidas
+	boolean playing;		//Ha uma partida em andamento
+	boolean thinking;		//Ha uma busca da sessao no pool de threads
+	boolean closing;		//Conexao encerrada, aguardando o fim da busca
+	char in[512];			//Linhas recebidas ainda nao processadas
+	int n_in;
+	char* out;			//Dados a enviar
+	size_t n_out;
+	size_t m_out;
+	uint64_t* keys;			//Chaves das posicoes do jogo (repeticao)
+	int n_keys;
+	int m_keys;
+	int max_depth;			//Limites padrao das buscas da sessao
+	long long max_nodes;
+	long long max_time;
+	int req_depth;			//Limites da busca em andamento
+	long long req_nodes;
+	long long req_time;
+	boolean found;			//Resultado da busca
+	Move best;
+	int score;
+	long long nodes;
+	long long time;
+	Session* next;			//Proxima sessao livre
+	Session* waiting;		//Proxima sessao aguardando a mesma busca em andamento
+};
+
+typedef enum {			//Resultado da consulta ao cache de resultados
+	RESULT_MISS,		//Ausente: entrada reservada, a busca deve ser feita e publicada
+	RESULT_HIT,		//Presente: resultado copiado para a sessao
+	RESULT_WAIT,		//Busca identica em andamento: a sessao aguarda na entrada
+	RESULT_BYPASS		//Ausente e sem espaco: a busca deve ser feita sem cache
+} Resulttype;
+
+struct result_entry {			//Resultado de uma busca do servidor
+	uint64_t key;			//Posicao, posicoes anteriores desde o ultimo lance irreversivel e limites
+	boolean ready;			//Busca concluida; senao a entrada esta fora da lista LRU e nao pode ser descartada
+	boolean found;			//Resultado
+	Move best;
+	int score;
+	Session* waiting;		//Sessoes aguardando a busca em andamento
+	ResultEntry* next;		//Proxima entrada do balde, ou proxima entrada livre
+	ResultEntry* newer;		//Lista LRU
+	ResultEntry* older;
+};
+
+struct result_shard {			//Particao do cache de resultados: tabela hash com lista LRU e capacidade fixa
+	pthread_mutex_t lock;
+	ResultEntry* entry;		//Entradas, alocadas de uma vez
+	ResultEntry* free;		//Entradas livres
+	ResultEntry** bucket;		//Baldes, potencia de 2
+	size_t mask;
+	ResultEntry* newest;		//Lista LRU das entradas concluidas
+	ResultEntry* oldest;
+	long long hits;			//Totais
+	long long waits;
+	long long misses;
+	long long evictions;
+};
+
+struct result_cache {			//Cache de resultados do servidor, compartilhado entre as threads de busca
+	ResultShard shard[RESULT_SHARDS];
+	size_t m;			//Entradas por particao
+};
+
+struct server {				//Servidor de partidas
+	int listen_fd;			//Socket de escuta
+	int epoll_fd;
+	int event_fd;			//Notificacao de buscas concluidas
+	Session* session;		//Tabela de sessoes
+	int m;				//Numero maximo de sessoes
+	int n;				//Sessoes em uso
+	Session* free;			//Lista de sessoes livres
+	WorkQueue jobs;			//Buscas pendentes
+	WorkQueue done;			//Buscas concluidas
+	int threads;			//Numero de threads de busca
+	int max_depth;			//Limites maximos de cada busca
+	long long max_nodes;
+	long long max_time;
+	size_t hash;			//Tabela de transposicao de cada thread, em MB
+	ResultCache* results;		//Cache de resultados, NULL se nao usado
+};
+
+typedef enum {			//Tipos de elementos de um arquivo PGN
+	PGN_EOF,		//Fim do trecho
+	PGN_TAG,		//Cabecalho [Nome "Valor"]
+	PGN_NUMBER,		//Numero do lance
+	PGN_MOVE,		//Lance em notacao SAN
+	PGN_COMMENT,		//Comentario {...}, ;... ou linha de escape %...
+	PGN_VAR_BEGIN,		//Inicio de variante
+	PGN_VAR_END,		//Fim de variante
+	PGN_NAG,		//Anotacao $n, !, ?, ...
+	PGN_RESULT		//Resultado: 1-0, 0-1, 1/2-1/2 ou *
+} Pgntype;
+
+struct pgn_token {		//Elemento de um arquivo PGN, apontando para o texto original (sem copia)
+	Pgntype type;
+	const char* p;		//Inicio do texto
+	int n;			//Tamanho do texto
+};
+
+struct pgn {				//Leitura de um trecho de um arquivo PGN mapeado em memoria
+	const char* p;			//Posicao atual
+	const char* end;		//Fim do trecho
+	boolean fen;			//Escreve o FEN de cada posicao
+	FILE* out;			//Saida dos FEN
+	pthread_mutex_t* out_lock;	//Exclusao mutua da saida entre threads
+	char* buf;			//Saida de um jogo, escrita de uma vez
+	size_t n_buf;
+	size_t m_buf;
+	long long games;		//Jogos lidos
+	long long plies;		//Lances reproduzidos
+	long long errors;		//Jogos com lance invalido ou nao reconhecido
+	IndexRun* run;			//Posicoes do indice de aberturas, NULL se nao usado
+};
+
+struct index_run {			//Posicoes do indice de aberturas lidas por uma thread
+	ExplorerEntry* entry;		//Posicoes em memoria: dos jogos concluidos, depois as do jogo atual
+	size_t n;
+	size_t m;			//Capacidade, pela memoria da thread
+	size_t game;			//Inicio das posicoes do jogo atual
+	const char* dir;		//Diretorio dos arquivos temporarios
+	FILE** runs;			//Sequencias ordenadas gravadas em arquivos temporarios (ja removidos)
+	int n_runs;
+	long long games;		//Jogos com resultado indexados
+	long long positions;		//Posicoes indexadas
+	boolean error;			//Erro de escrita de uma sequencia
+};
+
+struct annotation {			//Jogo do anotador de PGN
+	long long seq;			//Ordem do jogo no arquivo
+	const char* text;		//Texto original do jogo, no arquivo mapeado
+	size_t n_text;
+	const char* tags;		//Cabecalhos, texto original
+	size_t n_tags;
+	char fen[FEN_SIZE];		//Posicao inicial
+	char result[8];			//Resultado, "*" se ausente
+	Move* moves;			//Lances da linha principal
+	int n;
+	boolean error;			//Posicao inicial ou lance invalido: o jogo e escrito sem alteracao
+	char* out;			//Jogo anotado
+	size_t n_out;
+};
+
+struct annotator {			//Anotador de PGN: leitura, analise em varias threads e escrita na ordem original
+	WorkQueue jobs;			//Jogos lidos aguardando analise
+	WorkQueue done;			//Jogos anotados aguardando escrita
+	Annotation** pending;		//Jogos anotados fora de ordem, indexados por sequencia modulo window
+	int window;			//Numero maximo de jogos entre a leitura e a escrita: memoria constante
+	long long written;		//Jogos escritos
+	pthread_mutex_t lock;		//Exclusao mutua do avanco da escrita e dos totais
+	pthread_cond_t cond;		//Sinaliza avanco da escrita
+	FILE* out;			//Saida PGN
+	int max_depth;			//Limites da busca de cada meio-turno
+	long long max_nodes;
+	long long max_time;
+	size_t hash;			//Tabela de transposicao de cada thread, em MB
+	Cache* cache;			//Cache de analise persistente que recebe a analise de cada posicao, NULL se nao usado
+	long long games;		//Totais
+	long long plies;
+	long long nodes;
+	long long errors;
+	long long nags[3];		//Imprecisoes, erros e erros graves
+};
+
+struct index_reader {			//Leitura de uma sequencia ordenada na intercalacao do indice de aberturas
+	FILE* file;
+	ExplorerEntry* buf;		//Entradas lidas, INDEX_READ no maximo
+	size_t i;			//Proxima entrada
+	size_t n;
+};
+
+/*Inicializa uma fila limitada de tarefas.
+	Parametros
+		WorkQueue* q	fila
+		int m		capacidade
+*/
+void initialize_queue(WorkQueue* q, int m);
+
+/*Desaloca uma fila de tarefas.
+	Parametros
+		WorkQueue* q	fila
+*/
+void finalize_queue(WorkQueue* q);
+
+/*Insere um item no fim da fila.
+	Parametros
+		WorkQueue* q	fila
+		void* item	item
+		boolean wait	aguarda espaco se a fila estiver cheia
+	Retorno
+		TRUE se inserido, FALSE se a fila esta cheia (sem espera) ou fechada
+*/
+boolean push_queue(WorkQueue* q, void* item, boolean wait);
+
+/*Remove o item do inicio da fila.
+	Parametros
+		WorkQueue* q	fila
+		boolean wait	aguarda um item se a fila estiver vazia
+	Retorno
+		item, NULL se a fila esta vazia (sem espera) ou fechada e vazia
+*/
+void* pop_queue(WorkQueue* q, boolean wait);
+
+/*Fecha uma fila, liberando as threads em espera.
+	Parametros
+		WorkQueue* q	fila
+*/
+void close_queue(WorkQueue* q);
+
+/*Le o proximo elemento de um arquivo PGN.
+	Parametros
+		Pgn* pgn		leitura
+		PgnToken* tok		recipiente para o elemento
+	Retorno
+		tipo do elemento
+*/
+Pgntype next_pgn(Pgn* pgn, PgnToken* tok);
+
+/*Separa o nome e o valor de um cabecalho PGN, sem copia.
+	Parametros
+		PgnToken* tok		elemento PGN_TAG
+		PgnToken* name		recipiente para o nome
+		PgnToken* value		recipiente para o valor, sem aspas
+*/
+void tag_pgn(PgnToken* tok, PgnToken* name, PgnToken* value);
+
+/*Le e reproduz o proximo jogo de um arquivo PGN. Variantes, comentarios e anotacoes sao ignorados.
+	Parametros
+		Pgn* pgn	leitura
+	Retorno
+		TRUE se um jogo foi lido, FALSE no fim do trecho
+*/
+boolean game_pgn(Pgn* pgn);
+
+/*Grava as posicoes dos jogos concluidos de uma sequencia do indice de aberturas, ordenadas e somadas, num arquivo
+temporario. Se a soma reduz as posicoes a metade da memoria ou menos, elas sao mantidas em memoria.
+	Parametros
+		IndexRun* run	sequencia
+		boolean all	grava mesmo que a soma reduza as posicoes (fim da leitura)
+*/
+void spill_index(IndexRun* run, boolean all);
+
+/*Cria um arquivo para escrita bufferizada compartilhada entre threads.
+	Parametros
+		Writer* w		recipiente
+		const char* path	caminho
+		size_t buffer		tamanho do buffer em bytes
+		long long sync		bytes entre cada fsync, 0 para nenhum
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de erro
+*/
+boolean open_writer(Writer* w, const char* path, size_t buffer, long long sync);
+
+/*Acrescenta dados ao buffer, escrevendo-o no arquivo quando cheio. Os dados de uma chamada ficam contiguos no arquivo.
+	Parametros
+		Writer* w		escrita
+		const void* data	dados
+		size_t n		tamanho em bytes
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de erro
+*/
+boolean write_writer(Writer* w, const void* data, size_t n);
+
+/*Escreve o restante do buffer, sincroniza e fecha o arquivo.
+	Parametros
+		Writer* w		escrita
+	Retorno
+		TRUE se todos os dados foram gravados, FALSE em caso de erro
+*/
+boolean close_writer(Writer* w);
+
+/*Inicializa um filtro de Bloom.
+	Parametros
+		Bloom* bloom	filtro
+		size_t mb	tamanho em MB, arredondado para uma potencia de 2
+*/
+void initialize_bloom(Bloom* bloom, size_t mb);
+
+/*Desaloca um filtro de Bloom.
+	Parametros
+		Bloom* bloom	filtro
+*/
+void finalize_bloom(Bloom* bloom);
+
+/*Insere uma chave num filtro de Bloom. Pode ser chamada por varias threads ao mesmo tempo.
+	Parametros
+		Bloom* bloom	filtro
+		uint64_t key	chave
+	Retorno
+		TRUE se a chave e nova, FALSE se provavelmente ja foi inserida
+*/
+boolean insert_bloom(Bloom* bloom, uint64_t key);
+
+/*Funcao da thread de busca do protocolo UCI: busca e informa o melhor movimento.
+	Parametros
+		void* arg	registro Uci
+	Retorno
+		NULL
+*/
+static void* thread_uci(void* arg) {
+	Uci* uci;
+	char str[6];
+	struct timespec t;
+	State st;
+
+	uci = (Uci*) arg;
+	t.tv_sec = 0;
+	t.tv_nsec = 1000000;
+	if(uci->use_mcts) {
+		getState_chess(uci->chess, &st);
+		if(search_mcts(&uci->mcts, &st))
+			uci->search.best = uci->mcts.best;
+		else
+			uci->search.best.file = -1;
+	}
+	else if(!iterate_search(&uci->search))
+		uci->search.best.file = -1;
+	while(uci->search.infinite && !uci->search.stop)	//go infinite: bestmove somente apos stop
+		nanosleep(&t, NULL);
+	if(uci->search.best.file < 0)
+		fprintf(uci->out, "bestmove 0000\n");
+	else
+		fprintf(uci->out, "bestmove %s\n", str_move(&uci->search.best, str));
+	fflush(uci->out);
+	return NULL;
+}
+
+/*Interrompe a busca em andamento e aguarda o fim da thread.
+	Parametros
+		Uci* uci	registro Uci
+*/
+static void stop_uci(Uci* uci) {
+	if(!uci->searching)
+		return;
+	uci->search.stop = TRUE;
+	uci->mcts.stop = TRUE;
+	pthread_join(uci->thread, NULL);
+	uci->searching = FALSE;
+}
+
+/*Comando position: define a posicao a partir de startpos ou de um FEN e aplica os movimentos.
+	Parametros
+		Uci* uci	registro Uci
+		char* args	argumentos do comando
+*/
+static void position_uci(Uci* uci, char* args) {
+	static const char* fields[] = {"w", "-", "-", "0", "1"};	//Campos padrao de um FEN incompleto
+	char fen[128];
+	char* tok;
+	char* save;
+	int n;
+	Piece* piece;
+	Position dest;
+
+	tok = strtok_r(args, " \t", &save);
+	if(tok == NULL)
+		return;
+	if(!strcmp(tok, "startpos")) {
+		strcpy(fen, START_FEN);
+		tok = strtok_r(NULL, " \t", &save);
+	}
+	else {
+		if(strcmp(tok, "fen"))
+			return;
+		fen[0] = '\0';
+		for(n=0; (tok = strtok_r(NULL, " \t", &save)) != NULL && strcmp(tok, "moves"); n++) {
+			if(n >= 6 || strlen(fen)+strlen(tok)+2 > sizeof(fen))
+				return;
+			if(n)
+				strcat(fen, " ");
+			strcat(fen, tok);
+		}
+		for(; n<6 && n; n++) {
+			strcat(fen, " ");
+			strcat(fen, fields[n-1]);
+		}
+		if(!n)
+			return;
+	}
+
+	if(uci->chess != NULL)
+		finalize_chess(uci->chess);
+	uci->search.n_keys = 0;
+	if(NULL == (uci->chess = initialize_chess(fen)))	//FEN invalido: nenhuma posicao
+		return;
+	if(tok != NULL && !strcmp(tok, "moves"))
+		while((tok = strtok_r(NULL, " \t", &save)) != NULL) {
+			if(!parseMove_chess(uci->chess, tok, &piece, &dest))
+				break;
+			if(uci->search.n_keys >= uci->m_keys) {
+				uci->m_keys = 2*uci->m_keys + 16;
+				uci->keys = (uint64_t*) realloc(uci->keys, uci->m_keys*sizeof(uint64_t));
+			}
+			uci->keys[uci->search.n_keys++] = key_chess(uci->chess);
+			makeMove_chess(uci->chess, piece, &dest);
+		}
+	uci->search.keys = uci->keys;
+}
+
+/*Comando go: define os limites e inicia a busca numa thread.
+	Parametros
+		Uci* uci	registro Uci
+		char* args	argumentos do comando
+*/
+static void go_uci(Uci* uci, char* args) {
+	char* tok;
+	char* val;
+	char* save;
+	char startpos[] = "startpos";
+	long long v, time[2], inc[2], movetime, movestogo;
+	Search* s;
+
+	if(uci->chess == NULL)
+		position_uci(uci, startpos);
+	s = &uci->search;
+	s->chess = uci->chess;
+	s->tt = &uci->tt;
+	s->stop = FALSE;
+	s->infinite = FALSE;
+	s->max_depth = MAX_PLY;
+	s->max_nodes = -1;
+	s->max_time = -1;
+	s->out = uci->out;
+	time[0] = time[1] = -1;
+	inc[0] = inc[1] = 0;
+	movetime = -1;
+	movestogo = 0;
+
+	for(tok = strtok_r(args, " \t", &save); tok != NULL; tok = strtok_r(NULL, " \t", &save)) {
+		if(!strcmp(tok, "infinite")) {
+			s->infinite = TRUE;
+			continue;
+		}
+		if(strcmp(tok, "depth") && strcmp(tok, "nodes") && strcmp(tok, "movetime") && strcmp(tok, "wtime") && strcmp(tok, "btime") && strcmp(tok, "winc") && strcmp(tok, "binc") && strcmp(tok, "movestogo"))
+			continue;			//ponder, searchmoves e demais argumentos sao ignorados
+		val = strtok_r(NULL, " \t", &save);
+		if(val == NULL)
+			break;
+		v = atoll(val);
+		if(!strcmp(tok, "depth"))
+			s->max_depth = v > 0 ? v : 1;
+		else if(!strcmp(tok, "nodes"))
+			s->max_nodes = v;
+		else if(!strcmp(tok, "movetime"))
+			movetime = v;
+		else if(!strcmp(tok, "wtime"))
+			time[0] = v;
+		else if(!strcmp(tok, "btime"))
+			time[1] = v;
+		else if(!strcmp(tok, "winc"))
+			inc[0] = v;
+		else if(!strcmp(tok, "binc"))
+			inc[1] = v;
+		else
+			movestogo = v;
+	}
+
+	if(!s->infinite) {
+		if(movetime >= 0)
+			s->max_time = movetime;
+		else
+			if(time[(int) uci->chess->turn] >= 0) {	//Controle de tempo: fracao do tempo restante mais o incremento
+				v = time[(int) uci->chess->turn];
+				s->max_time = v/(movestogo > 0 ? movestogo+1 : 30) + inc[(int) uci->chess->turn]*3/4;
+				if(s->max_time > v-50)
+					s->max_time = v > 100 ? v-50 : v/2;
+			}
+	}
+
+	uci->mcts.stop = FALSE;			//A busca em arvore usa os limites de nos (playouts) e de tempo; depth e ignorado
+	uci->mcts.max_playouts = s->infinite ? -1 : s->max_nodes;
+	uci->mcts.max_time = s->infinite ? -1 : s->max_time;
+	uci->mcts.keys = uci->keys;
+	uci->mcts.n_keys = s->n_keys;
+	uci->mcts.out = uci->out;
+	uci->searching = TRUE;
+	pthread_create(&uci->thread, NULL, thread_uci, uci);
+}
+
+/*Comando setoption: opcoes Hash, Clear Hash, MultiPV, Engine (alphabeta ou mcts), Threads e Tree Memory (da busca
+em arvore Monte Carlo).
+	Parametros
+		Uci* uci	registro Uci
+		char* args	argumentos do comando
+*/
+static void setoption_uci(Uci* uci, char* args) {
+	char* name;
+	char* value;
+	int threads;
+
+	name = strstr(args, "name ");
+	if(name == NULL)
+		return;
+	name += 5;
+	threads = uci->mcts.threads;
+	value = strstr(name, " value ");
+	if(value != NULL) {
+		*value = '\0';
+		value += 7;
+	}
+	if(!strcmp(name, "Hash") && value != NULL && atoi(value) > 0) {
+		finalize_ttable(&uci->tt);
+		initialize_ttable(&uci->tt, atoi(value));
+	}
+	else if(!strcmp(name, "Clear Hash"))
+		clear_ttable(&uci->tt);
+	else if(!strcmp(name, "MultiPV") && value != NULL)		//Uma variante: busca comum
+		uci->search.multipv = atoi(value) > 1 ? (atoi(value) < MAX_MULTIPV ? atoi(value) : MAX_MULTIPV) : 0;
+	else if(!strcmp(name, "Engine") && value != NULL)
+		uci->use_mcts = !strcmp(value, "mcts");
+	else if(!strcmp(name, "Threads") && value != NULL)
+		uci->mcts.threads = atoi(value) > 1 ? atoi(value) : 1;
+	else if(!strcmp(name, "Tree Memory") && value != NULL && atoi(value) > 0) {
+		finalize_mcts(&uci->mcts);
+		initialize_mcts(&uci->mcts, atoi(value));
+		uci->mcts.threads = threads;
+	}
+}
+
+void loop_uci(FILE* in, FILE* out) {
+	char* line;
+	char* cmd;
+	char* args;
+	char stats[STATS_SIZE];
+	size_t b;
+	ssize_t n;
+	Uci* uci;
+
+	uci = (Uci*) calloc(1, sizeof(Uci));
+	uci->out = out;
+	initialize_ttable(&uci->tt, TT_MB);
+	initialize_mcts(&uci->mcts, MCTS_MB);
+	line = NULL;
+	b = 0;
+	cmd = "uci";			//O comando uci ja foi lido por main
+	args = "";
+	do {
+		if(!strcmp(cmd, "uci")) {
+			fprintf(out, "id name chess\nid author lucas0201\n");
+			fprintf(out, "option name Hash type spin default %d min 1 max 4096\n", TT_MB);
+			fprintf(out, "option name Clear Hash type button\n");
+			fprintf(out, "option name MultiPV type spin default 1 min 1 max %d\n", MAX_MULTIPV);
+			fprintf(out, "option name Engine type combo default alphabeta var alphabeta var mcts\n");
+			fprintf(out, "option name Threads type spin default 1 min 1 max 256\n");
+			fprintf(out, "option name Tree Memory type spin default %d min 1 max 65536\nuciok\n", MCTS_MB);
+		}
+		else if(!strcmp(cmd, "isready"))
+			fprintf(out, "readyok\n");
+		else if(!strcmp(cmd, "ucinewgame")) {
+			stop_uci(uci);
+			clear_ttable(&uci->tt);
+		}
+		else if(!strcmp(cmd, "position")) {
+			stop_uci(uci);
+			position_uci(uci, args);
+		}
+		else if(!strcmp(cmd, "go")) {
+			stop_uci(uci);
+			go_uci(uci, args);
+		}
+		else if(!strcmp(cmd, "stop"))
+			stop_uci(uci);
+		else if(!strcmp(cmd, "setoption")) {
+			stop_uci(uci);
+			setoption_uci(uci, args);
+		}
+		else if(!strcmp(cmd, "stats")) {	//Extensao: contadores de instrumentacao e latencias
+			fprintf(out, "info string stats %s\n", str_stats(stats));
+			print_latency(out, "info string latency ");
+		}
+		else if(!strcmp(cmd, "quit"))
+			break;
+		fflush(out);
+
+		if(-1 == (n = getline(&line, &b, in)))	//Proximo comando
+			break;
+		while(n && isspace(line[n-1]))
+			line[--n] = '\0';
+		for(cmd = line; isspace(*cmd); cmd++);
+		for(args = cmd; *args && !isspace(*args); args++);
+		if(*args)
+			*args++ = '\0';
+	} while(TRUE);
+
+	stop_uci(uci);
+	free(line);
+	if(uci->chess != NULL)
+		finalize_chess(uci->chess);
+	finalize_ttable(&uci->tt);
+	finalize_mcts(&uci->mcts);
+	free(uci->keys);
+	free(uci);
+}
+
+/*Escreve o resultado de uma posicao. No modo ordenado o resultado aguarda ate que os anteriores sejam escritos.
+	Parametros
+		Batch* batch	registro Batch
+		long long seq	numero de sequencia da linha
+		char* res	resultado alocado, "" para nenhuma saida
+*/
+static void emit_batch(Batch* batch, long long seq, char* res) {
+	char* aux;
+	pthread_mutex_lock(&batch->out_lock);
+	if(!batch->ordered) {
+		if(*res)
+			fputs(res, batch->out);
+		free(res);
+		pthread_mutex_unlock(&batch->out_lock);
+		return;
+	}
+	while(seq >= batch->next_out + batch->window)		//Janela cheia: aguarda as linhas anteriores
+		pthread_cond_wait(&batch->out_cond, &batch->out_lock);
+	batch->pending[seq % batch->window] = res;
+	while((aux = batch->pending[batch->next_out % batch->window]) != NULL) {
+		if(*aux)
+			fputs(aux, batch->out);
+		free(aux);
+		batch->pending[batch->next_out++ % batch->window] = NULL;
+	}
+	pthread_cond_broadcast(&batch->out_cond);
+	pthread_mutex_unlock(&batch->out_lock);
+}
+
+/*Le a proxima linha da entrada de uma analise em lote. Linhas vazias sao escritas (como nenhuma saida) e puladas.
+	Parametros
+		Batch* batch	registro Batch
+		char** line	recipiente da linha, realocado por getline
+		size_t* b	tamanho do recipiente
+		long long* seq	recipiente para o numero de sequencia da linha
+	Retorno
+		TRUE se ha uma linha, sem o \n, FALSE no fim da entrada
+*/
+static boolean read_batch(Batch* batch, char** line, size_t* b, long long* seq) {
+	ssize_t n;
+	while(TRUE) {
+		pthread_mutex_lock(&batch->in_lock);		//Proxima linha
+		n = getline(line, b, batch->in);
+		*seq = batch->next_in++;
+		pthread_mutex_unlock(&batch->in_lock);
+		if(n == -1)
+			return FALSE;
+		for(n=0; isspace((*line)[n]); n++);
+		if((*line)[n]) {
+			(*line)[strcspn(*line, "\r\n")] = '\0';
+			return TRUE;
+		}
+		emit_batch(batch, *seq, strdup(""));		//Linha vazia
+	}
+}
+
+/*Funcao das threads de analise em lote: le, analisa e escreve posicoes ate o fim da entrada.
+	Parametros
+		void* arg	registro Batch
+	Retorno
+		NULL
+*/
+static void* thread_batch(void* arg) {
+	Batch* batch;
+	Search* s;
+	TTable tt;
+	Chess chess;
+	Arena arena;
+	char* line;
+	char fen[128];
+	char res[256];
+	char move[6];
+	char score[20];
+	size_t b;
+	long long seq, positions, nodes;
+
+	batch = (Batch*) arg;
+	s = (Search*) calloc(1, sizeof(Search));
+	initialize_arena(&arena);
+	initialize_ttable(&tt, batch->hash);
+	s->tt = &tt;
+	s->cache = batch->cache;
+	line = NULL;
+	b = 0;
+	positions = nodes = 0;
+	while(read_batch(batch, &line, &b, &seq)) {
+		if(!epdToFen(line, fen, sizeof(fen)) || !load_chess(&chess, fen, &arena)) {
+			snprintf(res, sizeof(res), "%.200s error invalid position\n", line);
+			emit_batch(batch, seq, strdup(res));
+			continue;
+		}
+
+		s->chess = &chess;
+		s->stop = FALSE;
+		s->infinite = FALSE;
+		s->max_depth = batch->max_depth;
+		s->max_nodes = batch->max_nodes;
+		s->max_time = batch->max_time;
+		s->n_keys = 0;
+		s->out = NULL;
+		if(iterate_search(s))
+			snprintf(res, sizeof(res), "%s bestmove %s score %s depth %d nodes %lld time %lld\n", fen, str_move(&s->best, move), str_score(s->score, score), s->depth, s->nodes, elapsed_search(s));
+		else
+			snprintf(res, sizeof(res), "%s bestmove 0000 score %s\n", fen, incheck_chess(&chess) ? "mate 0" : "cp 0");
+		clear_chess(&chess);
+		positions++;
+		nodes += s->nodes;
+		emit_batch(batch, seq, strdup(res));
+	}
+
+	pthread_mutex_lock(&batch->out_lock);
+	batch->positions += positions;
+	batch->nodes += nodes;
+	pthread_mutex_unlock(&batch->out_lock);
+	free(line);
+	free(s);
+	finalize_ttable(&tt);
+	finalize_arena(&arena);
+	flush_stats();
+	return NULL;
+}
+
+/*Executa uma analise em lote: threads de uma mesma funcao sobre a entrada, depois o resumo na saida de erro.
+	Parametros
+		Batch* batch		registro Batch, com entrada, saida e limites definidos
+		int threads		numero de threads
+		void* (*fn)(void*)	funcao das threads
+	Retorno
+		tempo decorrido em s
+*/
+static double run_batch(Batch* batch, int threads, void* (*fn)(void*)) {
+	int i;
+	pthread_t* tid;
+	struct timespec start, end;
+	double t;
+
+	batch->window = 64*threads;
+	batch->pending = (char**) calloc(batch->window, sizeof(char*));
+	pthread_mutex_init(&batch->in_lock, NULL);
+	pthread_mutex_init(&batch->out_lock, NULL);
+	pthread_cond_init(&batch->out_cond, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	for(i=0; i<threads; i++)
+		pthread_create(&tid[i], NULL, fn, batch);
+	for(i=0; i<threads; i++)
+		pthread_join(tid[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	fflush(batch->out);
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	fprintf(stderr, "%lld posicoes, %lld nos, %.3f s, %.1f posicoes/s, %.0f nos/s, %d threads\n", batch->positions, batch->nodes, t, batch->positions/(t > 0 ? t : 1), batch->nodes/(t > 0 ? t : 1), threads);
+
+	if(batch->in != stdin)
+		fclose(batch->in);
+	free(tid);
+	free(batch->pending);
+	pthread_mutex_destroy(&batch->in_lock);
+	pthread_mutex_destroy(&batch->out_lock);
+	pthread_cond_destroy(&batch->out_cond);
+	return t;
+}
+
+int main_batch(int argc, char** argv) {
+	int c, threads;
+	Batch batch;
+	Cache cache;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memset(&batch, 0, sizeof(Batch));
+	batch.in = stdin;
+	batch.out = stdout;
+	batch.max_depth = 4;
+	batch.max_nodes = -1;
+	batch.max_time = -1;
+	batch.hash = 4;
+	while((c = getopt(argc, argv, "t:d:n:m:H:c:o")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'd': batch.max_depth = atoi(optarg);
+				  break;
+			case 'n': batch.max_nodes = atoll(optarg);
+				  break;
+			case 'm': batch.max_time = atoll(optarg);
+				  break;
+			case 'H': batch.hash = atoi(optarg);
+				  break;
+			case 'c': if(!open_cache(&cache, optarg, CACHE_MB)) {	//Cache de analise, criado se nao existe
+					perror(optarg);
+					return 1;
+				  }
+				  batch.cache = &cache;
+				  break;
+			case 'o': batch.ordered = TRUE;
+				  break;
+			default: fprintf(stderr, "Uso: %s [-t threads] [-d depth] [-n nodes] [-m movetime] [-H hash] [-c cache] [-o] [arquivo]\n", argv[0]);
+				 return 1;
+		}
+	if(optind < argc && NULL == (batch.in = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	if(batch.max_depth < 1 || batch.max_depth >= MAX_PLY)
+		batch.max_depth = MAX_PLY-1;
+	if(batch.hash < 1)
+		batch.hash = 1;
+
+	run_batch(&batch, threads, thread_batch);
+	if(batch.cache != NULL)
+		close_cache(batch.cache);
+	return 0;
+}
+
+/*Funcao das threads da busca de mate em lote: le, resolve e escreve posicoes ate o fim da entrada. Uma operacao
+EPD dm (mate direto) define o numero de lances da posicao.
+	Parametros
+		void* arg	registro Batch
+	Retorno
+		NULL
+*/
+static void* thread_mate(void* arg) {
+	Batch* batch;
+	Mate m;
+	Fen f;
+	State st;
+	char* line;
+	char dm[16];
+	char fen[128];
+	char res[PV_SIZE+256];
+	size_t b, k;
+	int i, n, moves;
+	long long seq, positions, nodes, mates, unknown, t;
+
+	batch = (Batch*) arg;
+	initialize_mate(&m, batch->hash);
+	line = NULL;
+	b = 0;
+	positions = nodes = mates = unknown = 0;
+	while(read_batch(batch, &line, &b, &seq)) {
+		if(!epdToFen(line, fen, sizeof(fen)) || !parseFen(fen, &f) || !validFen(&f)) {
+			snprintf(res, sizeof(res), "%.200s error invalid position\n", line);
+			emit_batch(batch, seq, strdup(res));
+			continue;
+		}
+		moves = batch->max_depth;
+		if(epdOperand(line, "dm", dm, sizeof(dm)) && atoi(dm) > 0)	//Mate direto da posicao
+			moves = atoi(dm) < MAX_PLY/2 ? atoi(dm) : MAX_PLY/2;
+
+		loadFen_state(&st, &f);
+		m.max_nodes = batch->max_nodes;
+		t = clock_ns();
+		n = solve_mate(&m, &st, moves);
+		t = (clock_ns() - t)/1000000;
+		if(n > 0) {
+			k = snprintf(res, sizeof(res), "%s mate %d pv", fen, n);
+			for(i=0; i<m.pv_len; i++) {
+				res[k++] = ' ';
+				k += strlen(str_move(&m.pv[i], res+k));
+			}
+		}
+		else
+			k = snprintf(res, sizeof(res), "%s %s %d", fen, n ? "unknown" : "nomate", moves);
+		snprintf(res+k, sizeof(res)-k, " nodes %lld time %lld\n", m.nodes, t);
+		positions++;
+		nodes += m.nodes;
+		mates += n > 0;
+		unknown += n < 0;
+		emit_batch(batch, seq, strdup(res));
+	}
+
+	pthread_mutex_lock(&batch->out_lock);
+	batch->positions += positions;
+	batch->nodes += nodes;
+	batch->mates += mates;
+	batch->unknown += unknown;
+	pthread_mutex_unlock(&batch->out_lock);
+	free(line);
+	finalize_mate(&m);
+	flush_stats();
+	return NULL;
+}
+
+/*Verifica se um movimento resolve uma posicao de uma suite EPD: esta entre os melhores movimentos (bm) e nao
+esta entre os movimentos a evitar (am). Os movimentos sao em SAN ou em notacao algebrica simplificada.
+	Parametros
+		const State* st		posicao
+		const char* bm		movimentos da operacao bm separados por espaco, NULL se ausente
+		const char* am		movimentos da operacao am separados por espaco, NULL se ausente
+		const Move* move	movimento escolhido
+	Retorno
+		1 se resolve, 0 se nao resolve, -1 se a posicao nao tem solucao reconhecida
+*/
+static int solve_suite(const State* st, const char* bm, const char* am, const Move* move) {
+	int k, n, found[2];
+	const char* ops[2];
+	const char* p;
+	char buf[MOVE_SIZE];
+	Move aux;
+
+	ops[0] = bm;
+	ops[1] = am;
+	for(k=0; k<2; k++) {
+		found[k] = -1;				//Nenhum movimento reconhecido
+		for(p = ops[k]; p != NULL && *p; p += n) {
+			for(; isspace(*p) || *p == ','; p++);
+			for(n=0; p[n] && !isspace(p[n]) && p[n] != ','; n++);
+			if(!n)
+				break;
+			if(!parseSan_state(st, p, n, &aux)) {
+				if(n >= MOVE_SIZE)
+					continue;
+				memcpy(buf, p, n);
+				buf[n] = '\0';
+				if(!parseMove_state(st, buf, &aux))
+					continue;
+			}
+			if(found[k] < 0)
+				found[k] = 0;
+			if(code_move(&aux) == code_move(move))
+				found[k] = 1;
+		}
+	}
+	if(found[0] < 0 && found[1] < 0)
+		return -1;
+	return found[0] != 0 && found[1] != 1;
+}
+
+/*Funcao das threads da suite EPD: le, analisa e avalia posicoes ate o fim da entrada.
+	Parametros
+		void* arg	registro Batch
+	Retorno
+		NULL
+*/
+static void* thread_suite(void* arg) {
+	static const char* status[3] = {"unscored", "failed", "solved"};
+	Batch* batch;
+	Search* s;
+	TTable tt;
+	Chess chess;
+	Arena arena;
+	Fen f;
+	State st;
+	char* line;
+	char fen[128];
+	char id[64];
+	char bm[128];
+	char am[128];
+	char res[512];
+	char move[6];
+	char score[20];
+	size_t b;
+	int k, solved;
+	long long seq, positions, nodes, n_solved, scored;
+
+	batch = (Batch*) arg;
+	s = (Search*) calloc(1, sizeof(Search));
+	initialize_arena(&arena);
+	initialize_ttable(&tt, batch->hash);
+	s->tt = &tt;
+	line = NULL;
+	b = 0;
+	positions = nodes = n_solved = scored = 0;
+	while(read_batch(batch, &line, &b, &seq)) {
+		if(!epdOperand(line, "id", id, sizeof(id)))
+			snprintf(id, sizeof(id), "%lld", seq+1);	//Sem id: numero da linha
+		if(!epdToFen(line, fen, sizeof(fen)) || !parseFen(fen, &f) || !validFen(&f) || !load_chess(&chess, fen, &arena)) {
+			snprintf(res, sizeof(res), "%.63s error invalid position\n", id);
+			emit_batch(batch, seq, strdup(res));
+			continue;
+		}
+		loadFen_state(&st, &f);
+
+		clear_ttable(&tt);				//Posicoes independentes: tempos comparaveis entre execucoes
+		s->chess = &chess;
+		s->stop = FALSE;
+		s->infinite = FALSE;
+		s->max_depth = batch->max_depth;
+		s->max_nodes = batch->max_nodes;
+		s->max_time = batch->max_time;
+		s->n_keys = 0;
+		s->out = NULL;
+		solved = -1;
+		if(iterate_search(s))
+			solved = solve_suite(&st, epdOperand(line, "bm", bm, sizeof(bm)) ? bm : NULL, epdOperand(line, "am", am, sizeof(am)) ? am : NULL, &s->best);
+		else
+			s->best.file = -1;
+		k = snprintf(res, sizeof(res), "%.63s %s bestmove %s score %s depth %d nodes %lld time %lld", id, status[solved+1],
+			     s->best.file < 0 ? "0000" : str_move(&s->best, move), str_score(s->score, score), s->depth, s->nodes, elapsed_search(s));
+		if(solved == 1) {				//Iteracao em que a solucao apareceu e nao mudou mais
+			k += snprintf(res+k, sizeof(res)-k, " solvedepth %d solvenodes %lld solvetime %lld", s->change_depth, s->change_nodes, s->change_time);
+			record_histogram(&batch->solve_time, s->change_time*1000000);
+		}
+		snprintf(res+k, sizeof(res)-k, "\n");
+		clear_chess(&chess);
+		positions++;
+		nodes += s->nodes;
+		n_solved += solved == 1;
+		scored += solved >= 0;
+		emit_batch(batch, seq, strdup(res));
+	}
+
+	pthread_mutex_lock(&batch->out_lock);
+	batch->positions += positions;
+	batch->nodes += nodes;
+	batch->solved += n_solved;
+	batch->scored += scored;
+	pthread_mutex_unlock(&batch->out_lock);
+	free(line);
+	free(s);
+	finalize_ttable(&tt);
+	finalize_arena(&arena);
+	flush_stats();
+	return NULL;
+}
+
+int main_suite(int argc, char** argv) {
+	int c, threads;
+	Batch batch;
+	Histogram* h;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memset(&batch, 0, sizeof(Batch));
+	batch.in = stdin;
+	batch.out = stdout;
+	batch.max_depth = MAX_PLY-1;
+	batch.max_nodes = -1;
+	batch.max_time = -1;
+	batch.hash = TT_MB;
+	while((c = getopt(argc, argv, "t:d:n:m:H:o")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'd': batch.max_depth = atoi(optarg);
+				  break;
+			case 'n': batch.max_nodes = atoll(optarg);
+				  break;
+			case 'm': batch.max_time = atoll(optarg);
+				  break;
+			case 'H': batch.hash = atoi(optarg);
+				  break;
+			case 'o': batch.ordered = TRUE;
+				  break;
+			default: fprintf(stderr, "Uso: %s [-t threads] [-d depth] [-n nodes] [-m movetime] [-H hash] [-o] [arquivo]\n", argv[0]);
+				 return 1;
+		}
+	if(optind < argc && NULL == (batch.in = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	if(batch.max_depth < 1 || batch.max_depth >= MAX_PLY)
+		batch.max_depth = MAX_PLY-1;
+	if(batch.max_depth == MAX_PLY-1 && batch.max_nodes < 0 && batch.max_time < 0)	//Sem limite: 1 s por posicao
+		batch.max_time = 1000;
+	if(batch.hash < 1)
+		batch.hash = 1;
+
+	run_batch(&batch, threads, thread_suite);
+	h = &batch.solve_time;
+	fprintf(stderr, "%lld/%lld resolvidas (%.1f%%), %lld sem solucao reconhecida\n", batch.solved, batch.scored,
+		100.0*batch.solved/(batch.scored > 0 ? batch.scored : 1), batch.positions - batch.scored);
+	if(h->n)
+		fprintf(stderr, "tempo ate a solucao: p25 %lld p50 %lld p75 %lld p90 %lld max %lld ms\n", percentile_histogram(h, 25)/1000000,
+			percentile_histogram(h, 50)/1000000, percentile_histogram(h, 75)/1000000, percentile_histogram(h, 90)/1000000, h->max/1000000);
+	return 0;
+}
+
+int main_mate(int argc, char** argv) {
+	int c, threads;
+	Batch batch;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memset(&batch, 0, sizeof(Batch));
+	batch.in = stdin;
+	batch.out = stdout;
+	batch.max_depth = 3;
+	batch.max_nodes = 1000000;
+	batch.hash = MATE_MB;
+	while((c = getopt(argc, argv, "t:d:n:H:o")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'd': batch.max_depth = atoi(optarg);
+				  break;
+			case 'n': batch.max_nodes = atoll(optarg);
+				  break;
+			case 'H': batch.hash = atoi(optarg);
+				  break;
+			case 'o': batch.ordered = TRUE;
+				  break;
+			default: fprintf(stderr, "Uso: %s [-t threads] [-d lances] [-n nodes] [-H hash] [-o] [arquivo]\n", argv[0]);
+				 return 1;
+		}
+	if(optind < argc && NULL == (batch.in = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	if(batch.max_depth < 1 || batch.max_depth > MAX_PLY/2)
+		batch.max_depth = MAX_PLY/2;
+	if(batch.hash < 1)
+		batch.hash = 1;
+
+	run_batch(&batch, threads, thread_mate);
+	fprintf(stderr, "%lld mates, %lld sem mate, %lld sem prova no limite de nos\n", batch.mates, batch.positions - batch.mates - batch.unknown, batch.unknown);
+	return 0;
+}
+
+int main_mcts(int argc, char** argv) {
+	int c, threads, mb;
+	char* line;
+	char fen[128];
+	char move[6];
+	char score[20];
+	size_t b, tree;
+	long long positions, playouts, full, max_playouts, max_time;
+	double t, cpuct;
+	FILE* in;
+	Fen f;
+	State st;
+	Mcts m;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	max_playouts = -1;
+	max_time = 1000;
+	mb = MCTS_MB;
+	cpuct = MCTS_CPUCT;
+	while((c = getopt(argc, argv, "t:n:m:M:c:")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'n': max_playouts = atoll(optarg);
+				  break;
+			case 'm': max_time = atoll(optarg);
+				  break;
+			case 'M': mb = atoi(optarg);
+				  break;
+			case 'c': cpuct = atof(optarg);
+				  break;
+			default: fprintf(stderr, "Uso: %s [-t threads] [-n playouts] [-m movetime] [-M arvore] [-c cpuct] [arquivo]\n", argv[0]);
+				 return 1;
+		}
+	in = stdin;
+	if(optind < argc && NULL == (in = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	initialize_mcts(&m, mb > 0 ? mb : 1);
+	m.threads = threads > 0 ? threads : 1;
+	m.max_playouts = max_playouts;
+	m.max_time = max_time;
+	m.cpuct = cpuct;
+
+	line = NULL;
+	b = 0;
+	positions = playouts = full = 0;
+	tree = 0;
+	t = 0;
+	while(getline(&line, &b, in) != -1) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if(!*line)
+			continue;
+		if(!epdToFen(line, fen, sizeof(fen)) || !parseFen(fen, &f) || !validFen(&f)) {
+			printf("%.200s error invalid position\n", line);
+			continue;
+		}
+		loadFen_state(&st, &f);
+		m.stop = FALSE;
+		if(!search_mcts(&m, &st)) {
+			printf("%s error no move\n", fen);
+			continue;
+		}
+		printf("%s bestmove %s score %s playouts %lld pps %lld tree %zu memory %zu time %lld\n", fen, str_move(&m.best, move), str_score(m.score, score),
+			m.playouts, m.playouts*1000/(m.time ? m.time : 1), m.n, m.n*sizeof(MctsNode)/1024, m.time);
+		fflush(stdout);
+		positions++;
+		playouts += m.playouts;
+		full += m.full;
+		t += m.time/1000.0;
+		if(m.n > tree)
+			tree = m.n;
+	}
+	fprintf(stderr, "%lld posicoes, %lld playouts, %.3f s, %.0f playouts/s, arvore maxima %zu nos (%.1f MB), %d threads\n", positions, playouts, t, playouts/(t > 0 ? t : 1),
+		tree, tree*sizeof(MctsNode)/(1024.0*1024), m.threads);
+	if(full)
+		fprintf(stderr, "%lld buscas interrompidas por falta de nos (-M)\n", full);
+	if(in != stdin)
+		fclose(in);
+	free(line);
+	finalize_mcts(&m);
+	return 0;
+}
+
+void initialize_queue(WorkQueue* q, int m) {
+	q->item = (void**) malloc(m*sizeof(void*));
+	q->m = m;
+	q->head = q->n = 0;
+	q->closed = FALSE;
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->not_empty, NULL);
+	pthread_cond_init(&q->not_full, NULL);
+}
+
+void finalize_queue(WorkQueue* q) {
+	free(q->item);
+	pthread_mutex_destroy(&q->lock);
+	pthread_cond_destroy(&q->not_empty);
+	pthread_cond_destroy(&q->not_full);
+}
+
+boolean push_queue(WorkQueue* q, void* item, boolean wait) {
+	pthread_mutex_lock(&q->lock);
+	while(wait && !q->closed && q->n == q->m)
+		pthread_cond_wait(&q->not_full, &q->lock);
+	if(q->closed || q->n == q->m) {
+		pthread_mutex_unlock(&q->lock);
+		return FALSE;
+	}
+	q->item[(q->head + q->n++) % q->m] = item;
+	pthread_cond_signal(&q->not_empty);
+	pthread_mutex_unlock(&q->lock);
+	return TRUE;
+}
+
+void* pop_queue(WorkQueue* q, boolean wait) {
+	void* item;
+	pthread_mutex_lock(&q->lock);
+	while(wait && !q->closed && !q->n)
+		pthread_cond_wait(&q->not_empty, &q->lock);
+	if(!q->n) {
+		pthread_mutex_unlock(&q->lock);
+		return NULL;
+	}
+	item = q->item[q->head];
+	q->head = (q->head+1) % q->m;
+	q->n--;
+	pthread_cond_signal(&q->not_full);
+	pthread_mutex_unlock(&q->lock);
+	return item;
+}
+
+void close_queue(WorkQueue* q) {
+	pthread_mutex_lock(&q->lock);
+	q->closed = TRUE;
+	pthread_cond_broadcast(&q->not_empty);
+	pthread_cond_broadcast(&q->not_full);
+	pthread_mutex_unlock(&q->lock);
+}
+
+static volatile sig_atomic_t server_quit = FALSE;	//Sinal de encerramento do servidor
+
+/*Tratador de SIGINT e SIGTERM: encerra o laco de eventos.
+	Parametros
+		int sig		sinal
+*/
+static void signal_server(int sig) {
+	(void) sig;
+	server_quit = TRUE;
+}
+
+/*Atualiza os eventos monitorados de uma sessao: leitura enquanto houver espaco no buffer, escrita enquanto houver dados pendentes.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void events_session(Server* server, Session* session) {
+	struct epoll_event ev;
+	ev.events = (session->n_in < (int) sizeof(session->in) ? EPOLLIN | EPOLLRDHUP : 0) | (session->n_out ? EPOLLOUT : 0);
+	ev.data.u64 = session->id;
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, session->fd, &ev);
+}
+
+/*Envia dados a um cliente. O que nao puder ser escrito de imediato fica no buffer da sessao, aguardando EPOLLOUT.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+		const char* fmt		formato (printf), NULL para somente esvaziar o buffer
+*/
+static void send_session(Server* server, Session* session, const char* fmt, ...) {
+	va_list ap;
+	int n;
+	ssize_t w;
+
+	if(fmt != NULL) {
+		va_start(ap, fmt);
+		n = vsnprintf(NULL, 0, fmt, ap);
+		va_end(ap);
+		if(session->n_out + n + 1 > session->m_out) {
+			session->m_out = 2*(session->n_out + n + 1);
+			session->out = (char*) realloc(session->out, session->m_out);
+		}
+		va_start(ap, fmt);
+		vsnprintf(session->out + session->n_out, n+1, fmt, ap);
+		va_end(ap);
+		session->n_out += n;
+	}
+	if(session->closing)
+		return;
+
+	while(session->n_out && (w = write(session->fd, session->out, session->n_out)) > 0) {
+		memmove(session->out, session->out+w, session->n_out-w);
+		session->n_out -= w;
+	}
+	events_session(server, session);
+}
+
+/*Obtem uma sessao livre do pool para um novo cliente.
+	Parametros
+		Server* server	servidor
+		int fd		socket do cliente
+	Retorno
+		sessao, NULL se todas estao em uso
+*/
+static Session* acquire_session(Server* server, int fd) {
+	Session* session;
+	if(server->free == NULL)
+		return NULL;
+	session = server->free;
+	server->free = session->next;
+	server->n++;
+	session->fd = fd;
+	session->playing = session->thinking = session->closing = FALSE;
+	session->n_in = 0;
+	session->n_out = 0;
+	session->n_keys = 0;
+	session->max_depth = server->max_depth;
+	session->max_nodes = server->max_nodes;
+	session->max_time = server->max_time;
+	return session;
+}
+
+/*Encerra a partida de uma sessao.
+	Parametros
+		Session* session	sessao
+*/
+static void endGame_session(Session* session) {
+	if(session->playing)
+		clear_chess(&session->chess);
+	session->playing = FALSE;
+	session->n_keys = 0;
+}
+
+/*Devolve uma sessao ao pool. Os buffers sao mantidos para a proxima partida.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void release_session(Server* server, Session* session) {
+	endGame_session(session);
+	session->fd = -1;
+	session->next = server->free;
+	server->free = session;
+	server->n--;
+}
+
+/*Fecha a conexao de uma sessao. Se ha uma busca em andamento, a sessao so volta ao pool quando ela terminar.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void close_session(Server* server, Session* session) {
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+	close(session->fd);
+	session->closing = TRUE;
+	if(!session->thinking)
+		release_session(server, session);
+}
+
+/*Efetua um movimento na partida da sessao, informa o novo FEN e verifica o fim do jogo.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+		Piece* piece		peca
+		Position* dest		posicao destino
+*/
+static void move_session(Server* server, Session* session, Piece* piece, Position* dest) {
+	char fen[FEN_SIZE];
+	Gamesit sit;
+	Chess* chess;
+
+	chess = &session->chess;
+	if(session->n_keys+1 > session->m_keys) {		//Chave da posicao anterior (repeticao na busca)
+		session->m_keys = 2*session->n_keys + 16;
+		session->keys = (uint64_t*) realloc(session->keys, session->m_keys*sizeof(uint64_t));
+	}
+	session->keys[session->n_keys++] = key_chess(chess);
+	makeMove_chess(chess, piece, dest);
+	send_session(server, session, "fen %s\n", recordGame_chess(chess, fen));
+	if(PLAY != (sit = sit_chess(chess))) {
+		send_session(server, session, "result %s\n", str_sit(sit));
+		endGame_session(session);
+	}
+}
+
+/*Inicializa o cache de resultados do servidor.
+	Parametros
+		ResultCache* rc		cache
+		size_t mb		memoria em MB, dividida entre as particoes
+*/
+static void initialize_results(ResultCache* rc, size_t mb) {
+	size_t i, j, n;
+	ResultShard* shard;
+
+	rc->m = (mb << 20) / (sizeof(ResultEntry) + sizeof(ResultEntry*)) / RESULT_SHARDS;
+	if(rc->m < 1)
+		rc->m = 1;
+	for(n = 1; n < rc->m; n <<= 1);
+	for(i=0; i<RESULT_SHARDS; i++) {
+		shard = &rc->shard[i];
+		memset(shard, 0, sizeof(ResultShard));
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->entry = (ResultEntry*) calloc(rc->m, sizeof(ResultEntry));
+		shard->bucket = (ResultEntry**) calloc(n, sizeof(ResultEntry*));
+		shard->mask = n-1;
+		for(j=rc->m; j>0; j--) {
+			shard->entry[j-1].next = shard->free;
+			shard->free = &shard->entry[j-1];
+		}
+	}
+}
+
+/*Libera a memoria do cache de resultados.
+	Parametros
+		ResultCache* rc		cache
+*/
+static void finalize_results(ResultCache* rc) {
+	int i;
+	for(i=0; i<RESULT_SHARDS; i++) {
+		pthread_mutex_destroy(&rc->shard[i].lock);
+		free(rc->shard[i].entry);
+		free(rc->shard[i].bucket);
+	}
+}
+
+/*Mistura os bits de um inteiro de 64 bits (finalizador splitmix64).
+	Parametros
+		uint64_t x	valor
+	Retorno
+		valor misturado
+*/
+static uint64_t mix_results(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/*Chave do cache de resultados para a busca pendente de uma sessao: a posicao, as posicoes anteriores que podem
+ser repetidas (desde o ultimo lance irreversivel, em qualquer ordem) e os limites da busca.
+	Parametros
+		Session* session	sessao
+	Retorno
+		chave
+*/
+static uint64_t key_results(Session* session) {
+	int i;
+	uint64_t key, history;
+
+	history = 0;
+	for(i = session->n_keys - session->chess.mid_turns; i < session->n_keys; i++)
+		if(i >= 0)
+			history += mix_results(session->keys[i]);
+	key = key_chess(&session->chess) ^ mix_results(history + 1);
+	return key ^ mix_results((uint64_t) session->req_depth ^ mix_results((uint64_t) session->req_nodes ^ mix_results((uint64_t) session->req_time)));
+}
+
+/*Retira uma entrada concluida da lista LRU da particao.
+	Parametros
+		ResultShard* shard	particao
+		ResultEntry* e		entrada
+*/
+static void unlink_results(ResultShard* shard, ResultEntry* e) {
+	if(e->newer != NULL)
+		e->newer->older = e->older;
+	else
+		shard->newest = e->older;
+	if(e->older != NULL)
+		e->older->newer = e->newer;
+	else
+		shard->oldest = e->newer;
+	e->newer = e->older = NULL;
+}
+
+/*Insere uma entrada concluida no inicio (mais recente) da lista LRU da particao.
+	Parametros
+		ResultShard* shard	particao
+		ResultEntry* e		entrada
+*/
+static void front_results(ResultShard* shard, ResultEntry* e) {
+	e->older = shard->newest;
+	e->newer = NULL;
+	if(shard->newest != NULL)
+		shard->newest->newer = e;
+	else
+		shard->oldest = e;
+	shard->newest = e;
+}
+
+/*Descarta a entrada concluida usada ha mais tempo da particao.
+	Parametros
+		ResultShard* shard	particao
+	Retorno
+		entrada liberada, NULL se todas as entradas tem buscas em andamento
+*/
+static ResultEntry* evict_results(ResultShard* shard) {
+	ResultEntry* e;
+	ResultEntry** p;
+
+	if(NULL == (e = shard->oldest))
+		return NULL;
+	unlink_results(shard, e);
+	for(p = &shard->bucket[e->key & shard->mask]; *p != e; p = &(*p)->next);
+	*p = e->next;
+	shard->evictions++;
+	return e;
+}
+
+/*Consulta o cache de resultados antes da busca de uma sessao. Se ha uma busca identica em andamento, a sessao
+fica na entrada e recebe o resultado quando a busca for publicada; o campo time guarda o inicio da espera.
+	Parametros
+		ResultCache* rc		cache
+		uint64_t key		chave (key_results)
+		Session* session	sessao
+		ResultEntry** entry	entrada reservada, se RESULT_MISS; a busca deve ser publicada com complete_results
+	Retorno
+		RESULT_HIT, RESULT_WAIT, RESULT_MISS ou RESULT_BYPASS
+*/
+static Resulttype acquire_results(ResultCache* rc, uint64_t key, Session* session, ResultEntry** entry) {
+	ResultShard* shard;
+	ResultEntry* e;
+
+	shard = &rc->shard[(key >> 32) % RESULT_SHARDS];
+	pthread_mutex_lock(&shard->lock);
+	for(e = shard->bucket[key & shard->mask]; e != NULL && e->key != key; e = e->next);
+	if(e != NULL && e->ready) {		//Resultado pronto: passa a ser o mais recente
+		unlink_results(shard, e);
+		front_results(shard, e);
+		session->found = e->found;
+		session->best = e->best;
+		session->score = e->score;
+		session->nodes = 0;
+		session->time = 0;
+		shard->hits++;
+		pthread_mutex_unlock(&shard->lock);
+		return RESULT_HIT;
+	}
+	if(e != NULL) {				//Busca em andamento
+		session->time = clock_ns();
+		session->waiting = e->waiting;
+		e->waiting = session;
+		shard->waits++;
+		pthread_mutex_unlock(&shard->lock);
+		return RESULT_WAIT;
+	}
+	shard->misses++;
+	if(NULL != (e = shard->free))
+		shard->free = e->next;
+	else if(NULL == (e = evict_results(shard))) {
+		pthread_mutex_unlock(&shard->lock);
+		return RESULT_BYPASS;
+	}
+	e->key = key;
+	e->ready = FALSE;
+	e->waiting = NULL;
+	e->next = shard->bucket[key & shard->mask];
+	shard->bucket[key & shard->mask] = e;
+	*entry = e;
+	pthread_mutex_unlock(&shard->lock);
+	return RESULT_MISS;
+}
+
+/*Publica o resultado da busca de uma entrada reservada por acquire_results.
+	Parametros
+		ResultCache* rc		cache
+		ResultEntry* e		entrada
+		const Session* session	sessao com o resultado
+	Retorno
+		lista (campo waiting) das sessoes que aguardavam a busca, NULL se nenhuma
+*/
+static Session* complete_results(ResultCache* rc, ResultEntry* e, const Session* session) {
+	ResultShard* shard;
+	Session* waiting;
+
+	shard = &rc->shard[(e->key >> 32) % RESULT_SHARDS];
+	pthread_mutex_lock(&shard->lock);
+	e->found = session->found;
+	e->best = session->best;
+	e->score = session->score;
+	e->ready = TRUE;
+	front_results(shard, e);
+	waiting = e->waiting;
+	e->waiting = NULL;
+	pthread_mutex_unlock(&shard->lock);
+	return waiting;
+}
+
+/*Soma os totais das particoes do cache de resultados.
+	Parametros
+		ResultCache* rc		cache
+		long long* total	hits, waits, misses e evictions
+*/
+static void stats_results(ResultCache* rc, long long* total) {
+	int i;
+	memset(total, 0, 4*sizeof(long long));
+	for(i=0; i<RESULT_SHARDS; i++) {
+		pthread_mutex_lock(&rc->shard[i].lock);
+		total[0] += rc->shard[i].hits;
+		total[1] += rc->shard[i].waits;
+		total[2] += rc->shard[i].misses;
+		total[3] += rc->shard[i].evictions;
+		pthread_mutex_unlock(&rc->shard[i].lock);
+	}
+}
+
+/*Envia a partida da sessao ao pool de threads para a IA jogar.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+		int depth		profundidade maxima
+		long long nodes		numero maximo de nos
+		long long time		tempo maximo em ms
+*/
+static void think_session(Server* server, Session* session, int depth, long long nodes, long long time) {
+	session->req_depth = depth < server->max_depth ? depth : server->max_depth;	//Limitados pelos maximos do servidor
+	session->req_nodes = server->max_nodes < 0 || (nodes >= 0 && nodes < server->max_nodes) ? nodes : server->max_nodes;
+	session->req_time = server->max_time < 0 || (time >= 0 && time < server->max_time) ? time : server->max_time;
+	session->thinking = TRUE;
+	if(!push_queue(&server->jobs, session, FALSE)) {		//Fila cheia: recusa a requisicao
+		session->thinking = FALSE;
+		send_session(server, session, "error busy\n");
+	}
+}
+
+/*Interpreta limites de busca (depth N, nodes N, movetime N). Em caso de erro, nenhum limite e alterado.
+	Parametros
+		char* args	argumentos
+		int* depth	profundidade
+		long long* nodes	numero de nos
+		long long* time		tempo em ms
+	Retorno
+		numero de limites lidos, -1 se ha um nome desconhecido, um valor ausente ou um valor invalido
+*/
+static int limits_session(char* args, int* depth, long long* nodes, long long* time) {
+	int n, d;
+	long long v, k, t;
+	char* tok;
+	char* val;
+	char* end;
+	char* save;
+
+	d = *depth;
+	k = *nodes;
+	t = *time;
+	for(n=0, tok = strtok_r(args, " \t", &save); tok != NULL; n++, tok = strtok_r(NULL, " \t", &save)) {
+		if(NULL == (val = strtok_r(NULL, " \t", &save)))
+			return -1;
+		v = strtoll(val, &end, 10);
+		if(*end || end == val)
+			return -1;
+		if(!strcmp(tok, "depth") && v > 0)
+			d = v < MAX_PLY ? v : MAX_PLY;
+		else if(!strcmp(tok, "nodes"))
+			k = v;
+		else if(!strcmp(tok, "movetime"))
+			t = v;
+		else
+			return -1;
+	}
+	*depth = d;
+	*nodes = k;
+	*time = t;
+	return n;
+}
+
+/*Comando stats: contadores de instrumentacao, totais do cache de resultados e latencias da IA, uma linha de cada histograma.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void stats_session(Server* server, Session* session) {
+	char stats[STATS_SIZE];
+	long long total[4];
+	char* buf;
+	size_t n;
+	FILE* fp;
+
+	send_session(server, session, "stats %s\n", str_stats(stats));
+	if(server->results != NULL) {
+		stats_results(server->results, total);
+		send_session(server, session, "results hits %lld waits %lld misses %lld evictions %lld\n", total[0], total[1], total[2], total[3]);
+	}
+	buf = NULL;
+	fp = open_memstream(&buf, &n);
+	if(fp == NULL)
+		return;
+	print_latency(fp, "latency ");
+	fclose(fp);
+	send_session(server, session, "%s", buf);
+	free(buf);
+}
+
+/*Processa um comando de um cliente.
+	Comandos
+		new [fen]		inicia uma partida, da posicao inicial ou do FEN
+		<movimento>		movimento em notacao algebrica simplificada; a IA responde em seguida
+		go [limites]		a IA joga no turno atual
+		limits [limites]	define os limites padrao das buscas (depth N, nodes N, movetime N)
+		fen			informa o FEN atual
+		stats			informa os contadores de instrumentacao, o cache de resultados e as latencias da IA
+		quit			encerra a conexao
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+		char* line		comando
+*/
+static void command_session(Server* server, Session* session, char* line) {
+	char* args;
+	char buf[FEN_SIZE];
+	int depth;
+	long long nodes, time;
+	Piece* piece;
+	Position dest;
+
+	for(args = line; *args && !isspace(*args); args++);
+	if(*args)
+		*args++ = '\0';
+
+	if(!strcmp(line, "new")) {
+		endGame_session(session);
+		for(; isspace(*args); args++);
+		if(!load_chess(&session->chess, *args ? args : START_FEN, &session->arena)) {
+			send_session(server, session, "error invalid position\n");
+			return;
+		}
+		session->playing = TRUE;
+		send_session(server, session, "fen %s\n", genFen_chess(&session->chess, buf));
+	}
+	else if(!strcmp(line, "limits")) {
+		if(limits_session(args, &session->max_depth, &session->max_nodes, &session->max_time) < 0)
+			send_session(server, session, "error invalid limits\n");
+		else
+			send_session(server, session, "ok\n");
+	}
+	else if(!strcmp(line, "stats"))
+		stats_session(server, session);
+	else if(!strcmp(line, "quit"))
+		close_session(server, session);
+	else if(!session->playing)
+		send_session(server, session, "error no game\n");
+	else if(!strcmp(line, "fen"))
+		send_session(server, session, "fen %s\n", genFen_chess(&session->chess, buf));
+	else if(!strcmp(line, "go")) {
+		depth = session->max_depth;
+		nodes = session->max_nodes;
+		time = session->max_time;
+		if(limits_session(args, &depth, &nodes, &time) < 0)
+			send_session(server, session, "error invalid limits\n");
+		else
+			think_session(server, session, depth, nodes, time);
+	}
+	else if(parseMove_chess(&session->chess, line, &piece, &dest)) {
+		move_session(server, session, piece, &dest);
+		if(session->playing)
+			think_session(server, session, session->max_depth, session->max_nodes, session->max_time);
+	}
+	else
+		send_session(server, session, "error invalid move\n");
+}
+
+/*Processa as linhas completas recebidas por uma sessao, ate que uma busca seja iniciada.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void lines_session(Server* server, Session* session) {
+	char* end;
+	int n;
+	while(!session->thinking && !session->closing && (end = memchr(session->in, '\n', session->n_in)) != NULL) {
+		*end = '\0';
+		n = end - session->in + 1;
+		if(end > session->in && end[-1] == '\r')
+			end[-1] = '\0';
+		command_session(server, session, session->in);
+		if(session->fd < 0)	//Sessao devolvida ao pool
+			return;
+		memmove(session->in, session->in+n, session->n_in-n);
+		session->n_in -= n;
+	}
+}
+
+/*Le os dados disponiveis no socket de uma sessao.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void read_session(Server* server, Session* session) {
+	ssize_t r;
+	r = 1;
+	while(session->n_in < (int) sizeof(session->in) && (r = read(session->fd, session->in+session->n_in, sizeof(session->in)-session->n_in)) > 0) {
+		session->n_in += r;
+		lines_session(server, session);		//Durante uma busca, os comandos aguardam no buffer
+		if(session->fd < 0 || session->closing)
+			return;
+		if(!session->thinking && session->n_in == sizeof(session->in)) {
+			send_session(server, session, "error line too long\n");
+			session->n_in = 0;
+		}
+	}
+	if(!r || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))	//Conexao encerrada
+		close_session(server, session);
+	else
+		events_session(server, session);
+}
+
+/*Conclui a busca de uma sessao: joga o movimento da IA e continua a processar os comandos recebidos.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void done_session(Server* server, Session* session) {
+	char move[6];
+	char score[20];
+	Piece* piece;
+
+	session->thinking = FALSE;
+	if(session->closing) {
+		release_session(server, session);
+		return;
+	}
+	if(session->found) {
+		send_session(server, session, "bestmove %s score %s nodes %lld time %lld\n", str_move(&session->best, move), str_score(session->score, score), session->nodes, session->time);
+		piece = session->chess.board[(int) session->best.rank][(int) session->best.file];
+		move_session(server, session, piece, &session->best.dest);
+	}
+	else
+		send_session(server, session, "error no move\n");
+	lines_session(server, session);
+	if(session->fd >= 0 && !session->closing)
+		events_session(server, session);
+}
+
+/*Entrega uma busca concluida ao laco de eventos.
+	Parametros
+		Server* server		servidor
+		Session* session	sessao
+*/
+static void finish_server(Server* server, Session* session) {
+	uint64_t one;
+	one = 1;
+	push_queue(&server->done, session, TRUE);
+	if(write(server->event_fd, &one, sizeof(one)) < 0)
+		perror("eventfd");
+}
+
+/*Funcao das threads de busca do servidor. Buscas identicas simultaneas sao feitas uma so vez: as demais sessoes
+aguardam na entrada do cache de resultados sem ocupar a thread.
+	Parametros
+		void* arg	servidor
+	Retorno
+		NULL
+*/
+static void* thread_server(void* arg) {
+	Server* server;
+	Session* session;
+	Session* waiting;
+	Search* s;
+	TTable tt;
+	Resulttype r;
+	ResultEntry* entry;
+	uint64_t key;
+	boolean found;
+	Move best;
+	int score;
+
+	server = (Server*) arg;
+	s = (Search*) calloc(1, sizeof(Search));
+	initialize_ttable(&tt, server->hash);
+	s->tt = &tt;
+	entry = NULL;
+	while((session = (Session*) pop_queue(&server->jobs, TRUE)) != NULL) {
+		r = RESULT_BYPASS;
+		if(server->results != NULL) {
+			key = key_results(session);
+			r = acquire_results(server->results, key, session, &entry);
+		}
+		if(r == RESULT_WAIT)		//Sera entregue pela thread que faz a busca
+			continue;
+		if(r != RESULT_HIT) {
+			s->chess = &session->chess;
+			s->keys = session->keys;		//Somente leitura: o caminho da busca fica em s->path
+			s->n_keys = session->n_keys;
+			s->stop = FALSE;
+			s->infinite = FALSE;
+			s->max_depth = session->req_depth;
+			s->max_nodes = session->req_nodes;
+			s->max_time = session->req_time;
+			s->out = NULL;
+			session->found = iterate_search(s);
+			session->best = s->best;
+			session->score = s->score;
+			session->nodes = s->nodes;
+			session->time = elapsed_search(s);
+		}
+		waiting = r == RESULT_MISS ? complete_results(server->results, entry, session) : NULL;
+		found = session->found;		//A sessao e a entrada podem mudar apos a entrega
+		best = session->best;
+		score = session->score;
+		finish_server(server, session);
+		for(; waiting != NULL; waiting = session) {	//Sessoes que aguardavam: nenhum no buscado, time e a espera
+			session = waiting->waiting;
+			waiting->found = found;
+			waiting->best = best;
+			waiting->score = score;
+			waiting->nodes = 0;
+			waiting->time = (clock_ns() - waiting->time)/1000000;
+			finish_server(server, waiting);
+		}
+	}
+	free(s);
+	finalize_ttable(&tt);
+	return NULL;
+}
+
+/*Cria o socket de escuta, TCP em 127.0.0.1 ou Unix.
+	Parametros
+		int port	porta TCP
+		char* path	caminho do socket Unix, NULL para TCP
+	Retorno
+		socket, -1 em caso de erro
+*/
+static int listen_server(int port, char* path) {
+	int fd, on;
+	struct sockaddr_in in;
+	struct sockaddr_un un;
+
+	on = 1;
+	if(path != NULL) {
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		memset(&un, 0, sizeof(un));
+		un.sun_family = AF_UNIX;
+		strncpy(un.sun_path, path, sizeof(un.sun_path)-1);
+		unlink(path);
+		if(fd < 0 || bind(fd, (struct sockaddr*) &un, sizeof(un)) < 0)
+			return -1;
+	}
+	else {
+		fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		memset(&in, 0, sizeof(in));
+		in.sin_family = AF_INET;
+		in.sin_port = htons(port);
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if(fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 || bind(fd, (struct sockaddr*) &in, sizeof(in)) < 0)
+			return -1;
+	}
+	if(listen(fd, SOMAXCONN) < 0)
+		return -1;
+	return fd;
+}
+
+int main_server(int argc, char** argv) {
+	int i, c, n, fd, port, queue, results;
+	char* path;
+	uint64_t count;
+	pthread_t* tid;
+	Server server;
+	Session* session;
+	struct epoll_event ev;
+	struct epoll_event events[64];
+	struct sigaction sa;
+
+	memset(&server, 0, sizeof(Server));
+	server.threads = sysconf(_SC_NPROCESSORS_ONLN);
+	server.m = 1024;
+	server.max_depth = 4;
+	server.max_nodes = -1;
+	server.max_time = 5000;
+	server.hash = 4;
+	results = RESULT_MB;
+	port = 5000;
+	path = NULL;
+	queue = 0;
+	while((c = getopt(argc, argv, "p:u:t:g:q:d:n:m:H:C:")) != -1)
+		switch(c) {
+			case 'p': port = atoi(optarg);
+				  break;
+			case 'u': path = optarg;
+				  break;
+			case 't': server.threads = atoi(optarg);
+				  break;
+			case 'g': server.m = atoi(optarg);
+				  break;
+			case 'q': queue = atoi(optarg);
+				  break;
+			case 'd': server.max_depth = atoi(optarg);
+				  break;
+			case 'n': server.max_nodes = atoll(optarg);
+				  break;
+			case 'm': server.max_time = atoll(optarg);
+				  break;
+			case 'H': server.hash = atoi(optarg);
+				  break;
+			case 'C': results = atoi(optarg);
+				  break;
+			default: fprintf(stderr, "Uso: %s [-p porta | -u caminho] [-t threads] [-g partidas] [-q fila] [-d depth] [-n nodes] [-m movetime] [-H hash] [-C cache]\n", argv[0]);
+				 return 1;
+		}
+	if(server.threads < 1)
+		server.threads = 1;
+	if(server.m < 1)
+		server.m = 1;
+	if(queue < 1)
+		queue = server.m;		//Cada sessao tem no maximo uma busca pendente
+	if(server.max_depth < 1 || server.max_depth >= MAX_PLY)
+		server.max_depth = MAX_PLY-1;
+	if(server.hash < 1)
+		server.hash = 1;
+
+	if((server.listen_fd = listen_server(port, path)) < 0) {
+		perror("listen");
+		return 1;
+	}
+	server.epoll_fd = epoll_create1(0);
+	server.event_fd = eventfd(0, EFD_NONBLOCK);
+	ev.events = EPOLLIN;
+	ev.data.u64 = server.m;			//Identificadores: sessoes 0..m-1, escuta m, eventos m+1
+	epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &ev);
+	ev.data.u64 = server.m+1;
+	epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.event_fd, &ev);
+
+	server.session = (Session*) calloc(server.m, sizeof(Session));	//Pool de sessoes
+	for(i=server.m-1; i>=0; i--) {
+		server.session[i].id = i;
+		server.session[i].fd = -1;
+		initialize_arena(&server.session[i].arena);
+		server.session[i].next = server.free;
+		server.free = &server.session[i];
+	}
+	initialize_queue(&server.jobs, queue);
+	initialize_queue(&server.done, server.m);	//Cabem todas as sessoes: as que aguardam uma busca sao entregues juntas
+	if(results > 0) {
+		server.results = (ResultCache*) malloc(sizeof(ResultCache));
+		initialize_results(server.results, results);
+	}
+	tid = (pthread_t*) malloc(server.threads*sizeof(pthread_t));
+	for(i=0; i<server.threads; i++)
+		pthread_create(&tid[i], NULL, thread_server, &server);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = signal_server;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	if(path != NULL)
+		fprintf(stderr, "Servidor: %s, %d partidas, %d threads\n", path, server.m, server.threads);
+	else
+		fprintf(stderr, "Servidor: 127.0.0.1:%d, %d partidas, %d threads\n", port, server.m, server.threads);
+
+	while(!server_quit) {
+		n = epoll_wait(server.epoll_fd, events, 64, -1);
+		for(i=0; i<n; i++) {
+			if(events[i].data.u64 == (uint64_t) server.m) {		//Novas conexoes
+				while((fd = accept4(server.listen_fd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+					if(NULL == (session = acquire_session(&server, fd))) {
+						if(write(fd, "error server full\n", 18) < 0)
+							perror("write");
+						close(fd);
+						continue;
+					}
+					ev.events = EPOLLIN | EPOLLRDHUP;
+					ev.data.u64 = session->id;
+					epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+				}
+				continue;
+			}
+			if(events[i].data.u64 == (uint64_t) server.m+1) {		//Buscas concluidas
+				if(read(server.event_fd, &count, sizeof(count)) < 0)
+					continue;
+				while((session = (Session*) pop_queue(&server.done, FALSE)) != NULL)
+					done_session(&server, session);
+				continue;
+			}
+			session = &server.session[events[i].data.u64];
+			if(session->fd < 0 || session->closing)
+				continue;
+			if(events[i].events & EPOLLOUT)
+				send_session(&server, session, NULL);
+			if(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+				read_session(&server, session);
+		}
+	}
+
+	close_queue(&server.jobs);		//Encerramento
+	for(i=0; i<server.threads; i++)
+		pthread_join(tid[i], NULL);
+	for(i=0; i<server.m; i++) {
+		if(server.session[i].fd >= 0 && !server.session[i].closing)
+			close(server.session[i].fd);
+		if(server.session[i].playing)
+			clear_chess(&server.session[i].chess);
+		finalize_arena(&server.session[i].arena);
+		free(server.session[i].out);
+		free(server.session[i].keys);
+	}
+	close(server.listen_fd);
+	close(server.event_fd);
+	close(server.epoll_fd);
+	if(path != NULL)
+		unlink(path);
+	finalize_queue(&server.jobs);
+	finalize_queue(&server.done);
+	if(server.results != NULL)
+		finalize_results(server.results);
+	free(server.results);
+	free(server.session);
+	free(tid);
+	return 0;
+}
+
+/*Verifica se um caractere encerra um elemento PGN.
+	Parametros
+		char c		caractere
+	Retorno
+		TRUE se e espaco ou delimitador, FALSE caso contrario
+*/
+static boolean delim_pgn(char c) {
+	return isspace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == ';' || c == '$';
+}
+
+Pgntype next_pgn(Pgn* pgn, PgnToken* tok) {
+	const char* p;
+	const char* end;
+
+	end = pgn->end;
+	for(p = pgn->p; p < end && isspace(*p); p++);
+	tok->p = p;
+	if(p >= end) {
+		pgn->p = p;
+		tok->n = 0;
+		return tok->type = PGN_EOF;
+	}
+
+	switch(*p) {
+		case '[':					//Cabecalho: ate ']' fora de aspas
+			tok->type = PGN_TAG;
+			for(tok->p = ++p; p < end && *p != ']'; p++)
+				if(*p == '"')
+					for(p++; p < end && *p != '"'; p += 1 + (*p == '\\'));
+			tok->n = p - tok->p;
+			p += p < end;
+			break;
+
+		case '{':					//Comentarios
+			tok->type = PGN_COMMENT;
+			for(tok->p = ++p; p < end && *p != '}'; p++);
+			tok->n = p - tok->p;
+			p += p < end;
+			break;
+
+		case ';':
+		case '%':
+			tok->type = PGN_COMMENT;
+			for(tok->p = ++p; p < end && *p != '\n'; p++);
+			tok->n = p - tok->p;
+			break;
+
+		case '(':					//Variantes
+			tok->type = PGN_VAR_BEGIN;
+			tok->n = 1;
+			p++;
+			break;
+
+		case ')':
+			tok->type = PGN_VAR_END;
+			tok->n = 1;
+			p++;
+			break;
+
+		case '$':					//Anotacoes
+			tok->type = PGN_NAG;
+			for(p++; p < end && isdigit(*p); p++);
+			tok->n = p - tok->p;
+			break;
+
+		case '!':
+		case '?':
+			tok->type = PGN_NAG;
+			for(; p < end && (*p == '!' || *p == '?'); p++);
+			tok->n = p - tok->p;
+			break;
+
+		case '*':
+			tok->type = PGN_RESULT;
+			tok->n = 1;
+			p++;
+			break;
+
+		default:
+			if(isdigit(*p)) {			//Numero do lance ou resultado
+				for(; p < end && isdigit(*p); p++);
+				if(p < end && (*p == '-' || *p == '/')) {
+					tok->type = PGN_RESULT;
+					for(; p < end && !delim_pgn(*p); p++);
+				}
+				else {
+					tok->type = PGN_NUMBER;
+					for(; p < end && *p == '.'; p++);
+				}
+			}
+			else {					//Lance
+				tok->type = PGN_MOVE;
+				for(; p < end && !delim_pgn(*p); p++);
+			}
+			tok->n = p - tok->p;
+	}
+	pgn->p = p;
+	return tok->type;
+}
+
+void tag_pgn(PgnToken* tok, PgnToken* name, PgnToken* value) {
+	const char* p;
+	const char* end;
+
+	end = tok->p + tok->n;
+	for(p = tok->p; p < end && isspace(*p); p++);
+	for(name->p = p; p < end && !isspace(*p) && *p != '"'; p++);
+	name->n = p - name->p;
+	for(; p < end && *p != '"'; p++);
+	value->p = p + (p < end);
+	for(p = value->p; p < end && *p != '"'; p += 1 + (*p == '\\'));
+	value->n = (p < end ? p : end) - value->p;
+}
+
+/*Acrescenta uma linha a saida do jogo atual.
+	Parametros
+		Pgn* pgn	leitura
+		char* str	linha, sem o \n
+*/
+static void append_pgn(Pgn* pgn, char* str) {
+	size_t n;
+	n = strlen(str);
+	if(pgn->n_buf + n + 2 > pgn->m_buf) {
+		pgn->m_buf = 2*(pgn->n_buf + n + 2);
+		pgn->buf = (char*) realloc(pgn->buf, pgn->m_buf);
+	}
+	memcpy(pgn->buf + pgn->n_buf, str, n);
+	pgn->n_buf += n;
+	pgn->buf[pgn->n_buf++] = '\n';
+}
+
+/*Cria um arquivo temporario ja removido do diretorio.
+	Parametros
+		const char* dir	diretorio
+	Retorno
+		arquivo aberto para leitura e escrita, NULL em caso de erro
+*/
+static FILE* temp_index(const char* dir) {
+	char* path;
+	int fd;
+	FILE* file;
+
+	if(asprintf(&path, "%s/chess-index-XXXXXX", dir) < 0)
+		return NULL;
+	fd = mkstemp(path);
+	if(fd >= 0)
+		unlink(path);
+	free(path);
+	if(fd < 0 || NULL == (file = fdopen(fd, "w+b"))) {
+		if(fd >= 0)
+			close(fd);
+		return NULL;
+	}
+	return file;
+}
+
+void spill_index(IndexRun* run, boolean all) {
+	size_t n, k;
+	FILE* file;
+
+	n = compact_explorer(run->entry, run->game);
+	if(all ? n > 0 : n > run->m/2) {
+		if(NULL == (file = temp_index(run->dir)) || fwrite(run->entry, sizeof(ExplorerEntry), n, file) != n) {
+			run->error = TRUE;
+			if(file != NULL)
+				fclose(file);
+		}
+		else {
+			run->runs = (FILE**) realloc(run->runs, (run->n_runs+1)*sizeof(FILE*));
+			run->runs[run->n_runs++] = file;
+		}
+		n = 0;
+	}
+	k = run->n - run->game;			//Posicoes do jogo atual, movidas para depois das mantidas
+	memmove(run->entry + n, run->entry + run->game, k*sizeof(ExplorerEntry));
+	run->game = n;
+	run->n = n + k;
+}
+
+/*Acrescenta uma posicao do jogo atual a sequencia do indice de aberturas.
+	Parametros
+		IndexRun* run		sequencia
+		uint64_t key		chave zobrist da posicao
+		unsigned short move	codigo do movimento jogado
+*/
+static void push_index(IndexRun* run, uint64_t key, unsigned short move) {
+	if(run->n == run->m) {
+		if(run->game)			//Memoria cheia: grava os jogos concluidos
+			spill_index(run, FALSE);
+		if(run->n == run->m) {		//Jogo maior que a memoria
+			run->m *= 2;
+			run->entry = (ExplorerEntry*) realloc(run->entry, run->m*sizeof(ExplorerEntry));
+		}
+	}
+	memset(&run->entry[run->n], 0, sizeof(ExplorerEntry));
+	run->entry[run->n].key = key;
+	run->entry[run->n++].move = move;
+}
+
+/*Conclui o jogo atual da sequencia do indice de aberturas: as posicoes recebem o resultado, ou sao descartadas
+se o jogo nao tem resultado ou tem erro.
+	Parametros
+		IndexRun* run	sequencia
+		char result	'w' vitoria das brancas, 'd' empate, 'b' vitoria das pretas, 0 descarta
+*/
+static void result_index(IndexRun* run, char result) {
+	size_t i;
+	if(!result) {
+		run->n = run->game;
+		return;
+	}
+	for(i=run->game; i<run->n; i++) {
+		run->entry[i].white = result == 'w';
+		run->entry[i].draws = result == 'd';
+		run->entry[i].black = result == 'b';
+	}
+	run->positions += run->n - run->game;
+	run->games++;
+	run->game = run->n;
+}
+
+boolean game_pgn(Pgn* pgn) {
+	char fen[FEN_SIZE];
+	int depth;
+	boolean started, error;
+	const char* p;
+	PgnToken tok, name, value;
+	Fen f;
+	State st;
+	Move move;
+	char result;
+
+	strcpy(fen, START_FEN);
+	started = error = FALSE;
+	result = 0;
+	depth = 0;
+	pgn->n_buf = 0;
+	while(TRUE) {
+		p = pgn->p;
+		next_pgn(pgn, &tok);
+		if(tok.type == PGN_EOF)
+			break;
+		if(tok.type == PGN_TAG) {
+			if(started) {			//Cabecalho do proximo jogo (resultado ausente)
+				pgn->p = p;
+				break;
+			}
+			tag_pgn(&tok, &name, &value);	//Posicao inicial
+			if(name.n == 3 && !strncmp(name.p, "FEN", 3) && value.n < (int) sizeof(fen)) {
+				memcpy(fen, value.p, value.n);
+				fen[value.n] = '\0';
+			}
+			if(name.n == 6 && !strncmp(name.p, "Result", 6) && value.n)	//Resultado do cabecalho
+				result = *value.p == '*' ? 0 : value.p[1] == '/' ? 'd' : *value.p == '1' ? 'w' : 'b';
+			continue;
+		}
+		if(tok.type == PGN_VAR_BEGIN)
+			depth++;
+		if(tok.type == PGN_VAR_END)
+			depth -= depth > 0;
+		if(depth || (tok.type != PGN_MOVE && tok.type != PGN_RESULT))
+			continue;
+
+		if(!started) {				//Primeiro lance: carrega a posicao inicial
+			started = TRUE;
+			if(!parseFen(fen, &f) || !validFen(&f))
+				error = TRUE;
+			else {
+				loadFen_state(&st, &f);
+				if(pgn->fen)
+					append_pgn(pgn, fen);
+			}
+		}
+		if(tok.type == PGN_RESULT) {		//Resultado do fim do jogo: 1-0, 0-1, 1/2-1/2 ou *
+			result = *tok.p == '*' ? 0 : tok.n > 1 && tok.p[1] == '/' ? 'd' : *tok.p == '1' ? 'w' : 'b';
+			break;
+		}
+		if(error)
+			continue;
+		if(!parseSan_state(&st, tok.p, tok.n, &move)) {
+			error = TRUE;
+			continue;
+		}
+		if(pgn->run != NULL)			//Posicao e movimento do indice de aberturas
+			push_index(pgn->run, key_explorer(&st), code_move(&move));
+		doMove_state(&st, &move);
+		pgn->plies++;
+		if(pgn->fen) {
+			getFen_state(&st, &f);
+			append_pgn(pgn, writeFen(&f, fen));
+		}
+	}
+
+	if(!started)
+		return tok.type != PGN_EOF;
+	if(pgn->run != NULL)
+		result_index(pgn->run, error ? 0 : result);
+	pgn->games++;
+	pgn->errors += error;
+	if(pgn->n_buf) {
+		pthread_mutex_lock(pgn->out_lock);
+		fwrite(pgn->buf, 1, pgn->n_buf, pgn->out);
+		pthread_mutex_unlock(pgn->out_lock);
+	}
+	return TRUE;
+}
+
+/*Funcao das threads de leitura PGN: reproduz todos os jogos de um trecho.
+	Parametros
+		void* arg	registro Pgn do trecho
+	Retorno
+		NULL
+*/
+static void* thread_pgn(void* arg) {
+	Pgn* pgn;
+	pgn = (Pgn*) arg;
+	while(game_pgn(pgn));
+	if(pgn->run != NULL)			//Ultima sequencia do indice de aberturas
+		spill_index(pgn->run, TRUE);
+	flush_stats();
+	return NULL;
+}
+
+/*Encontra o inicio do primeiro jogo a partir de uma posicao: uma linha iniciada por '[' apos uma linha que nao e cabecalho.
+	Parametros
+		const char* p		posicao
+		const char* begin	inicio do arquivo
+		const char* end		fim do arquivo
+	Retorno
+		inicio do jogo, end se nenhum
+*/
+static const char* boundary_pgn(const char* p, const char* begin, const char* end) {
+	const char* q;
+	for(; p < end; p++) {
+		if(*p != '[' || (p > begin && p[-1] != '\n'))
+			continue;
+		for(q = p-1; q > begin && isspace(q[-1]) && q[-1] != '\n'; q--);	//Linha anterior
+		for(q -= q > begin; q > begin && q[-1] != '\n'; q--);
+		for(; q < p && isspace(*q); q++);
+		if(q == p || *q != '[')
+			return p;
+	}
+	return end;
+}
+
+int main_pgn(int argc, char** argv) {
+	int i, c, fd, threads;
+	boolean fen;
+	const char* data;
+	const char* p;
+	struct stat st;
+	struct timespec start, end;
+	double t;
+	pthread_t* tid;
+	pthread_mutex_t out_lock;
+	Pgn* pgn;
+	Pgn total;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	fen = FALSE;
+	while((c = getopt(argc, argv, "t:f")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'f': fen = TRUE;
+				  break;
+			default: fprintf(stderr, "Uso: %s [-t threads] [-f] arquivo\n", argv[0]);
+				 return 1;
+		}
+	if(optind >= argc) {
+		fprintf(stderr, "Uso: %s [-t threads] [-f] arquivo\n", argv[0]);
+		return 1;
+	}
+	if((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	data = st.st_size ? (const char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	if(data == MAP_FAILED) {
+		perror("mmap");
+		close(fd);
+		return 1;
+	}
+	if(data != NULL)
+		madvise((void*) data, st.st_size, MADV_SEQUENTIAL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_init(&out_lock, NULL);
+	pgn = (Pgn*) calloc(threads, sizeof(Pgn));
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	p = data;
+	for(i=0; i<threads; i++) {		//Trechos de tamanhos aproximadamente iguais, nos limites dos jogos
+		pgn[i].p = p;
+		pgn[i].end = i == threads-1 ? data + st.st_size : boundary_pgn(data + st.st_size/threads*(i+1), data, data + st.st_size);
+		if(pgn[i].end < p)
+			pgn[i].end = p;
+		p = pgn[i].end;
+		pgn[i].fen = fen;
+		pgn[i].out = stdout;
+		pgn[i].out_lock = &out_lock;
+		pthread_create(&tid[i], NULL, thread_pgn, &pgn[i]);
+	}
+	memset(&total, 0, sizeof(Pgn));
+	for(i=0; i<threads; i++) {
+		pthread_join(tid[i], NULL);
+		total.games += pgn[i].games;
+		total.plies += pgn[i].plies;
+		total.errors += pgn[i].errors;
+		free(pgn[i].buf);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	fflush(stdout);
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	fprintf(stderr, "%lld jogos, %lld lances, %lld jogos com erro, %.1f MB, %.3f s, %.1f MB/s, %d threads\n", total.games, total.plies, total.errors, st.st_size/1e6, t, st.st_size/1e6/(t > 0 ? t : 1), threads);
+
+	if(data != NULL)
+		munmap((void*) data, st.st_size);
+	close(fd);
+	pthread_mutex_destroy(&out_lock);
+	free(pgn);
+	free(tid);
+	return 0;
+}
+
+/*Avanca a leitura de uma sequencia ordenada do indice de aberturas.
+	Parametros
+		IndexReader* r	leitura
+	Retorno
+		TRUE se ha uma entrada atual, FALSE no fim da sequencia
+*/
+static boolean next_index(IndexReader* r) {
+	if(++r->i < r->n)
+		return TRUE;
+	r->i = 0;
+	r->n = fread(r->buf, sizeof(ExplorerEntry), INDEX_READ, r->file);
+	return r->n > 0;
+}
+
+/*Restaura a propriedade de heap (menor entrada atual na raiz) a partir de um no.
+	Parametros
+		IndexReader** heap	leituras
+		int n			numero de leituras
+		int i			no
+*/
+static void sift_index(IndexReader** heap, int n, int i) {
+	IndexReader* tmp;
+	int c;
+	for(; (c = 2*i+1) < n; i = c) {
+		if(c+1 < n && cmp_explorer(&heap[c+1]->buf[heap[c+1]->i], &heap[c]->buf[heap[c]->i]) < 0)
+			c++;
+		if(cmp_explorer(&heap[c]->buf[heap[c]->i], &heap[i]->buf[heap[i]->i]) >= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[c];
+		heap[c] = tmp;
+	}
+}
+
+/*Intercala as sequencias ordenadas de todas as threads num indice de aberturas, somando as entradas iguais.
+	Parametros
+		IndexRun* run		sequencias de cada thread
+		int threads		numero de threads
+		ExplorerWriter* w	indice em gravacao
+	Retorno
+		TRUE em caso de sucesso, FALSE em caso de erro de leitura ou escrita
+*/
+static boolean merge_index(IndexRun* run, int threads, ExplorerWriter* w) {
+	IndexReader* r;
+	IndexReader** heap;
+	int i, j, k, n, total;
+	boolean ok;
+
+	for(i=total=0; i<threads; i++)
+		total += run[i].n_runs;
+	r = (IndexReader*) calloc(total ? total : 1, sizeof(IndexReader));
+	heap = (IndexReader**) malloc((total ? total : 1)*sizeof(IndexReader*));
+	for(i=k=n=0; i<threads; i++)
+		for(j=0; j<run[i].n_runs; j++, k++) {
+			r[k].file = run[i].runs[j];
+			r[k].buf = (ExplorerEntry*) malloc(INDEX_READ*sizeof(ExplorerEntry));
+			rewind(r[k].file);
+			if(next_index(&r[k]))		//Sequencias nao vazias
+				heap[n++] = &r[k];
+		}
+	for(i=n/2-1; i>=0; i--)
+		sift_index(heap, n, i);
+	ok = TRUE;
+	while(n && ok) {			//Menor entrada atual: gravada, e a sequencia avanca
+		ok = write_explorer(w, &heap[0]->buf[heap[0]->i]);
+		if(!next_index(heap[0])) {
+			ok = ok && !ferror(heap[0]->file);
+			heap[0] = heap[--n];
+		}
+		sift_index(heap, n, 0);
+	}
+	for(i=0; i<total; i++) {
+		free(r[i].buf);
+		fclose(r[i].file);
+	}
+	free(r);
+	free(heap);
+	return ok;
+}
+
+int main_index(int argc, char** argv) {
+	int i, c, fd, threads;
+	size_t mb;
+	const char* out;
+	const char* dir;
+	const char* data;
+	const char* p;
+	struct stat st;
+	struct timespec start, end;
+	double t;
+	pthread_t* tid;
+	pthread_mutex_t out_lock;
+	Pgn* pgn;
+	IndexRun* run;
+	ExplorerWriter w;
+	long long games, positions, errors, runs;
+	boolean ok;
+	static const char* usage = "Uso: %s -o indice [-t threads] [-M memoria] [-T diretorio] arquivo\n";
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	mb = INDEX_MB;
+	out = NULL;
+	dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+	while((c = getopt(argc, argv, "o:t:M:T:")) != -1)
+		switch(c) {
+			case 'o': out = optarg;
+				  break;
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'M': mb = strtoull(optarg, NULL, 10);
+				  break;
+			case 'T': dir = optarg;
+				  break;
+			default: fprintf(stderr, usage, argv[0]);
+				 return 1;
+		}
+	if(out == NULL || optind >= argc) {
+		fprintf(stderr, usage, argv[0]);
+		return 1;
+	}
+	if((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	if(mb < 1)
+		mb = 1;
+	data = st.st_size ? (const char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	if(data == MAP_FAILED) {
+		perror("mmap");
+		close(fd);
+		return 1;
+	}
+	if(data != NULL)
+		madvise((void*) data, st.st_size, MADV_SEQUENTIAL);
+	if(!create_explorer(&w, out)) {
+		perror(out);
+		if(data != NULL)
+			munmap((void*) data, st.st_size);
+		close(fd);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_init(&out_lock, NULL);
+	pgn = (Pgn*) calloc(threads, sizeof(Pgn));
+	run = (IndexRun*) calloc(threads, sizeof(IndexRun));
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	p = data;
+	for(i=0; i<threads; i++) {		//Trechos de tamanhos aproximadamente iguais, nos limites dos jogos
+		pgn[i].p = p;
+		pgn[i].end = i == threads-1 ? data + st.st_size : boundary_pgn(data + st.st_size/threads*(i+1), data, data + st.st_size);
+		if(pgn[i].end < p)
+			pgn[i].end = p;
+		p = pgn[i].end;
+		pgn[i].out = stdout;
+		pgn[i].out_lock = &out_lock;
+		pgn[i].run = &run[i];
+		run[i].m = mb*1024*1024/threads/sizeof(ExplorerEntry);
+		if(run[i].m < 1024)
+			run[i].m = 1024;
+		run[i].entry = (ExplorerEntry*) malloc(run[i].m*sizeof(ExplorerEntry));
+		run[i].dir = dir;
+		pthread_create(&tid[i], NULL, thread_pgn, &pgn[i]);
+	}
+	games = positions = errors = runs = 0;
+	ok = TRUE;
+	for(i=0; i<threads; i++) {
+		pthread_join(tid[i], NULL);
+		games += run[i].games;
+		positions += run[i].positions;
+		errors += pgn[i].errors;
+		runs += run[i].n_runs;
+		ok = ok && !run[i].error;
+		free(run[i].entry);
+		free(pgn[i].buf);
+	}
+	ok = ok && merge_index(run, threads, &w);	//Intercalacao das sequencias de todas as threads
+	ok = finish_explorer(&w, games) && ok;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(!ok)
+		fprintf(stderr, "%s: erro de leitura ou escrita\n", out);
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	fprintf(stderr, "%lld jogos, %lld posicoes, %llu entradas, %lld sequencias, %lld jogos com erro, %.1f MB, %.3f s, %.0f posicoes/s, %d threads\n", games, positions, (unsigned long long) w.header.entries, runs, errors, (w.offset + w.header.blocks*sizeof(ExplorerBlock))/1e6, t, positions/(t > 0 ? t : 1), threads);
+
+	for(i=0; i<threads; i++)
+		free(run[i].runs);
+	if(data != NULL)
+		munmap((void*) data, st.st_size);
+	close(fd);
+	pthread_mutex_destroy(&out_lock);
+	free(pgn);
+	free(run);
+	free(tid);
+	return !ok;
+}
+
+int main_explore(int argc, char** argv) {
+	Explorer* ex;
+	ExplorerMove moves[MAX_MOVES];
+	FILE* in;
+	char* line;
+	char fen[FEN_SIZE];
+	size_t b;
+	int i, n;
+	long long positions, games;
+	long long t, total;
+
+	if(argc < 2) {
+		fprintf(stderr, "Uso: %s indice [arquivo]\n", argv[0]);
+		return 1;
+	}
+	if(NULL == (ex = initialize_explorer(argv[1]))) {
+		perror(argv[1]);
+		return 1;
+	}
+	if(NULL == (in = argc > 2 ? fopen(argv[2], "r") : stdin)) {
+		perror(argv[2]);
+		finalize_explorer(ex);
+		return 1;
+	}
+	line = NULL;
+	b = 0;
+	positions = total = 0;
+	while(-1 != getline(&line, &b, in)) {
+		if(line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		line[strcspn(line, "\r\n")] = '\0';
+		if(!epdToFen(line, fen, sizeof(fen))) {
+			printf("%s error invalid position\n", line);
+			continue;
+		}
+		t = clock_ns();
+		n = query_explorer(ex, fen, moves, MAX_MOVES);
+		total += clock_ns() - t;
+		if(n < 0) {
+			printf("%s error invalid position\n", line);
+			continue;
+		}
+		positions++;
+		for(i=games=0; i<n; i++)
+			games += moves[i].games;
+		printf("%s games %lld", fen, games);		//Movimento, jogos, vitorias das brancas, empates e vitorias das pretas
+		for(i=0; i<n; i++)
+			printf(" %s %lld %lld %lld %lld", moves[i].move, moves[i].games, moves[i].white, moves[i].draws, moves[i].black);
+		printf("\n");
+	}
+	fprintf(stderr, "%lld posicoes, %.2f us/consulta\n", positions, positions ? total/1e3/positions : 0.0);
+	free(line);
+	if(in != stdin)
+		fclose(in);
+	finalize_explorer(ex);
+	return 0;
+}
+
+/*Le o proximo jogo de um arquivo PGN para o anotador: cabecalhos, posicao inicial, lances da linha principal
+(validados) e resultado. Variantes, comentarios e anotacoes do jogo sao descartados.
+	Parametros
+		Pgn* pgn	leitura
+		long long seq	ordem do jogo
+	Retorno
+		jogo alocado, NULL no fim do arquivo
+*/
+static Annotation* read_annotate(Pgn* pgn, long long seq) {
+	int depth, m;
+	boolean started;
+	const char* p;
+	PgnToken tok, name, value;
+	Annotation* a;
+	Fen f;
+	State st;
+
+	a = (Annotation*) calloc(1, sizeof(Annotation));
+	a->seq = seq;
+	strcpy(a->fen, START_FEN);
+	strcpy(a->result, "*");
+	started = FALSE;
+	depth = m = 0;
+	for(a->text = pgn->p; a->text < pgn->end && isspace(*a->text); a->text++);
+	while(TRUE) {
+		p = pgn->p;
+		next_pgn(pgn, &tok);
+		if(tok.type == PGN_EOF)
+			break;
+		if(tok.type == PGN_TAG) {
+			if(started) {			//Cabecalho do proximo jogo (resultado ausente)
+				pgn->p = p;
+				break;
+			}
+			if(a->tags == NULL)
+				a->tags = tok.p-1;
+			a->n_tags = tok.p + tok.n + 1 - a->tags;
+			tag_pgn(&tok, &name, &value);	//Posicao inicial
+			if(name.n == 3 && !strncmp(name.p, "FEN", 3) && value.n < FEN_SIZE) {
+				memcpy(a->fen, value.p, value.n);
+				a->fen[value.n] = '\0';
+			}
+			continue;
+		}
+		if(tok.type == PGN_VAR_BEGIN)
+			depth++;
+		if(tok.type == PGN_VAR_END)
+			depth -= depth > 0;
+		if(depth || (tok.type != PGN_MOVE && tok.type != PGN_RESULT))
+			continue;
+
+		if(!started) {				//Primeiro lance: carrega a posicao inicial
+			started = TRUE;
+			if(!parseFen(a->fen, &f) || !validFen(&f))
+				a->error = TRUE;
+			else
+				loadFen_state(&st, &f);
+		}
+		if(tok.type == PGN_RESULT) {
+			if(tok.n < (int) sizeof(a->result)) {
+				memcpy(a->result, tok.p, tok.n);
+				a->result[tok.n] = '\0';
+			}
+			break;
+		}
+		if(a->error)
+			continue;
+		if(a->n == m) {
+			m = 2*m + 64;
+			a->moves = (Move*) realloc(a->moves, m*sizeof(Move));
+		}
+		if(!parseSan_state(&st, tok.p, tok.n, &a->moves[a->n])) {
+			a->error = TRUE;
+			continue;
+		}
+		doMove_state(&st, &a->moves[a->n++]);
+	}
+	a->n_text = pgn->p - a->text;
+	if(!started && a->tags == NULL) {		//Fim do arquivo
+		free(a->moves);
+		free(a);
+		return NULL;
+	}
+	return a;
+}
+
+/*Escreve uma pontuacao como avaliacao PGN ([%eval]) do ponto de vista das brancas: peoes ou #lances do mate,
+negativo se as pretas dao mate.
+	Parametros
+		int score	pontuacao do ponto de vista do turno
+		char turn	turno
+		char* str	recipiente
+	Retorno
+		str
+*/
+static char* eval_annotate(int score, char turn, char* str) {
+	int moves;
+	if(abs(score) > MATE-MAX_PLY) {
+		moves = score > 0 ? (MATE-score+1)/2 : -(MATE+score)/2;
+		sprintf(str, "#%d", turn ? -moves : moves);
+	}
+	else
+		sprintf(str, "%.2f", (turn ? -score : score)/100.0);
+	return str;
+}
+
+/*Acrescenta uma palavra ao texto de um jogo, com linhas de ate 80 colunas.
+	Parametros
+		FILE* out		texto
+		int* col		coluna atual
+		const char* word	palavra
+*/
+static void word_annotate(FILE* out, int* col, const char* word) {
+	int n;
+	n = strlen(word);
+	if(*col && *col + 1 + n > 80) {
+		fputc('\n', out);
+		*col = 0;
+	}
+	else if(*col) {
+		fputc(' ', out);
+		(*col)++;
+	}
+	fputs(word, out);
+	*col += n;
+}
+
+/*Limita uma pontuacao para o calculo da perda de um lance.
+	Parametros
+		int score	pontuacao
+	Retorno
+		pontuacao entre -LOSS_CAP e LOSS_CAP
+*/
+static int cap_annotate(int score) {
+	return score > LOSS_CAP ? LOSS_CAP : score < -LOSS_CAP ? -LOSS_CAP : score;
+}
+
+/*Analisa cada posicao de um jogo e escreve o jogo anotado: avaliacao apos cada lance e NAG dos lances que perdem
+pontuacao em relacao ao melhor movimento. A perda compara a busca da posicao com a da posicao seguinte um nivel
+menos profunda (mesma paridade), sem a oscilacao entre profundidades pares e impares. Os meio-turnos sao
+analisados em ordem com a mesma tabela de transposicao, que reaproveita as buscas dos anteriores.
+	Parametros
+		Annotator* an	anotador
+		Annotation* a	jogo
+		Search* s	busca, com a tabela de transposicao da thread
+		Arena* arena	memoria da posicao
+		long long* nodes	contador de nos
+		long long* nags		contadores de imprecisoes, erros e erros graves
+*/
+static void analyze_annotate(Annotator* an, Annotation* a, Search* s, Arena* arena, long long* nodes, long long* nags) {
+	static const char* nag[3] = {" $6", " $2", " $4"};
+	int i, k, d, col, first, loss, level;
+	int* score;
+	int (*scores)[MAX_PLY];
+	int* depth;
+	uint64_t* keys;
+	char (*san)[8];
+	char word[64];
+	char eval[16];
+	Move* best;
+	FILE* out;
+	Chess chess;
+
+	if(a->error || !load_chess(&chess, a->fen, arena)) {	//Jogo escrito como esta
+		a->error = TRUE;
+		a->out = (char*) malloc(a->n_text + 2);
+		memcpy(a->out, a->text, a->n_text);
+		memcpy(a->out + a->n_text, "\n\n", 2);
+		a->n_out = a->n_text + 2;
+		return;
+	}
+	score = (int*) malloc((a->n+1)*sizeof(int));
+	scores = (int (*)[MAX_PLY]) malloc((a->n+1)*sizeof(*scores));
+	depth = (int*) malloc((a->n+1)*sizeof(int));
+	best = (Move*) malloc((a->n+1)*sizeof(Move));
+	keys = (uint64_t*) malloc((a->n+1)*sizeof(uint64_t));
+	san = (char (*)[8]) malloc((a->n+1)*sizeof(*san));
+	k = chess.turn;
+	first = chess.n_turns;
+	clear_ttable(s->tt);				//Resultado independente da divisao dos jogos entre as threads
+	for(i=0; i<=a->n; i++) {
+		s->chess = &chess;
+		s->stop = FALSE;
+		s->infinite = FALSE;
+		s->max_depth = an->max_depth;
+		s->max_nodes = an->max_nodes;
+		s->max_time = an->max_time;
+		s->keys = keys;
+		s->n_keys = i;
+		s->out = NULL;
+		if(iterate_search(s)) {
+			score[i] = s->score;
+			best[i] = s->best;
+			depth[i] = s->depth;
+			memcpy(scores[i], s->scores, (s->depth+1)*sizeof(int));
+			if(an->cache != NULL && s->depth >= CACHE_DEPTH)	//Somente gravado: a leitura mudaria as pontuacoes por profundidade
+				store_cache(an->cache, key_chess(&chess), s->depth, s->score, EXACT, &s->best);
+		}
+		else {					//Fim do jogo: mate ou afogamento
+			score[i] = incheck_chess(&chess) ? -MATE : 0;
+			best[i].file = -1;
+			depth[i] = 0;
+		}
+		*nodes += s->nodes;
+		if(i == a->n)
+			break;
+		genSan_chess(&chess, &a->moves[i], san[i]);
+		keys[i] = key_chess(&chess);
+		makeMove_chess(&chess, chess.board[(int) a->moves[i].rank][(int) a->moves[i].file], &a->moves[i].dest);
+	}
+	clear_chess(&chess);
+
+	out = open_memstream(&a->out, &a->n_out);
+	if(a->tags != NULL)
+		fprintf(out, "%.*s\n\n", (int) a->n_tags, a->tags);
+	col = 0;
+	for(i=0; i<a->n; i++) {				//Numero, lance em SAN, NAG e avaliacao da posicao seguinte
+		for(d = depth[i]-1; d > depth[i+1]; d -= 2);	//Profundidade da posicao seguinte comparavel a da atual
+		loss = code_move(&a->moves[i]) == code_move(&best[i]) ? 0 :
+		       cap_annotate(score[i]) + cap_annotate(d > 0 ? scores[i+1][d] : score[i+1]);
+		level = loss >= BLUNDER ? 2 : loss >= MISTAKE ? 1 : loss >= INACCURACY ? 0 : -1;
+		if(level >= 0)
+			nags[level]++;
+		snprintf(word, sizeof(word), "%d%s%s%s", first + (k+i)/2, (k+i)%2 ? "..." : ".", san[i], level >= 0 ? nag[level] : "");
+		word_annotate(out, &col, word);
+		if(best[i+1].file >= 0) {		//Sem avaliacao da posicao final de mate ou afogamento
+			snprintf(word, sizeof(word), "{[%%eval %s]}", eval_annotate(score[i+1], (k+i+1)%2, eval));
+			word_annotate(out, &col, word);
+		}
+	}
+	word_annotate(out, &col, a->result);
+	fputs("\n\n", out);
+	fclose(out);
+	free(score);
+	free(scores);
+	free(depth);
+	free(best);
+	free(keys);
+	free(san);
+}
+
+/*Funcao das threads de analise do anotador: analisa jogos ate o fechamento da fila.
+	Parametros
+		void* arg	registro Annotator
+	Retorno
+		NULL
+*/
+static void* thread_annotate(void* arg) {
+	Annotator* an;
+	Annotation* a;
+	Search* s;
+	TTable tt;
+	Arena arena;
+	long long games, plies, nodes, errors;
+	long long nags[3];
+
+	an = (Annotator*) arg;
+	s = (Search*) calloc(1, sizeof(Search));
+	initialize_arena(&arena);
+	initialize_ttable(&tt, an->hash);
+	s->tt = &tt;
+	games = plies = nodes = errors = 0;
+	memset(nags, 0, sizeof(nags));
+	while((a = (Annotation*) pop_queue(&an->jobs, TRUE)) != NULL) {
+		analyze_annotate(an, a, s, &arena, &nodes, nags);
+		games++;
+		plies += a->error ? 0 : a->n;
+		errors += a->error;
+		push_queue(&an->done, a, TRUE);
+	}
+	pthread_mutex_lock(&an->lock);
+	an->games += games;
+	an->plies += plies;
+	an->nodes += nodes;
+	an->errors += errors;
+	an->nags[0] += nags[0];
+	an->nags[1] += nags[1];
+	an->nags[2] += nags[2];
+	pthread_mutex_unlock(&an->lock);
+	free(s);
+	finalize_ttable(&tt);
+	finalize_arena(&arena);
+	flush_stats();
+	return NULL;
+}
+
+/*Funcao da thread de escrita do anotador: escreve os jogos anotados na ordem do arquivo.
+	Parametros
+		void* arg	registro Annotator
+	Retorno
+		NULL
+*/
+static void* writer_annotate(void* arg) {
+	Annotator* an;
+	Annotation* a;
+
+	an = (Annotator*) arg;
+	while((a = (Annotation*) pop_queue(&an->done, TRUE)) != NULL) {
+		an->pending[a->seq % an->window] = a;	//A leitura mantem os jogos pendentes dentro da janela
+		while((a = an->pending[an->written % an->window]) != NULL) {
+			fwrite(a->out, 1, a->n_out, an->out);
+			an->pending[an->written % an->window] = NULL;
+			free(a->out);
+			free(a->moves);
+			free(a);
+			pthread_mutex_lock(&an->lock);
+			an->written++;
+			pthread_cond_signal(&an->cond);
+			pthread_mutex_unlock(&an->lock);
+		}
+	}
+	fflush(an->out);
+	return NULL;
+}
+
+int main_annotate(int argc, char** argv) {
+	static const char* usage = "Uso: %s [-t threads] [-d depth] [-n nodes] [-m movetime] [-H hash] [-c cache] arquivo\n";
+	int i, c, fd, threads;
+	long long seq;
+	const char* data;
+	struct stat st;
+	struct timespec start, end;
+	double t;
+	pthread_t* tid;
+	pthread_t writer;
+	Annotator an;
+	Annotation* a;
+	Cache cache;
+	Pgn pgn;
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	memset(&an, 0, sizeof(Annotator));
+	an.out = stdout;
+	an.max_depth = 6;
+	an.max_nodes = -1;
+	an.max_time = -1;
+	an.hash = TT_MB;
+	while((c = getopt(argc, argv, "t:d:n:m:H:c:")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'd': an.max_depth = atoi(optarg);
+				  break;
+			case 'n': an.max_nodes = atoll(optarg);
+				  break;
+			case 'm': an.max_time = atoll(optarg);
+				  break;
+			case 'H': an.hash = atoi(optarg);
+				  break;
+			case 'c': if(!open_cache(&cache, optarg, CACHE_MB)) {
+					perror(optarg);
+					return 1;
+				  }
+				  an.cache = &cache;
+				  break;
+			default: fprintf(stderr, usage, argv[0]);
+				 return 1;
+		}
+	if(optind >= argc) {
+		fprintf(stderr, usage, argv[0]);
+		return 1;
+	}
+	if((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	if(an.max_depth < 1 || an.max_depth >= MAX_PLY)
+		an.max_depth = MAX_PLY-1;
+	if(an.hash < 1)
+		an.hash = 1;
+	data = st.st_size ? (const char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	if(data == MAP_FAILED) {
+		perror("mmap");
+		close(fd);
+		return 1;
+	}
+	if(data != NULL)
+		madvise((void*) data, st.st_size, MADV_SEQUENTIAL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	an.window = 4*threads;				//Filas e janela limitadas: a leitura espera a escrita
+	an.pending = (Annotation**) calloc(an.window, sizeof(Annotation*));
+	initialize_queue(&an.jobs, threads);
+	initialize_queue(&an.done, an.window);
+	pthread_mutex_init(&an.lock, NULL);
+	pthread_cond_init(&an.cond, NULL);
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	for(i=0; i<threads; i++)
+		pthread_create(&tid[i], NULL, thread_annotate, &an);
+	pthread_create(&writer, NULL, writer_annotate, &an);
+
+	memset(&pgn, 0, sizeof(Pgn));			//Leitura nesta thread
+	pgn.p = data;
+	pgn.end = data + st.st_size;
+	for(seq=0; NULL != (a = read_annotate(&pgn, seq)); seq++) {
+		pthread_mutex_lock(&an.lock);
+		while(seq >= an.written + an.window)
+			pthread_cond_wait(&an.cond, &an.lock);
+		pthread_mutex_unlock(&an.lock);
+		push_queue(&an.jobs, a, TRUE);
+	}
+	close_queue(&an.jobs);
+	for(i=0; i<threads; i++)
+		pthread_join(tid[i], NULL);
+	close_queue(&an.done);
+	pthread_join(writer, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	fprintf(stderr, "%lld jogos, %lld lances, %lld jogos com erro, %lld imprecisoes, %lld erros, %lld erros graves\n", an.games, an.plies, an.errors, an.nags[0], an.nags[1], an.nags[2]);
+	fprintf(stderr, "%lld nos, %.3f s, %.1f lances/s, %.0f nos/s, %d threads\n", an.nodes, t, an.plies/(t > 0 ? t : 1), an.nodes/(t > 0 ? t : 1), threads);
+
+	if(an.cache != NULL)
+		close_cache(an.cache);
+	if(data != NULL)
+		munmap((void*) data, st.st_size);
+	close(fd);
+	finalize_queue(&an.jobs);
+	finalize_queue(&an.done);
+	pthread_mutex_destroy(&an.lock);
+	pthread_cond_destroy(&an.cond);
+	free(an.pending);
+	free(tid);
+	return 0;
+}
+
+int main_pack(int argc, char** argv) {
+	int c;
+	const char* out;
+	FILE* in;
+	FILE* file;
+	char* line;
+	char (*buf)[FEN_SIZE];
+	char** fen;
+	Packed* p;
+	size_t* num;
+	size_t b, i, j, n, lines, valid;
+	struct timespec start, end;
+	double t;
+
+	out = NULL;
+	while((c = getopt(argc, argv, "o:")) != -1)
+		switch(c) {
+			case 'o': out = optarg;
+				  break;
+			default: fprintf(stderr, "Uso: %s -o saida [arquivo]\n", argv[0]);
+				 return 1;
+		}
+	if(out == NULL) {
+		fprintf(stderr, "Uso: %s -o saida [arquivo]\n", argv[0]);
+		return 1;
+	}
+	in = optind < argc ? fopen(argv[optind], "r") : stdin;
+	if(in == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(NULL == (file = create_packfile(out))) {
+		perror(out);
+		if(in != stdin)
+			fclose(in);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	buf = malloc(PACK_BLOCK*sizeof(*buf));
+	fen = (char**) malloc(PACK_BLOCK*sizeof(char*));
+	p = (Packed*) malloc(PACK_BLOCK*sizeof(Packed));
+	num = (size_t*) malloc(PACK_BLOCK*sizeof(size_t));	//Linha de cada posicao
+	line = NULL;
+	b = 0;
+	lines = valid = 0;
+	do {
+		for(n=0; n<PACK_BLOCK && -1 != getline(&line, &b, in); ) {	//Bloco de linhas, sem linhas em branco
+			lines++;
+			if(line[strspn(line, " \t\r\n")] == '\0')
+				continue;
+			if(!epdToFen(line, buf[n], FEN_SIZE))
+				buf[n][0] = '\0';
+			fen[n] = buf[n];
+			num[n++] = lines;
+		}
+		encode_packed(fen, n, p);
+		for(i=j=0; i<n; i++) {					//Somente as posicoes validas sao gravadas
+			if(p[i].occupied[0] | p[i].occupied[1] | p[i].occupied[2] | p[i].occupied[3] | p[i].occupied[4] | p[i].occupied[5] | p[i].occupied[6] | p[i].occupied[7])
+				p[j++] = p[i];
+			else
+				fprintf(stderr, "posicao invalida na linha %zu\n", num[i]);
+		}
+		if(fwrite(p, sizeof(Packed), j, file) != j) {
+			perror(out);
+			break;
+		}
+		valid += j;
+	} while(n == PACK_BLOCK);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	fprintf(stderr, "%zu linhas, %zu posicoes, %.1f MB, %.3f s, %.1f posicoes/s\n", lines, valid, (valid+1)*sizeof(Packed)/1e6, t, valid/(t > 0 ? t : 1));
+
+	free(line);
+	free(buf);
+	free(fen);
+	free(p);
+	free(num);
+	if(in != stdin)
+		fclose(in);
+	if(fclose(file)) {
+		perror(out);
+		return 1;
+	}
+	return 0;
+}
+
+int main_unpack(int argc, char** argv) {
+	int c;
+	size_t i, n, k, first, count;
+	char (*buf)[FEN_SIZE];
+	PackFile pf;
+
+	first = 0;
+	count = SIZE_MAX;
+	while((c = getopt(argc, argv, "i:n:")) != -1)
+		switch(c) {
+			case 'i': first = strtoull(optarg, NULL, 10);
+				  break;
+			case 'n': count = strtoull(optarg, NULL, 10);
+				  break;
+			default: fprintf(stderr, "Uso: %s [-i inicio] [-n quantidade] arquivo\n", argv[0]);
+				 return 1;
+		}
+	if(optind >= argc) {
+		fprintf(stderr, "Uso: %s [-i inicio] [-n quantidade] arquivo\n", argv[0]);
+		return 1;
+	}
+	if(!open_packfile(&pf, argv[optind])) {
+		perror(argv[optind]);
+		return 1;
+	}
+	if(first > pf.n)
+		first = pf.n;
+	if(count > pf.n - first)
+		count = pf.n - first;
+	madvise(pf.map, pf.size, MADV_SEQUENTIAL);
+
+	buf = malloc(PACK_BLOCK*sizeof(*buf));
+	for(i=first; i<first+count; i+=n) {				//Acesso direto ao registro inicial
+		n = first+count-i < PACK_BLOCK ? first+count-i : PACK_BLOCK;
+		decode_packed(pf.rec + i, n, buf);
+		for(k=0; k<n; k++)
+			if(buf[k][0])
+				printf("%s\n", buf[k]);
+			else
+				printf("error invalid position %zu\n", i+k);
+	}
+	free(buf);
+	close_packfile(&pf);
+	return 0;
+}
+
+int main_legal(int argc, char** argv) {
+	static const char promote[] = "\0NBRQ";
+	int i, n, from, to, p;
+	long long positions, queries, errors, legal;
+	double t_gen, t_legal;
+	char* line;
+	char fen[128];
+	char str[6];
+	char gen[64][64][5];		//Tipo de ocupacao dos movimentos gerados, -1 se nao gerado
+	char seen[64][64][5];		//Movimentos gerados tambem por genMoves_chess
+	size_t b;
+	FILE* in;
+	Fen f;
+	State st;
+	Chess chess;
+	Arena arena;
+	Move list[MAX_MOVES];
+	Move m;
+	struct timespec start, end;
+
+	in = argc > 1 ? fopen(argv[1], "r") : stdin;
+	if(in == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	initialize_arena(&arena);
+	line = NULL;
+	b = 0;
+	positions = queries = errors = legal = 0;
+	t_gen = t_legal = 0;
+	while(getline(&line, &b, in) != -1) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if(!epdToFen(line, fen, sizeof(fen)) || !parseFen(fen, &f))
+			continue;
+		loadFen_state(&st, &f);
+		positions++;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);	//Custo da geracao completa
+		n = genMoves_state(&st, list);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		t_gen += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+		memset(gen, -1, sizeof(gen));
+		for(i=0; i<n; i++)
+			gen[list[i].rank*8 + list[i].file][list[i].dest.rank*8 + list[i].dest.file][isupper(list[i].dest.x) ? strchr(promote+1, list[i].dest.x) - promote : 0] = list[i].dest.x;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);	//Custo da verificacao de cada movimento possivel
+		for(i=0; i<n; i++) {
+			m = list[i];
+			legal += legal_state(&st, &m);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		t_legal += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+
+		for(from=0; from<64; from++)		//Todos os movimentos candidatos
+			for(to=0; to<64; to++)
+				for(p=0; p<5; p++) {
+					m.file = from%8;
+					m.rank = from/8;
+					m.dest.file = to%8;
+					m.dest.rank = to/8;
+					m.dest.x = promote[p];
+					queries++;
+					if(legal_state(&st, &m) == (gen[from][to][p] != -1) && (gen[from][to][p] == -1 || m.dest.x == gen[from][to][p]))
+						continue;
+					errors++;
+					printf("%s %s legal_state %d genMoves_state %d\n", fen, str_move(&m, str), gen[from][to][p] == -1, gen[from][to][p] != -1);
+				}
+
+		if(!load_chess(&chess, fen, &arena))	//Gerador do registro Chess (servidor, UCI e biblioteca)
+			continue;
+		memset(seen, 0, sizeof(seen));
+		n = genMoves_chess(&chess, list);
+		for(i=0; i<n; i++) {
+			from = list[i].rank*8 + list[i].file;
+			to = list[i].dest.rank*8 + list[i].dest.file;
+			p = isupper(list[i].dest.x) ? strchr(promote+1, list[i].dest.x) - promote : 0;
+			seen[from][to][p] = TRUE;
+			if(gen[from][to][p] == list[i].dest.x)
+				continue;
+			errors++;
+			printf("%s %s genMoves_chess 1 genMoves_state %d\n", fen, str_move(&list[i], str), gen[from][to][p] != -1);
+		}
+		for(from=0; from<64; from++)
+			for(to=0; to<64; to++)
+				for(p=0; p<5; p++)
+					if(gen[from][to][p] != -1 && !seen[from][to][p]) {
+						m.file = from%8;
+						m.rank = from/8;
+						m.dest.file = to%8;
+						m.dest.rank = to/8;
+						m.dest.x = gen[from][to][p];
+						errors++;
+						printf("%s %s genMoves_chess 0 genMoves_state 1\n", fen, str_move(&m, str));
+					}
+		clear_chess(&chess);
+	}
+	fprintf(stderr, "%lld posicoes, %lld consultas, %lld divergencias, geracao %.0f ns/posicao, verificacao %.0f ns/movimento\n", positions, queries, errors,
+		positions ? t_gen*1e9/positions : 0.0, legal ? t_legal*1e9/legal : 0.0);
+	free(line);
+	finalize_arena(&arena);
+	if(in != stdin)
+		fclose(in);
+	return errors != 0;
+}
+
+/*Joga uma partida entre as configuracoes A e B e escreve o PGN.
+	Parametros
+		Match* match	partidas da thread
+		int g		numero da partida; A joga de brancas nas partidas pares
+		Search* s	busca
+		TTable* tt	tabelas de transposicao de A e B
+*/
+static void play_match(Match* match, int g, Search* s, TTable* tt) {
+	int side, plies, col, n;
+	char fen[FEN_SIZE];
+	char num[16];
+	char san[8];
+	const char* opening;
+	const char* result;
+	char* text;
+	size_t size;
+	FILE* out;
+	Chess chess;
+	Gamesit sit;
+	struct timespec start, end;
+
+	opening = match->opening[(g/2) % match->n_opening];
+	load_chess(&chess, (char*) opening, &match->arena);	//Aberturas validadas na leitura
+	clear_ttable(&tt[0]);
+	clear_ttable(&tt[1]);
+	out = match->pgn != NULL ? open_memstream(&text, &size) : NULL;
+	col = 0;
+	for(plies=0; PLAY == (sit = sit_chess(&chess)) && plies < match->max_plies; plies++) {
+		side = chess.turn ^ (g%2);				//0: A, 1: B
+		if(plies + 1 > match->m_keys) {				//Chaves da partida
+			match->m_keys = 2*plies + 16;
+			match->keys = (uint64_t*) realloc(match->keys, match->m_keys*sizeof(uint64_t));
+		}
+		s->chess = &chess;
+		s->tt = &tt[side];
+		s->stop = FALSE;
+		s->infinite = FALSE;
+		s->max_depth = match->max_depth[side];
+		s->max_nodes = match->max_nodes[side];
+		s->max_time = match->max_time[side];
+		s->keys = match->keys;
+		s->n_keys = plies;
+		s->out = NULL;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		iterate_search(s);					//O jogo continua: ha movimento
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if(match->n_latency == match->m_latency) {
+			match->m_latency = 2*match->m_latency + 1024;
+			match->latency = (long long*) realloc(match->latency, match->m_latency*sizeof(long long));
+		}
+		match->latency[match->n_latency++] = (end.tv_sec - start.tv_sec)*1000000LL + (end.tv_nsec - start.tv_nsec)/1000;
+		match->nodes += s->nodes;
+
+		if(out != NULL) {					//Lance em SAN, linhas de ate 80 colunas
+			n = !chess.turn || !plies ? sprintf(num, "%d%s", chess.n_turns, chess.turn ? "..." : ".") : 0;
+			genSan_chess(&chess, &s->best, san);
+			if(col && col + n + (int) strlen(san) + 1 > 80) {
+				fputc('\n', out);
+				col = 0;
+			}
+			else if(col)
+				col += fprintf(out, " ");
+			col += fprintf(out, "%s%s", n ? num : "", san);
+		}
+		match->keys[plies] = key_chess(&chess);
+		makeMove_chess(&chess, chess.board[(int) s->best.rank][(int) s->best.file], &s->best.dest);
+		recordGame_chess(&chess, fen);
+	}
+	match->peak += match->arena.peak;			//Memoria da partida
+	if(match->arena.peak > match->max_peak)
+		match->max_peak = match->arena.peak;
+	clear_chess(&chess);
+
+	switch(sit) {
+		case W_WINS: result = "1-0";
+			     match->score[g%2]++;
+			     break;
+		case B_WINS: result = "0-1";
+			     match->score[!(g%2)]++;
+			     break;
+		default: result = "1/2-1/2";				//Empates e limite de meios-turnos
+			 match->score[2]++;
+	}
+	match->plies += plies;
+	if(out == NULL)
+		return;
+	fprintf(out, "%s{%s} %s\n", col ? " " : "", sit == PLAY ? "Empate -- Limite de Meios-Turnos" : str_sit(sit), result);
+	fclose(out);
+	pthread_mutex_lock(match->lock);
+	fprintf(match->pgn, "[Event \"Self-play\"]\n[Site \"?\"]\n[Date \"????.??.??\"]\n[Round \"%d\"]\n", g+1);
+	fprintf(match->pgn, "[White \"%s\"]\n[Black \"%s\"]\n[Result \"%s\"]\n", g%2 ? "B" : "A", g%2 ? "A" : "B", result);
+	if(strcmp(opening, START_FEN))
+		fprintf(match->pgn, "[SetUp \"1\"]\n[FEN \"%s\"]\n", opening);
+	fprintf(match->pgn, "[PlyCount \"%d\"]\n\n%s\n", plies, text);
+	pthread_mutex_unlock(match->lock);
+	free(text);
+}
+
+/*Funcao das threads de partidas: joga partidas ate atingir o total.
+	Parametros
+		void* arg	partidas da thread
+	Retorno
+		NULL
+*/
+static void* thread_match(void* arg) {
+	Match* match;
+	Search* s;
+	TTable tt[2];
+	int g;
+
+	match = (Match*) arg;
+	s = (Search*) calloc(1, sizeof(Search));
+	initialize_arena(&match->arena);
+	initialize_ttable(&tt[0], match->hash);
+	initialize_ttable(&tt[1], match->hash);
+	while(TRUE) {
+		pthread_mutex_lock(match->lock);
+		g = (*match->next)++;
+		pthread_mutex_unlock(match->lock);
+		if(g >= match->games)
+			break;
+		play_match(match, g, s, tt);
+	}
+	finalize_ttable(&tt[0]);
+	finalize_ttable(&tt[1]);
+	finalize_arena(&match->arena);
+	free(s);
+	flush_stats();
+	return NULL;
+}
+
+/*Compara dois tempos, para qsort.
+	Parametros
+		const void* a	primeiro tempo
+		const void* b	segundo tempo
+	Retorno
+		negativo, zero ou positivo se a e menor, igual ou maior que b
+*/
+static int cmp_latency(const void* a, const void* b) {
+	return (*(const long long*) a > *(const long long*) b) - (*(const long long*) a < *(const long long*) b);
+}
+
+int main_match(int argc, char** argv) {
+	static const char* usage = "Uso: %s [-t threads] [-g partidas] [-f aberturas] [-a limites] [-b limites] [-l meios-turnos] [-H hash] [-o pgn]\n";
+	int i, c, threads, next;
+	char* line;
+	char fen[FEN_SIZE];
+	size_t b, k, lines;
+	FILE* in;
+	Fen f;
+	Match base;
+	Match* match;
+	pthread_t* tid;
+	pthread_mutex_t lock;
+	struct timespec start, end;
+	double t;
+	long long* latency;
+	size_t n_latency;
+
+	memset(&base, 0, sizeof(Match));
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	base.games = 100;
+	base.max_plies = 400;
+	base.hash = 1;
+	for(i=0; i<2; i++) {					//Limites padrao de A e B
+		base.max_depth[i] = 3;
+		base.max_nodes[i] = -1;
+		base.max_time[i] = -1;
+	}
+	in = NULL;
+	while((c = getopt(argc, argv, "t:g:f:a:b:l:H:o:")) != -1)
+		switch(c) {
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'g': base.games = atoi(optarg);
+				  break;
+			case 'f': if(NULL == (in = fopen(optarg, "r"))) {
+					  perror(optarg);
+					  return 1;
+				  }
+				  break;
+			case 'a':
+			case 'b': i = c == 'b';				//Limites: depth N, nodes N, movetime N
+				  base.max_depth[i] = MAX_PLY;
+				  if(limits_session(optarg, &base.max_depth[i], &base.max_nodes[i], &base.max_time[i]) < 1) {	//Ao menos um limite: a partida termina
+					  fprintf(stderr, usage, argv[0]);
+					  return 1;
+				  }
+				  break;
+			case 'l': base.max_plies = atoi(optarg);
+				  break;
+			case 'H': base.hash = atoi(optarg) > 0 ? atoi(optarg) : 1;
+				  break;
+			case 'o': if(NULL == (base.pgn = fopen(optarg, "w"))) {
+					  perror(optarg);
+					  return 1;
+				  }
+				  break;
+			default: fprintf(stderr, usage, argv[0]);
+				 return 1;
+		}
+	if(optind < argc) {
+		fprintf(stderr, usage, argv[0]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+
+	if(in != NULL) {					//Aberturas: uma posicao FEN ou EPD por linha
+		line = NULL;
+		b = 0;
+		for(lines=1; -1 != getline(&line, &b, in); lines++) {
+			if(line[strspn(line, " \t\r\n")] == '\0')
+				continue;
+			if(!epdToFen(line, fen, sizeof(fen)) || !parseFen(fen, &f)) {
+				fprintf(stderr, "abertura invalida na linha %zu\n", lines);
+				continue;
+			}
+			base.opening = (char**) realloc(base.opening, (base.n_opening+1)*sizeof(char*));
+			base.opening[base.n_opening++] = strdup(fen);
+		}
+		free(line);
+		fclose(in);
+	}
+	if(!base.n_opening) {
+		base.opening = (char**) malloc(sizeof(char*));
+		base.opening[base.n_opening++] = strdup(START_FEN);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_init(&lock, NULL);
+	next = 0;
+	base.next = &next;
+	base.lock = &lock;
+	match = (Match*) malloc(threads*sizeof(Match));
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	for(i=0; i<threads; i++) {
+		match[i] = base;
+		pthread_create(&tid[i], NULL, thread_match, &match[i]);
+	}
+	n_latency = 0;
+	for(i=0; i<threads; i++) {				//Totais
+		pthread_join(tid[i], NULL);
+		if(i) {
+			for(c=0; c<3; c++)
+				match[0].score[c] += match[i].score[c];
+			match[0].plies += match[i].plies;
+			match[0].nodes += match[i].nodes;
+			match[0].peak += match[i].peak;
+			if(match[i].max_peak > match[0].max_peak)
+				match[0].max_peak = match[i].max_peak;
+		}
+		n_latency += match[i].n_latency;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	latency = (long long*) malloc((n_latency+1)*sizeof(long long));
+	for(i=0, k=0; i<threads; i++) {
+		memcpy(latency + k, match[i].latency, match[i].n_latency*sizeof(long long));
+		k += match[i].n_latency;
+		free(match[i].latency);
+		free(match[i].keys);
+	}
+	qsort(latency, n_latency, sizeof(long long), cmp_latency);
+	latency[n_latency] = 0;
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	c = match[0].score[0] + match[0].score[1] + match[0].score[2];
+	fprintf(stderr, "A +%d -%d =%d, %.1f%%\n", match[0].score[0], match[0].score[1], match[0].score[2], c ? 100.0*(match[0].score[0] + match[0].score[2]/2.0)/c : 0.0);
+	fprintf(stderr, "%d partidas, %.3f s, %.2f partidas/s, %.1f meios-turnos/partida, %.1f movimentos/s, %.0f nos/s, %d threads\n", c, t, c/(t > 0 ? t : 1), c ? (double) match[0].plies/c : 0.0, match[0].plies/(t > 0 ? t : 1), match[0].nodes/(t > 0 ? t : 1), threads);
+	fprintf(stderr, "latencia por movimento (ms): p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n", latency[n_latency/2]/1e3, latency[n_latency*9/10]/1e3, latency[n_latency*99/100]/1e3, latency[n_latency ? n_latency-1 : 0]/1e3);
+	fprintf(stderr, "memoria por partida (KB): pico medio %.1f, pico maximo %.1f\n", c ? match[0].peak/1024.0/c : 0.0, match[0].max_peak/1024.0);
+
+	if(base.pgn != NULL)
+		fclose(base.pgn);
+	for(i=0; i<base.n_opening; i++)
+		free(base.opening[i]);
+	free(base.opening);
+	free(latency);
+	free(match);
+	free(tid);
+	pthread_mutex_destroy(&lock);
+	return 0;
+}
+
+boolean open_writer(Writer* w, const char* path, size_t buffer, long long sync) {
+	memset(w, 0, sizeof(Writer));
+	if((w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+		return FALSE;
+	w->buf = (char*) malloc(buffer);
+	w->m = buffer;
+	w->sync = sync;
+	pthread_mutex_init(&w->lock, NULL);
+	return TRUE;
+}
+
+/*Escreve dados no arquivo, sincronizando a cada w->sync bytes. Chamada com a trava.
+	Parametros
+		Writer* w		escrita
+		const char* data	dados
+		size_t n		tamanho em bytes
+*/
+static void flush_writer(Writer* w, const char* data, size_t n) {
+	ssize_t k;
+	while(n && !w->error) {
+		if((k = write(w->fd, data, n)) < 0) {
+			w->error = errno != EINTR;
+			continue;
+		}
+		data += k;
+		n -= k;
+		w->written += k;
+		w->unsynced += k;
+	}
+	if(w->sync && w->unsynced >= w->sync && !w->error) {
+		w->error = fsync(w->fd) < 0;
+		w->unsynced = 0;
+	}
+}
+
+boolean write_writer(Writer* w, const void* data, size_t n) {
+	boolean ok;
+	pthread_mutex_lock(&w->lock);
+	if(n > w->m - w->n) {				//Buffer cheio
+		flush_writer(w, w->buf, w->n);
+		w->n = 0;
+	}
+	if(n > w->m)					//Maior que o buffer: escrita direta
+		flush_writer(w, (const char*) data, n);
+	else {
+		memcpy(w->buf + w->n, data, n);
+		w->n += n;
+	}
+	ok = !w->error;
+	pthread_mutex_unlock(&w->lock);
+	return ok;
+}
+
+boolean close_writer(Writer* w) {
+	boolean ok;
+	flush_writer(w, w->buf, w->n);
+	ok = !w->error && !fsync(w->fd);
+	ok = !close(w->fd) && ok;
+	free(w->buf);
+	pthread_mutex_destroy(&w->lock);
+	return ok;
+}
+
+void initialize_bloom(Bloom* bloom, size_t mb) {
+	uint64_t m;
+	for(m=1; m*2 <= (uint64_t) (mb ? mb : 1) << 17; m*=2);	//Palavras de 64 bits
+	bloom->bits = (uint64_t*) calloc(m, sizeof(uint64_t));
+	bloom->mask = 64*m - 1;
+}
+
+void finalize_bloom(Bloom* bloom) {
+	free(bloom->bits);
+}
+
+boolean insert_bloom(Bloom* bloom, uint64_t key) {
+	int i;
+	uint64_t h, bit, prev;
+	boolean new;
+	h = zobrist(key) | 1;					//Quatro bits por dupla dispersao
+	new = FALSE;
+	for(i=0; i<4; i++) {
+		bit = (key + i*h) & bloom->mask;
+		prev = __atomic_fetch_or(&bloom->bits[bit >> 6], 1ULL << (bit & 63), __ATOMIC_RELAXED);
+		if(!(prev & 1ULL << (bit & 63)))
+			new = TRUE;
+	}
+	return new;
+}
+
+static volatile sig_atomic_t gen_quit = FALSE;		//Sinal de encerramento da geracao
+
+/*Trata os sinais de encerramento da geracao: as partidas em andamento sao descartadas.
+	Parametros
+		int sig		sinal
+*/
+static void signal_gen(int sig) {
+	(void) sig;
+	gen_quit = TRUE;
+}
+
+/*Funcao das threads de geracao: joga partidas aleatorizadas e grava as posicoes quietas e ineditas com o resultado.
+	Parametros
+		void* arg	registro Generator
+	Retorno
+		NULL
+*/
+static void* thread_gen(void* arg) {
+	Generator* gen;
+	Search* s;
+	TTable tt;
+	Chess chess;
+	Move list[MAX_MOVES];
+	Move* move;
+	Sample* sample;
+	Gamesit sit;
+	Arena arena;
+	char fen[FEN_SIZE];
+	uint64_t* keys;
+	uint64_t rng;
+	int i, n, plies, score, result;
+	long long noisy, duplicates;
+	boolean done;
+
+	gen = (Generator*) arg;
+	s = (Search*) calloc(1, sizeof(Search));
+	initialize_arena(&arena);
+	initialize_ttable(&tt, gen->hash);
+	keys = (uint64_t*) malloc(gen->max_plies*sizeof(uint64_t));
+	sample = (Sample*) malloc(gen->max_plies*sizeof(Sample));
+	pthread_mutex_lock(&gen->lock);
+	rng = zobrist(gen->seed++);				//Semente propria de cada thread
+	done = gen->target >= 0 && gen->positions >= gen->target;
+	pthread_mutex_unlock(&gen->lock);
+
+	while(!done && !gen_quit) {
+		load_chess(&chess, START_FEN, &arena);
+		clear_ttable(&tt);
+		n = 0;
+		noisy = duplicates = 0;
+		for(plies=0; PLAY == (sit = sit_chess(&chess)) && plies < gen->max_plies && !gen_quit; plies++) {
+			keys[plies] = key_chess(&chess);
+			if(plies < gen->random_plies) {		//Abertura aleatoria
+				rng = zobrist(rng);
+				move = &list[rng % genMoves_chess(&chess, list)];
+			}
+			else {
+				s->chess = &chess;
+				s->tt = &tt;
+				s->stop = FALSE;
+				s->infinite = FALSE;
+				s->max_depth = gen->max_depth;
+				s->max_nodes = gen->max_nodes;
+				s->max_time = -1;
+				s->keys = keys;
+				s->n_keys = plies;
+				s->out = NULL;
+				iterate_search(s);
+				move = &s->best;
+				//Somente posicoes quietas: sem xeque e com melhor movimento sem captura ou promocao
+				if(incheck_chess(&chess) || chess.board[(int) move->dest.rank][(int) move->dest.file] != NULL || move->dest.x == 'e' || isupper(move->dest.x))
+					noisy++;
+				else if(!insert_bloom(&gen->bloom, keys[plies]))
+					duplicates++;
+				else {
+					pack_chess(&chess, &sample[n].pos);
+					score = s->score < SHRT_MIN ? SHRT_MIN : s->score > SHRT_MAX ? SHRT_MAX : s->score;
+					sample[n].score[0] = (uint16_t) score;
+					sample[n].score[1] = (uint16_t) score >> 8;
+					sample[n].reserved = 0;
+					n++;
+				}
+			}
+			makeMove_chess(&chess, chess.board[(int) move->rank][(int) move->file], &move->dest);
+			recordGame_chess(&chess, fen);
+		}
+		clear_chess(&chess);
+		if(gen_quit)					//Partida interrompida: resultado desconhecido
+			break;
+
+		result = sit == W_WINS ? 1 : sit == B_WINS ? -1 : 0;	//Empates e limite de meios-turnos
+		for(i=0; i<n; i++)
+			sample[i].result = sample[i].pos.flags & 1 ? -result : result;
+		if(!write_writer(&gen->out, sample, n*sizeof(Sample)))
+			gen_quit = TRUE;
+		pthread_mutex_lock(&gen->lock);
+		gen->positions += n;
+		gen->games++;
+		gen->noisy += noisy;
+		gen->duplicates += duplicates;
+		done = gen->target >= 0 && gen->positions >= gen->target;
+		pthread_mutex_unlock(&gen->lock);
+	}
+
+	finalize_ttable(&tt);
+	finalize_arena(&arena);
+	free(s);
+	free(keys);
+	free(sample);
+	flush_stats();
+	return NULL;
+}
+
+int main_gen(int argc, char** argv) {
+	static const char* usage = "Uso: %s -o saida [-t threads] [-p posicoes] [-d depth] [-n nodes] [-r meios-turnos aleatorios] [-l meios-turnos] [-s semente] [-B filtro] [-S fsync] [-H hash]\n";
+	int i, c, threads;
+	const char* out;
+	size_t bloom;
+	long long sync;
+	char header[sizeof(Sample)];
+	pthread_t* tid;
+	Generator gen;
+	struct sigaction sa;
+	struct timespec start, end;
+	double t;
+	boolean ok;
+
+	memset(&gen, 0, sizeof(Generator));
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	out = NULL;
+	gen.max_depth = 2;
+	gen.max_nodes = -1;
+	gen.random_plies = 8;
+	gen.max_plies = 300;
+	gen.target = -1;
+	gen.seed = time(NULL);
+	gen.hash = 1;
+	bloom = 64;
+	sync = 64;
+	while((c = getopt(argc, argv, "o:t:p:d:n:r:l:s:B:S:H:")) != -1)
+		switch(c) {
+			case 'o': out = optarg;
+				  break;
+			case 't': threads = atoi(optarg);
+				  break;
+			case 'p': gen.target = atoll(optarg);
+				  break;
+			case 'd': gen.max_depth = atoi(optarg) > 0 ? atoi(optarg) : 1;
+				  break;
+			case 'n': gen.max_nodes = atoll(optarg);
+				  break;
+			case 'r': gen.random_plies = atoi(optarg);
+				  break;
+			case 'l': gen.max_plies = atoi(optarg) > 0 ? atoi(optarg) : 1;
+				  break;
+			case 's': gen.seed = strtoull(optarg, NULL, 10);
+				  break;
+			case 'B': bloom = atoi(optarg);
+				  break;
+			case 'S': sync = atoll(optarg);
+				  break;
+			case 'H': gen.hash = atoi(optarg) > 0 ? atoi(optarg) : 1;
+				  break;
+			default: fprintf(stderr, usage, argv[0]);
+				 return 1;
+		}
+	if(out == NULL || optind < argc) {
+		fprintf(stderr, usage, argv[0]);
+		return 1;
+	}
+	if(threads < 1)
+		threads = 1;
+	if(!open_writer(&gen.out, out, 1 << 20, sync << 20)) {	//Buffer de 1 MB, fsync a cada sync MB
+		perror(out);
+		return 1;
+	}
+	memset(header, 0, sizeof(header));			//Cabecalho do tamanho de um registro
+	memcpy(header, SAMPLE_MAGIC, strlen(SAMPLE_MAGIC));
+	write_writer(&gen.out, header, sizeof(header));
+	initialize_bloom(&gen.bloom, bloom);
+	pthread_mutex_init(&gen.lock, NULL);
+
+	memset(&sa, 0, sizeof(sa));				//Interrupcao: grava as partidas concluidas e encerra
+	sa.sa_handler = signal_gen;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	tid = (pthread_t*) malloc(threads*sizeof(pthread_t));
+	for(i=0; i<threads; i++)
+		pthread_create(&tid[i], NULL, thread_gen, &gen);
+	for(i=0; i<threads; i++)
+		pthread_join(tid[i], NULL);
+	ok = close_writer(&gen.out);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(!ok)
+		perror(out);
+
+	t = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	fprintf(stderr, "%lld posicoes, %lld partidas, %lld taticas, %lld repetidas, %.1f MB, %.3f s, %.0f posicoes/s, %.2f M posicoes/h, %d threads\n", gen.positions, gen.games, gen.noisy, gen.duplicates, gen.out.written/1e6, t, gen.positions/(t > 0 ? t : 1), 3600e-6*gen.positions/(t > 0 ? t : 1), threads);
+
+	finalize_bloom(&gen.bloom);
+	pthread_mutex_destroy(&gen.lock);
+	free(tid);
+	return !ok;
+}
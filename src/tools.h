@@ -0,0 +1,155 @@
+#ifndef TOOLS_H
+#define TOOLS_H
+
+#include <stdio.h>
+
+/*Executa o protocolo UCI ate o comando quit ou o fim da entrada.
+	Parametros
+		FILE* in	entrada de comandos
+		FILE* out	saida de respostas
+*/
+void loop_uci(FILE* in, FILE* out);
+
+/*Analisa posicoes em lote em varias threads, uma posicao FEN ou EPD por linha.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-d depth] [-n nodes] [-m movetime] [-H hash] [-c cache] [-o] [arquivo]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_batch(int argc, char** argv);
+
+/*Executa uma suite de testes EPD em varias threads, com limite fixo de tempo, nos ou profundidade por posicao:
+cada posicao e resolvida se o movimento da IA esta entre os de bm e fora dos de am. Escreve, por posicao, o
+resultado e a iteracao em que a solucao apareceu, e o resumo (resolvidas, nos, nos/s, distribuicao do tempo ate
+a solucao) na saida de erro.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-d depth] [-n nodes] [-m movetime] [-H hash] [-o] [arquivo]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_suite(int argc, char** argv);
+
+/*Procura mates forcados em lote em varias threads, uma posicao FEN ou EPD por linha: o mate mais curto provado,
+com a variante, ou a prova de que nao ha mate no numero de lances (operacao EPD dm ou -d).
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-d lances] [-n nodes] [-H hash] [-o] [arquivo]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_mate(int argc, char** argv);
+
+/*Analisa posicoes FEN ou EPD em sequencia com a busca em arvore Monte Carlo, todas as threads sobre a mesma
+arvore: melhor movimento, pontuacao, playouts por segundo e memoria da arvore de cada posicao.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-n playouts] [-m movetime] [-M arvore em MB] [-c cpuct] [arquivo]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_mcts(int argc, char** argv);
+
+/*Servidor de partidas contra a IA: sockets TCP (localhost) ou Unix multiplexados com epoll. Os resultados das buscas
+ficam num cache LRU particionado (-C, em MB, 0 desativa), e buscas identicas simultaneas sao feitas uma so vez.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-p porta | -u caminho] [-t threads] [-g partidas] [-q fila] [-d depth] [-n nodes] [-m movetime] [-H hash] [-C cache]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_server(int argc, char** argv);
+
+/*Reproduz os jogos de um arquivo PGN, dividido entre threads nos limites dos jogos.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-f] arquivo
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_pgn(int argc, char** argv);
+
+/*Gera um indice de aberturas a partir de um arquivo PGN: as threads reproduzem trechos do arquivo e gravam as
+posicoes (chave zobrist, movimento e resultado) em sequencias ordenadas de memoria limitada, intercaladas no fim
+num indice ordenado e comprimido em blocos. Jogos sem resultado ou com erro sao ignorados.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: -o indice [-t threads] [-M memoria em MB] [-T diretorio temporario] arquivo
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_index(int argc, char** argv);
+
+/*Consulta um indice de aberturas: para cada posicao, os movimentos jogados com numero de jogos, vitorias das
+brancas, empates e vitorias das pretas, do mais ao menos jogado.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: indice [arquivo], uma posicao FEN ou EPD por linha (padrao: entrada padrao)
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_explore(int argc, char** argv);
+
+/*Anota os jogos de um arquivo PGN: a leitura, as threads de analise e a escrita formam um pipeline com filas
+limitadas. Cada meio-turno e analisado com o limite de busca dado; o jogo e escrito na ordem original com a
+avaliacao apos cada lance ([%eval]) e NAG nas imprecisoes ($6), erros ($2) e erros graves ($4). O cache de analise
+(-c) somente recebe a analise de cada posicao: a perda de um lance usa as pontuacoes de cada profundidade da
+busca, e a leitura do cache as alteraria.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-d depth] [-n nodes] [-m movetime] [-H hash] [-c cache] arquivo
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_annotate(int argc, char** argv);
+
+/*Compacta posicoes FEN ou EPD, uma por linha, num arquivo de registros de 32 bytes.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: -o saida [arquivo]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_pack(int argc, char** argv);
+
+/*Escreve em FEN as posicoes de um arquivo de registros compactados.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-i inicio] [-n quantidade] arquivo
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_unpack(int argc, char** argv);
+
+/*Diagnostico da verificacao de movimentos isolados (legal_state): compara, em cada posicao, a resposta para todo
+par origem-destino e promocao com a geracao completa (genMoves_state), e esta com a geracao do registro Chess
+(genMoves_chess, usada pelo servidor, pelo UCI e pela biblioteca); escreve as divergencias e mede o custo de cada uma.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [arquivo], uma posicao FEN ou EPD por linha (padrao: entrada padrao)
+	Retorno
+		0 se nao ha divergencias, 1 caso contrario
+*/
+int main_legal(int argc, char** argv);
+
+/*Partidas da IA contra si mesma em varias threads, com saida PGN e estatisticas de desempenho.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: [-t threads] [-g partidas] [-f aberturas] [-a limites] [-b limites] [-l meios-turnos] [-H hash] [-o pgn]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_match(int argc, char** argv);
+
+/*Gera posicoes rotuladas (posicao, pontuacao da busca, resultado) por partidas da IA contra si mesma em varias threads.
+	Parametros
+		int argc	numero de argumentos
+		char** argv	argumentos: -o saida [-t threads] [-p posicoes] [-d depth] [-n nodes] [-r meios-turnos aleatorios]
+				[-l meios-turnos] [-s semente] [-B filtro] [-S fsync] [-H hash]
+	Retorno
+		0 em caso de sucesso, 1 em caso de erro
+*/
+int main_gen(int argc, char** argv);
+
+#endif